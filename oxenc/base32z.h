@@ -5,6 +5,7 @@
 #include <iterator>
 #include <string>
 #include <string_view>
+#include <type_traits>
 
 #include "byte_type.h"
 #include "common.h"
@@ -50,6 +51,120 @@ namespace detail {
                     b32z_lut.to_b32z(5) == 'f',
             "");
 
+    // Bulk base32z kernels for contiguous input, used by to_base32z/from_base32z/is_base32z
+    // whenever the input and output are contiguous memory and we aren't being evaluated at compile
+    // time.  These work on whole 40-bit blocks (5 bytes <-> 8 characters) held in a 64-bit integer
+    // rather than feeding the bits through one at a time like base32z_encoder/base32z_decoder do.
+
+    // Encodes the 40-bit value `v` into 8 characters
+    inline void b32z_encode_block(uint64_t v, char* out) {
+        for (int j = 0; j < 8; j++)
+            out[j] = b32z_lut.to_b32z(static_cast<unsigned char>((v >> (35 - 5 * j)) & 0x1f));
+    }
+
+    // Returns the 5-bit value of a base32z character, and sets `bad` if it isn't one.
+    inline uint64_t b32z_value(char c, bool& bad) {
+        auto v = static_cast<unsigned char>(b32z_lut.from_b32z(static_cast<unsigned char>(c)));
+        bad |= v == 0 && (c | 0x20) != 'y';
+        return v;
+    }
+
+    // Encodes `n` bytes.  This is a template on the size so that we can have the compiler generate
+    // a fully unrolled version for fixed-size inputs (i.e. 32-byte keys); pass a size_t for a
+    // runtime length, or a std::integral_constant for a compile-time one.
+    template <typename Size>
+    inline char* b32z_encode_blocks(const unsigned char* in, Size n, char* out) {
+        size_t i = 0;
+        for (; i + 5 <= n; i += 5, out += 8)
+            b32z_encode_block(
+                    uint64_t{in[i]} << 32 | uint64_t{in[i + 1]} << 24 | uint64_t{in[i + 2]} << 16 |
+                            uint64_t{in[i + 3]} << 8 | uint64_t{in[i + 4]},
+                    out);
+        if (size_t r = n - i) {
+            // 1-4 trailing bytes; encode them as the top bits of a zero-padded block, and keep
+            // only as many characters as we need to cover those bits (just like base32z_encoder).
+            uint64_t v = 0;
+            for (size_t j = 0; j < r; j++)
+                v |= uint64_t{in[i + j]} << (32 - 8 * j);
+            char block[8];
+            b32z_encode_block(v, block);
+            size_t chars = (r * 8 + 4) / 5;
+            for (size_t j = 0; j < chars; j++)
+                *out++ = block[j];
+        }
+        return out;
+    }
+
+    // Decodes `n` base32z characters; `n` must be a valid encoding length (i.e. not 8k+1, 8k+3,
+    // or 8k+6).  Clears `valid` if any invalid characters are encountered.  As with
+    // b32z_encode_blocks, `Size` can be a std::integral_constant for a fixed-size decode.
+    template <typename Size>
+    inline unsigned char* b32z_decode_blocks(
+            const char* in, Size n, unsigned char* out, bool& valid) {
+        bool bad = false;
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8, out += 5) {
+            uint64_t v = 0;
+            for (size_t j = 0; j < 8; j++)
+                v = v << 5 | b32z_value(in[i + j], bad);
+            for (size_t j = 0; j < 5; j++)
+                out[j] = static_cast<unsigned char>(v >> (32 - 8 * j));
+        }
+        if (size_t r = n - i) {
+            // 2, 4, 5, or 7 trailing chars holding 1, 2, 3, or 4 bytes plus some padding bits,
+            // which we ignore (as base32z_decoder does).
+            uint64_t v = 0;
+            for (size_t j = 0; j < r; j++)
+                v |= b32z_value(in[i + j], bad) << (35 - 5 * j);
+            size_t bytes = r * 5 / 8;
+            for (size_t j = 0; j < bytes; j++)
+                *out++ = static_cast<unsigned char>(v >> (32 - 8 * j));
+        }
+        if (bad)
+            valid = false;
+        return out;
+    }
+
+    // Size of a typical (e.g. ed25519 or x25519) public key, for which we use a fixed-size,
+    // fully unrolled encoder/decoder.
+    inline constexpr size_t b32z_key_size = 32;
+    using b32z_key_bytes = std::integral_constant<size_t, b32z_key_size>;
+    using b32z_key_chars = std::integral_constant<size_t, (b32z_key_size * 8 + 4) / 5>;
+
+    inline char* b32z_encode_bulk(const unsigned char* in, size_t n, char* out) {
+        if (n == b32z_key_bytes{})
+            return b32z_encode_blocks(in, b32z_key_bytes{}, out);
+        return b32z_encode_blocks(in, n, out);
+    }
+
+    // Decodes `n` base32z characters into `out`, which must have room for from_base32z_size(n)
+    // bytes.  Returns a pointer just past the last byte written, and clears `valid` if the input
+    // is not valid base32z (in which case the output is unspecified).
+    inline unsigned char* b32z_decode_bulk(
+            const char* in, size_t n, unsigned char* out, bool& valid) {
+        valid = true;
+        if (auto r = n % 8; r == 1 || r == 3 || r == 6) {
+            valid = false;
+            return out;
+        }
+        if (n == b32z_key_chars{})
+            return b32z_decode_blocks(in, b32z_key_chars{}, out, valid);
+        return b32z_decode_blocks(in, n, out, valid);
+    }
+
+    // Returns true if all `n` characters are in the base32z alphabet.  (Does not check the length).
+    inline bool b32z_validate_bulk(const char* in, size_t n) {
+        bool bad = false;
+        size_t i = 0;
+        // Only check for failure once per block to keep the inner loop branch-free
+        for (; i + 8 <= n && !bad; i += 8)
+            for (size_t j = 0; j < 8; j++)
+                b32z_value(in[i + j], bad);
+        for (; i < n; i++)
+            b32z_value(in[i], bad);
+        return !bad;
+    }
+
 }  // namespace detail
 
 /// Returns the number of characters required to encode a base32z string from the given number of
@@ -132,21 +247,35 @@ struct base32z_encoder final {
 template <typename InputIt, typename OutputIt>
 OutputIt to_base32z(InputIt begin, InputIt end, OutputIt out) {
     static_assert(sizeof(decltype(*begin)) == 1, "to_base32z requires chars/bytes");
-    base32z_encoder it{begin, end};
-    return std::copy(it, it.end(), out);
+    if constexpr (detail::bulk_codec_iterators<InputIt, OutputIt>) {
+        auto* o = reinterpret_cast<char*>(std::to_address(out));
+        auto* e = detail::b32z_encode_bulk(
+                reinterpret_cast<const unsigned char*>(std::to_address(begin)),
+                static_cast<size_t>(end - begin),
+                o);
+        return out + (e - o);
+    } else {
+        base32z_encoder it{begin, end};
+        return std::copy(it, it.end(), out);
+    }
 }
 
 /// Creates a base32z string from an iterator pair of a byte sequence.
 template <typename It>
 std::string to_base32z(It begin, It end) {
     std::string base32z;
-    if constexpr (std::is_base_of_v<
-                          std::random_access_iterator_tag,
-                          typename std::iterator_traits<It>::iterator_category>) {
-        using std::distance;
-        base32z.reserve(to_base32z_size(static_cast<size_t>(distance(begin, end))));
+    if constexpr (std::contiguous_iterator<It>) {
+        base32z.resize(to_base32z_size(static_cast<size_t>(end - begin)));
+        to_base32z(begin, end, base32z.data());
+    } else {
+        if constexpr (std::is_base_of_v<
+                              std::random_access_iterator_tag,
+                              typename std::iterator_traits<It>::iterator_category>) {
+            using std::distance;
+            base32z.reserve(to_base32z_size(static_cast<size_t>(distance(begin, end))));
+        }
+        to_base32z(begin, end, std::back_inserter(base32z));
     }
-    to_base32z(begin, end, std::back_inserter(base32z));
     return base32z;
 }
 
@@ -179,6 +308,13 @@ constexpr bool is_base32z(It begin, It end) {
         if (count == 1 || count == 3 || count == 6)  // see below
             return false;
     }
+    if constexpr (std::contiguous_iterator<It>) {
+        if (!std::is_constant_evaluated())
+            return detail::b32z_validate_bulk(
+                    reinterpret_cast<const char*>(std::to_address(begin)),
+                    static_cast<size_t>(end - begin));
+    }
+    // Non-contiguous input, or constant evaluation (where the bulk validator can't be used):
     for (; begin != end; ++begin) {
         auto c = static_cast<unsigned char>(*begin);
         if (detail::b32z_lut.from_b32z(c) == 0 && !(c == 'y' || c == 'Y'))
@@ -289,6 +425,20 @@ struct base32z_decoder final {
 template <typename InputIt, typename OutputIt>
 constexpr OutputIt from_base32z(InputIt begin, InputIt end, OutputIt out) {
     static_assert(sizeof(decltype(*begin)) == 1, "from_base32z requires chars/bytes");
+    if constexpr (detail::bulk_codec_iterators<InputIt, OutputIt>) {
+        if (!std::is_constant_evaluated()) {
+            bool valid;
+            auto* o = reinterpret_cast<unsigned char*>(std::to_address(out));
+            auto* e = detail::b32z_decode_bulk(
+                    reinterpret_cast<const char*>(std::to_address(begin)),
+                    static_cast<size_t>(end - begin),
+                    o,
+                    valid);
+            assert(valid);
+            (void)valid;
+            return out + (e - o);
+        }
+    }
     assert(is_base32z(begin, end));
     base32z_decoder it{begin, end};
     auto bend = it.end();
@@ -302,13 +452,18 @@ constexpr OutputIt from_base32z(InputIt begin, InputIt end, OutputIt out) {
 template <typename It>
 std::string from_base32z(It begin, It end) {
     std::string bytes;
-    if constexpr (std::is_base_of_v<
-                          std::random_access_iterator_tag,
-                          typename std::iterator_traits<It>::iterator_category>) {
-        using std::distance;
-        bytes.reserve(from_base32z_size(static_cast<size_t>(distance(begin, end))));
+    if constexpr (std::contiguous_iterator<It>) {
+        bytes.resize(from_base32z_size(static_cast<size_t>(end - begin)));
+        bytes.erase(from_base32z(begin, end, bytes.begin()), bytes.end());
+    } else {
+        if constexpr (std::is_base_of_v<
+                              std::random_access_iterator_tag,
+                              typename std::iterator_traits<It>::iterator_category>) {
+            using std::distance;
+            bytes.reserve(from_base32z_size(static_cast<size_t>(distance(begin, end))));
+        }
+        from_base32z(begin, end, std::back_inserter(bytes));
     }
-    from_base32z(begin, end, std::back_inserter(bytes));
     return bytes;
 }
 
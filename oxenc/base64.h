@@ -8,6 +8,8 @@
 
 #include "byte_type.h"
 #include "common.h"
+#include "endian.h"
+#include "simd.h"
 
 namespace oxenc {
 
@@ -55,6 +57,350 @@ namespace detail {
             b64_lut.from_b64('/') == 63 && b64_lut.from_b64('7') == 59 && b64_lut.to_b64(38) == 'm',
             "");
 
+    // Bulk base64 kernels for contiguous input, used by to_base64/from_base64/is_base64 whenever
+    // the input and output are contiguous memory and we aren't being evaluated at compile time.
+    // As with the hex kernels, the vectorized versions only handle whole blocks (and never touch
+    // the final few characters, where padding may live) and return how much input they consumed;
+    // the `_portable` versions handle everything else.
+
+    // Encodes `n` bytes, including the final partial group and (if requested) padding.  Returns a
+    // pointer just past the last character written.
+    inline char* b64_encode_portable(const unsigned char* in, size_t n, char* out, bool padded) {
+        const auto& lut = b64_lut.to_b64_lut;
+        size_t i = 0;
+        // 6 bytes at a time out of a 64-bit big-endian load; the last 2 bytes are loaded but unused
+        for (; i + 8 <= n; i += 6) {
+            auto v = load_big_to_host<uint64_t>(in + i);
+            for (int shift = 58; shift >= 16; shift -= 6)
+                *out++ = lut[(v >> shift) & 0x3f];
+        }
+        for (; i + 3 <= n; i += 3) {
+            uint32_t v = uint32_t{in[i]} << 16 | uint32_t{in[i + 1]} << 8 | in[i + 2];
+            *out++ = lut[v >> 18];
+            *out++ = lut[(v >> 12) & 0x3f];
+            *out++ = lut[(v >> 6) & 0x3f];
+            *out++ = lut[v & 0x3f];
+        }
+        if (i < n) {
+            // 1 or 2 trailing bytes => 2 or 3 characters, plus 2 or 1 padding chars
+            uint32_t v = uint32_t{in[i]} << 16 | (i + 1 < n ? uint32_t{in[i + 1]} << 8 : 0);
+            *out++ = lut[v >> 18];
+            *out++ = lut[(v >> 12) & 0x3f];
+            if (i + 1 < n)
+                *out++ = lut[(v >> 6) & 0x3f];
+            else if (padded)
+                *out++ = '=';
+            if (padded)
+                *out++ = '=';
+        }
+        return out;
+    }
+
+    // Decodes `n` base64 characters, which must not include padding.  Returns a pointer just past
+    // the last byte written; `valid` is cleared if any invalid characters are encountered (which
+    // are decoded as if they were 'A's).  The size must not be 4n+1.
+    inline unsigned char* b64_decode_portable(
+            const char* in, size_t n, unsigned char* out, bool& valid) {
+        bool bad = false;
+        auto val = [&bad](char c) -> uint32_t {
+            auto v = static_cast<unsigned char>(b64_lut.from_b64(static_cast<unsigned char>(c)));
+            bad |= v == 0 && c != 'A';
+            return v;
+        };
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            uint64_t v = 0;
+            for (size_t j = 0; j < 8; j++)
+                v = v << 6 | val(in[i + j]);
+            for (int shift = 40; shift >= 0; shift -= 8)
+                *out++ = static_cast<unsigned char>(v >> shift);
+        }
+        for (; i + 4 <= n; i += 4) {
+            uint32_t v = val(in[i]) << 18 | val(in[i + 1]) << 12 | val(in[i + 2]) << 6 |
+                         val(in[i + 3]);
+            *out++ = static_cast<unsigned char>(v >> 16);
+            *out++ = static_cast<unsigned char>(v >> 8);
+            *out++ = static_cast<unsigned char>(v);
+        }
+        if (n - i >= 2) {
+            // 2 chars hold 12 bits (1 byte + 4 padding bits), 3 chars hold 18 (2 bytes + 2 padding
+            // bits); as with base64_decoder we ignore the padding bits entirely.
+            uint32_t v = val(in[i]) << 18 | val(in[i + 1]) << 12 |
+                         (n - i == 3 ? val(in[i + 2]) << 6 : 0);
+            *out++ = static_cast<unsigned char>(v >> 16);
+            if (n - i == 3)
+                *out++ = static_cast<unsigned char>(v >> 8);
+        }
+        if (bad)
+            valid = false;
+        return out;
+    }
+
+    inline bool b64_validate_portable(const char* in, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            auto c = static_cast<unsigned char>(in[i]);
+            if (b64_lut.from_b64(c) == 0 && c != 'A')
+                return false;
+        }
+        return true;
+    }
+
+#ifdef OXENC_SIMD_X86
+    // The vectorized base64 kernels are adapted from the SSSE3/AVX2 algorithms of Wojciech Muła
+    // and Daniel Lemire ("Faster Base64 Encoding and Decoding using AVX2 Instructions", 2018).
+
+    // Converts 16 6-bit values into their base64 characters
+    OXENC_TARGET_SSSE3 inline __m128i b64_translate_ssse3(__m128i indices) {
+        // Map each value to an offset class: 0 for [26, 51], 1-10 for [52, 61], 11 for 62, 12 for
+        // 63, and 13 for [0, 25]; then add the per-class offset to get the ASCII value.
+        const __m128i offsets = _mm_setr_epi8(
+                'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+        __m128i cls = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+        __m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+        cls = _mm_or_si128(cls, _mm_and_si128(upper, _mm_set1_epi8(13)));
+        return _mm_add_epi8(_mm_shuffle_epi8(offsets, cls), indices);
+    }
+
+    // Spreads each 3 bytes of the first 12 bytes of `in` out into four 6-bit values, one per byte
+    OXENC_TARGET_SSSE3 inline __m128i b64_split_ssse3(__m128i in) {
+        in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+        __m128i ac = _mm_mulhi_epu16(
+                _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+        __m128i bd = _mm_mullo_epi16(
+                _mm_and_si128(in, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+        return _mm_or_si128(ac, bd);
+    }
+
+    // Encodes blocks of 12 bytes (reading 16 at a time); returns the number of bytes consumed.
+    OXENC_TARGET_SSSE3 inline size_t b64_encode_ssse3(
+            const unsigned char* in, size_t n, char* out) {
+        size_t i = 0;
+        for (; i + 16 <= n; i += 12, out += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+            _mm_storeu_si128(
+                    reinterpret_cast<__m128i*>(out), b64_translate_ssse3(b64_split_ssse3(v)));
+        }
+        return i;
+    }
+
+    OXENC_TARGET_AVX2 inline __m256i b64_translate_avx2(__m256i indices) {
+        const __m256i offsets = _mm256_setr_epi8(
+                'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+                'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+        __m256i cls = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+        __m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+        cls = _mm256_or_si256(cls, _mm256_and_si256(upper, _mm256_set1_epi8(13)));
+        return _mm256_add_epi8(_mm256_shuffle_epi8(offsets, cls), indices);
+    }
+
+    OXENC_TARGET_AVX2 inline __m256i b64_split_avx2(__m256i in) {
+        in = _mm256_shuffle_epi8(
+                in,
+                _mm256_set_epi8(
+                        10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+                        10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+        __m256i ac = _mm256_mulhi_epu16(
+                _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00)),
+                _mm256_set1_epi32(0x04000040));
+        __m256i bd = _mm256_mullo_epi16(
+                _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0)),
+                _mm256_set1_epi32(0x01000010));
+        return _mm256_or_si256(ac, bd);
+    }
+
+    // Encodes blocks of 24 bytes (12 per 128-bit lane); returns the number of bytes consumed.
+    OXENC_TARGET_AVX2 inline size_t b64_encode_avx2(const unsigned char* in, size_t n, char* out) {
+        size_t i = 0;
+        for (; i + 28 <= n; i += 24, out += 32) {
+            __m256i v = _mm256_inserti128_si256(
+                    _mm256_castsi128_si256(
+                            _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i))),
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 12)),
+                    1);
+            _mm256_storeu_si256(
+                    reinterpret_cast<__m256i*>(out), b64_translate_avx2(b64_split_avx2(v)));
+        }
+        return i;
+    }
+
+    // Converts 16 base64 characters to their 6-bit values in place; returns false (without
+    // converting) if any of them are not base64 characters.
+    OXENC_TARGET_SSSE3 inline bool b64_values_ssse3(__m128i& v) {
+        // Every character gets a class bit from its low nibble and one from its high nibble;
+        // valid characters are exactly those where the two don't overlap.
+        const __m128i lut_lo = _mm_setr_epi8(
+                0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+        const __m128i lut_hi = _mm_setr_epi8(
+                0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+        const __m128i lut_roll =
+                _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+        const __m128i mask_2f = _mm_set1_epi8(0x2f);
+        __m128i hi_nibbles = _mm_and_si128(_mm_srli_epi32(v, 4), mask_2f);
+        __m128i lo = _mm_shuffle_epi8(lut_lo, _mm_and_si128(v, mask_2f));
+        __m128i hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128())) !=
+            0xffff)
+            return false;
+        // '/' is the only character that needs a different offset from the rest of its high
+        // nibble group, so nudge its lookup index down by one:
+        __m128i eq_2f = _mm_cmpeq_epi8(v, mask_2f);
+        v = _mm_add_epi8(v, _mm_shuffle_epi8(lut_roll, _mm_add_epi8(eq_2f, hi_nibbles)));
+        return true;
+    }
+
+    // Packs 16 6-bit values into the first 12 bytes of the result
+    OXENC_TARGET_SSSE3 inline __m128i b64_pack_ssse3(__m128i v) {
+        __m128i merged = _mm_maddubs_epi16(v, _mm_set1_epi32(0x01400140));
+        merged = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+        return _mm_shuffle_epi8(
+                merged, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+    }
+
+    // Decodes blocks of 16 characters (writing 16 bytes, of which 12 are used).  Stops at the
+    // first block that contains a non-base64 character; returns the number of chars consumed.
+    // Never touches the last 8 characters of the input, and so never sees padding.
+    OXENC_TARGET_SSSE3 inline size_t b64_decode_ssse3(
+            const char* in, size_t n, unsigned char* out) {
+        size_t i = 0;
+        for (; i + 24 <= n; i += 16, out += 12) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+            if (!b64_values_ssse3(v))
+                break;
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), b64_pack_ssse3(v));
+        }
+        return i;
+    }
+
+    OXENC_TARGET_SSSE3 inline size_t b64_validate_ssse3(const char* in, size_t n) {
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+            if (!b64_values_ssse3(v))
+                break;
+        }
+        return i;
+    }
+
+    OXENC_TARGET_AVX2 inline bool b64_values_avx2(__m256i& v) {
+        const __m256i lut_lo = _mm256_setr_epi8(
+                0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a,
+                0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+        const __m256i lut_hi = _mm256_setr_epi8(
+                0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+                0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+        const __m256i lut_roll = _mm256_setr_epi8(
+                0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+                0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+        const __m256i mask_2f = _mm256_set1_epi8(0x2f);
+        __m256i hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(v, 4), mask_2f);
+        __m256i lo = _mm256_shuffle_epi8(lut_lo, _mm256_and_si256(v, mask_2f));
+        __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+        if (!_mm256_testz_si256(lo, hi))
+            return false;
+        __m256i eq_2f = _mm256_cmpeq_epi8(v, mask_2f);
+        v = _mm256_add_epi8(v, _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(eq_2f, hi_nibbles)));
+        return true;
+    }
+
+    // Decodes blocks of 32 characters into 24 bytes.  Writes 32 bytes at a time (of which 24 are
+    // used), and never touches the last 16 characters of the input.
+    OXENC_TARGET_AVX2 inline size_t b64_decode_avx2(const char* in, size_t n, unsigned char* out) {
+        size_t i = 0;
+        for (; i + 48 <= n; i += 32, out += 24) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+            if (!b64_values_avx2(v))
+                break;
+            __m256i merged = _mm256_maddubs_epi16(v, _mm256_set1_epi32(0x01400140));
+            merged = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+            merged = _mm256_shuffle_epi8(
+                    merged,
+                    _mm256_setr_epi8(
+                            2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                            2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+            // Move the 12 used bytes of each lane together:
+            merged = _mm256_permutevar8x32_epi32(
+                    merged, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), merged);
+        }
+        return i;
+    }
+
+    OXENC_TARGET_AVX2 inline size_t b64_validate_avx2(const char* in, size_t n) {
+        size_t i = 0;
+        for (; i + 32 <= n; i += 32) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+            if (!b64_values_avx2(v))
+                break;
+        }
+        return i;
+    }
+#endif
+
+    inline char* b64_encode_bulk(const unsigned char* in, size_t n, char* out, bool padded) {
+#ifdef OXENC_SIMD_X86
+        size_t done = 0;
+        auto level = simd();
+        if (level >= simd_level::avx2)
+            done = b64_encode_avx2(in, n, out);
+        if (level >= simd_level::ssse3)
+            done += b64_encode_ssse3(in + done, n - done, out + done / 3 * 4);
+        in += done;
+        out += done / 3 * 4;
+        n -= done;
+#endif
+        return b64_encode_portable(in, n, out, padded);
+    }
+
+    // Decodes `n` base64 characters, with or without padding, into `out` (which must have room
+    // for `from_base64_size(n)` bytes).  Returns a pointer just past the last byte written, and
+    // clears `valid` if the input is not valid base64 (in which case the output is unspecified).
+    inline unsigned char* b64_decode_bulk(
+            const char* in, size_t n, unsigned char* out, bool& valid) {
+        valid = true;
+        if (n % 4 == 0 && n > 0 && in[n - 1] == '=')
+            n -= in[n - 2] == '=' ? 2 : 1;
+        if (n % 4 == 1) {
+            valid = false;
+            return out;
+        }
+#ifdef OXENC_SIMD_X86
+        size_t done = 0;
+        auto level = simd();
+        if (level >= simd_level::avx2)
+            done = b64_decode_avx2(in, n, out);
+        if (level >= simd_level::ssse3)
+            done += b64_decode_ssse3(in + done, n - done, out + done / 4 * 3);
+        in += done;
+        out += done / 4 * 3;
+        n -= done;
+#endif
+        return b64_decode_portable(in, n, out, valid);
+    }
+
+    // Returns true if all `n` characters are in the base64 alphabet.  (Does not allow padding).
+    inline bool b64_validate_bulk(const char* in, size_t n) {
+#ifdef OXENC_SIMD_X86
+        size_t done = 0;
+        auto level = simd();
+        if (level >= simd_level::avx2)
+            done = b64_validate_avx2(in, n);
+        if (level >= simd_level::ssse3)
+            done += b64_validate_ssse3(in + done, n - done);
+        in += done;
+        n -= done;
+#endif
+        return b64_validate_portable(in, n);
+    }
+
 }  // namespace detail
 
 /// Returns the number of characters required to encode a base64 string from the given number of
@@ -95,8 +441,9 @@ struct base64_encoder final {
     using value_type = char;
     using reference = value_type;
     using pointer = void;
+    // Empty input encodes to nothing, even when padded (matching to_base64_size(0) == 0).
     constexpr base64_encoder(InputIt begin, InputIt end, bool padded = true) :
-            _it{std::move(begin)}, _end{std::move(end)}, padding{padded} {}
+            _it{std::move(begin)}, _end{std::move(end)}, padding{padded && _it != _end} {}
 
     constexpr base64_encoder end() { return {_end, _end, false}; }
 
@@ -159,8 +506,18 @@ struct base64_encoder final {
 template <typename InputIt, typename OutputIt>
 OutputIt to_base64(InputIt begin, InputIt end, OutputIt out, bool padded = true) {
     static_assert(sizeof(decltype(*begin)) == 1, "to_base64 requires chars/bytes");
-    auto it = base64_encoder{begin, end, padded};
-    return std::copy(it, it.end(), out);
+    if constexpr (detail::bulk_codec_iterators<InputIt, OutputIt>) {
+        auto* o = reinterpret_cast<char*>(std::to_address(out));
+        auto* e = detail::b64_encode_bulk(
+                reinterpret_cast<const unsigned char*>(std::to_address(begin)),
+                static_cast<size_t>(end - begin),
+                o,
+                padded);
+        return out + (e - o);
+    } else {
+        auto it = base64_encoder{begin, end, padded};
+        return std::copy(it, it.end(), out);
+    }
 }
 
 /// Creates and returns a base64 string from an iterator pair of a character sequence.  The
@@ -168,13 +525,18 @@ OutputIt to_base64(InputIt begin, InputIt end, OutputIt out, bool padded = true)
 template <typename It>
 std::string to_base64(It begin, It end) {
     std::string base64;
-    if constexpr (std::is_base_of_v<
-                          std::random_access_iterator_tag,
-                          typename std::iterator_traits<It>::iterator_category>) {
-        using std::distance;
-        base64.reserve(to_base64_size(static_cast<size_t>(distance(begin, end))));
+    if constexpr (std::contiguous_iterator<It>) {
+        base64.resize(to_base64_size(static_cast<size_t>(end - begin)));
+        to_base64(begin, end, base64.data());
+    } else {
+        if constexpr (std::is_base_of_v<
+                              std::random_access_iterator_tag,
+                              typename std::iterator_traits<It>::iterator_category>) {
+            using std::distance;
+            base64.reserve(to_base64_size(static_cast<size_t>(distance(begin, end))));
+        }
+        to_base64(begin, end, std::back_inserter(base64));
     }
-    to_base64(begin, end, std::back_inserter(base64));
     return base64;
 }
 
@@ -183,13 +545,18 @@ std::string to_base64(It begin, It end) {
 template <typename It>
 std::string to_base64_unpadded(It begin, It end) {
     std::string base64;
-    if constexpr (std::is_base_of_v<
-                          std::random_access_iterator_tag,
-                          typename std::iterator_traits<It>::iterator_category>) {
-        using std::distance;
-        base64.reserve(to_base64_size(static_cast<size_t>(distance(begin, end)), false));
+    if constexpr (std::contiguous_iterator<It>) {
+        base64.resize(to_base64_size(static_cast<size_t>(end - begin), false));
+        to_base64(begin, end, base64.data(), false);
+    } else {
+        if constexpr (std::is_base_of_v<
+                              std::random_access_iterator_tag,
+                              typename std::iterator_traits<It>::iterator_category>) {
+            using std::distance;
+            base64.reserve(to_base64_size(static_cast<size_t>(distance(begin, end)), false));
+        }
+        to_base64(begin, end, std::back_inserter(base64), false);
     }
-    to_base64(begin, end, std::back_inserter(base64), false);
     return base64;
 }
 
@@ -245,6 +612,14 @@ constexpr bool is_base64(It begin, It end) {
             end = last;
     }
 
+    if constexpr (std::contiguous_iterator<It>) {
+        if (!std::is_constant_evaluated())
+            return detail::b64_validate_bulk(
+                    reinterpret_cast<const char*>(std::to_address(begin)),
+                    static_cast<size_t>(end - begin));
+    }
+
+    // Non-contiguous input, or constant evaluation (where the bulk validator can't be used):
     for (; begin != end; ++begin) {
         auto c = static_cast<unsigned char>(*begin);
         if (detail::b64_lut.from_b64(c) == 0 && c != 'A')
@@ -363,6 +738,21 @@ struct base64_decoder final {
 template <typename InputIt, typename OutputIt>
 constexpr OutputIt from_base64(InputIt begin, InputIt end, OutputIt out) {
     static_assert(sizeof(decltype(*begin)) == 1, "from_base64 requires chars/bytes");
+    if constexpr (detail::bulk_codec_iterators<InputIt, OutputIt>) {
+        if (!std::is_constant_evaluated()) {
+            // The bulk decoder validates as it goes, so we don't need a separate is_base64 pass
+            bool valid;
+            auto* o = reinterpret_cast<unsigned char*>(std::to_address(out));
+            auto* e = detail::b64_decode_bulk(
+                    reinterpret_cast<const char*>(std::to_address(begin)),
+                    static_cast<size_t>(end - begin),
+                    o,
+                    valid);
+            assert(valid);
+            (void)valid;
+            return out + (e - o);
+        }
+    }
     assert(is_base64(begin, end));
     base64_decoder it{begin, end};
     auto bend = it.end();
@@ -376,13 +766,18 @@ constexpr OutputIt from_base64(InputIt begin, InputIt end, OutputIt out) {
 template <typename It>
 std::string from_base64(It begin, It end) {
     std::string bytes;
-    if constexpr (std::is_base_of_v<
-                          std::random_access_iterator_tag,
-                          typename std::iterator_traits<It>::iterator_category>) {
-        using std::distance;
-        bytes.reserve(from_base64_size(static_cast<size_t>(distance(begin, end))));
+    if constexpr (std::contiguous_iterator<It>) {
+        bytes.resize(from_base64_size(static_cast<size_t>(end - begin)));
+        bytes.erase(from_base64(begin, end, bytes.begin()), bytes.end());
+    } else {
+        if constexpr (std::is_base_of_v<
+                              std::random_access_iterator_tag,
+                              typename std::iterator_traits<It>::iterator_category>) {
+            using std::distance;
+            bytes.reserve(from_base64_size(static_cast<size_t>(distance(begin, end))));
+        }
+        from_base64(begin, end, std::back_inserter(bytes));
     }
-    from_base64(begin, end, std::back_inserter(bytes));
     return bytes;
 }
 
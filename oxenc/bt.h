@@ -1,5 +1,9 @@
 #pragma once
+#include "bt_message_template.h"
 #include "bt_producer.h"
 #include "bt_serialize.h"
+#include "bt_stream_parser.h"
+#include "bt_struct.h"
 #include "bt_value.h"
+#include "bt_value_arena.h"
 #include "bt_value_producer.h"
@@ -0,0 +1,227 @@
+#pragma once
+
+#include <algorithm>
+#include <concepts>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "bt_producer.h"
+#include "bt_serialize.h"
+
+namespace oxenc {
+
+/** \file
+ * Precomputed message templates, for sending many messages that have the same structure but differ
+ * in a few values (such as a ping with a changing id and timestamp).  The template is built once,
+ * using the usual bt_dict_producer/bt_list_producer interface plus "holes" where the variable
+ * values go:
+ *
+ *     const auto ping = oxenc::bt_message_template::dict([](auto& d, auto& hole) {
+ *         hole(d, "id");
+ *         d.append("method", "ping");
+ *         auto p = d.append_dict("params");
+ *         p.append("version", "1.2.3");
+ *         hole(p, "when");
+ *     });
+ *
+ * and then each message is produced by filling in the holes, in order:
+ *
+ *     std::string msg = ping.fill(next_id++, now);
+ *     // msg is "d2:idi123e6:method4:ping6:paramsd7:version5:1.2.34:wheni1700000000ee"
+ *
+ * Filling a template computes the exact size of the message, and then just copies the constant
+ * parts (every key, delimiter, and constant value) around the formatted hole values.
+ *
+ * Hole values can be integers (including bools) or strings (anything convertible to a
+ * string_view, or an unsigned char or std::byte string_view).
+ */
+class bt_message_template {
+    std::string skeleton_;
+    std::vector<size_t> holes_;  // Positions in skeleton_ where the hole values go (ascending)
+
+    bt_message_template() = default;
+
+    template <typename T>
+    static size_t value_size(const T& val) {
+        if constexpr (std::same_as<T, bool>)
+            return 3;
+        else if constexpr (std::integral<T>)
+            return 2 + detail::integer_chars(val);
+        else {
+            auto size = string_view_of(val).size();
+            return detail::integer_chars(size) + 1 + size;
+        }
+    }
+
+    template <typename T>
+    static std::string_view string_view_of(const T& val) {
+        if constexpr (std::convertible_to<T, std::string_view>)
+            return val;
+        else if constexpr (std::convertible_to<T, std::basic_string_view<unsigned char>>)
+            return detail::to_sv(std::basic_string_view<unsigned char>{val});
+        else {
+            static_assert(
+                    std::convertible_to<T, std::basic_string_view<std::byte>>,
+                    "bt_message_template values must be integers or strings");
+            return detail::to_sv(std::basic_string_view<std::byte>{val});
+        }
+    }
+
+    template <typename T>
+    static char* write_value(const T& val, char* out) {
+        if constexpr (std::same_as<T, bool>) {
+            *out++ = 'i';
+            *out++ = val ? '1' : '0';
+            *out++ = 'e';
+        } else if constexpr (std::integral<T>) {
+            *out++ = 'i';
+            out = detail::write_integer(val, out);
+            *out++ = 'e';
+        } else {
+            auto s = string_view_of(val);
+            out = detail::write_integer(s.size(), out);
+            *out++ = ':';
+            out = std::copy(s.begin(), s.end(), out);
+        }
+        return out;
+    }
+
+    template <typename... T>
+    void check_count() const {
+        if (sizeof...(T) != holes_.size())
+            throw std::invalid_argument{
+                    "bt_message_template: expected " + std::to_string(holes_.size()) +
+                    " values, got " + std::to_string(sizeof...(T))};
+    }
+
+    template <typename... T>
+    char* write(char* out, const T&... values) const {
+        const char* skel = skeleton_.data();
+        size_t pos = 0;
+        auto it = holes_.begin();
+        [[maybe_unused]] auto write_one = [&](const auto& val) {
+            out = std::copy(skel + pos, skel + *it, out);
+            pos = *it++;
+            out = write_value(val, out);
+        };
+        (write_one(values), ...);
+        return std::copy(skel + pos, skel + skeleton_.size(), out);
+    }
+
+    // Removes the placeholder values that mark the holes from the encoded skeleton.
+    void finalize(std::string_view encoded);
+
+  public:
+    /// Adds holes to a template being built; this is passed to the function building the template.
+    class hole_maker {
+        friend class bt_message_template;
+
+        const bt_list_producer* list_root_ = nullptr;
+        const bt_dict_producer* dict_root_ = nullptr;
+        std::vector<size_t> holes_;
+
+        explicit hole_maker(const bt_list_producer& root) : list_root_{&root} {}
+        explicit hole_maker(const bt_dict_producer& root) : dict_root_{&root} {}
+
+        // Records a hole for a value (a two-byte placeholder) just appended to `p`.
+        template <typename Producer>
+        void add(const Producer& p) {
+            const char* base = dict_root_ ? dict_root_->view().data() : list_root_->view().data();
+            // end() is just past this producer's closing `e`, which follows the placeholder:
+            holes_.push_back(static_cast<size_t>(p.end() - base) - 3);
+        }
+
+      public:
+        /// Adds a hole for the value of `key` in dict `d` (which must be the template's dict or a
+        /// dict nested within it).
+        void operator()(bt_dict_producer& d, std::string_view key) {
+            d.append(key, ""sv);
+            add(d);
+        }
+
+        /// Adds a hole for the next element of list `l` (which must be the template's list or a
+        /// list nested within it).
+        void operator()(bt_list_producer& l) {
+            l.append(""sv);
+            add(l);
+        }
+    };
+
+    /// Builds a template for a dict message by calling `build` with a bt_dict_producer and a
+    /// hole_maker, i.e. `build(bt_dict_producer& d, bt_message_template::hole_maker& hole)`.
+    template <std::invocable<bt_dict_producer&, hole_maker&> Build>
+    static bt_message_template dict(Build&& build) {
+        bt_dict_producer d;
+        hole_maker holes{d};
+        build(d, holes);
+        bt_message_template t;
+        t.holes_ = std::move(holes.holes_);
+        t.finalize(d.view());
+        return t;
+    }
+
+    /// Builds a template for a list message by calling `build` with a bt_list_producer and a
+    /// hole_maker, i.e. `build(bt_list_producer& l, bt_message_template::hole_maker& hole)`.
+    template <std::invocable<bt_list_producer&, hole_maker&> Build>
+    static bt_message_template list(Build&& build) {
+        bt_list_producer l;
+        hole_maker holes{l};
+        build(l, holes);
+        bt_message_template t;
+        t.holes_ = std::move(holes.holes_);
+        t.finalize(l.view());
+        return t;
+    }
+
+    /// Returns the number of holes, i.e. the number of values that must be given to fill().
+    size_t holes() const { return holes_.size(); }
+
+    /// Returns the template with the holes left out.  (This is *not* valid bt-encoded data unless
+    /// there are no holes).
+    std::string_view skeleton() const { return skeleton_; }
+
+    /// Returns the size of the message produced by filling the holes with the given values.
+    template <typename... T>
+    size_t size(const T&... values) const {
+        check_count<T...>();
+        return skeleton_.size() + (value_size(values) + ... + 0);
+    }
+
+    /// Fills the holes of the template with the given values, returning the encoded message.
+    /// Throws std::invalid_argument if the number of values is not equal to the number of holes.
+    template <typename... T>
+    std::string fill(const T&... values) const {
+        std::string out;
+        out.resize(size(values...));
+        write(out.data(), values...);
+        return out;
+    }
+
+    /// Fills the holes of the template with the given values, writing the message into the buffer
+    /// [begin, end), and returns a view of the written message.  Throws std::length_error if the
+    /// buffer is too small.
+    template <typename... T>
+    std::string_view fill_into(char* begin, char* end, const T&... values) const {
+        auto n = size(values...);
+        if (n > static_cast<size_t>(end - begin))
+            throw std::length_error{"Cannot fill bt_message_template: buffer size exceeded"};
+        write(begin, values...);
+        return {begin, n};
+    }
+};
+
+inline void bt_message_template::finalize(std::string_view encoded) {
+    skeleton_.reserve(encoded.size() - 2 * holes_.size());
+    size_t pos = 0;
+    for (size_t i = 0; i < holes_.size(); i++) {
+        auto hole = holes_[i];
+        skeleton_.append(encoded.substr(pos, hole - pos));
+        pos = hole + 2;  // Skip the "0:" placeholder
+        holes_[i] = hole - 2 * i;
+    }
+    skeleton_.append(encoded.substr(pos));
+}
+
+}  // namespace oxenc
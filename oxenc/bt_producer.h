@@ -1,8 +1,11 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <cassert>
 #include <charconv>
 #include <concepts>
+#include <memory>
 #include <optional>
 #include <stdexcept>
 #include <string>
@@ -10,6 +13,7 @@
 #include <type_traits>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 #ifndef NDEBUG
 #include "bt_serialize.h"
@@ -22,39 +26,6 @@ namespace oxenc {
 
 class bt_dict_producer;
 
-#if defined(__APPLE__) && defined(__MAC_OS_X_VERSION_MIN_REQUIRED) && \
-        __MAC_OS_X_VERSION_MIN_REQUIRED < 101500
-#define OXENC_APPLE_TO_CHARS_WORKAROUND
-/// Really simplistic version of std::to_chars on Apple, because Apple doesn't allow `std::to_chars`
-/// to be used if targetting anything before macOS 10.15.  The buffer must have at least 20 chars of
-/// space (for int types up to 64-bit); we return a pointer one past the last char written.
-template <typename IntType>
-char* apple_to_chars10(char* buf, IntType val) {
-    static_assert(std::integral<IntType> && sizeof(IntType) <= 8);
-    if constexpr (std::signed_integral<IntType>) {
-        if (val < 0) {
-            buf[0] = '-';
-            return apple_to_chars10(buf + 1, static_cast<std::make_unsigned_t<IntType>>(-val));
-        }
-    }
-
-    // write it to the buffer in reverse (because we don't know how many chars we'll need yet, but
-    // writing in reverse will figure that out).
-    char* pos = buf;
-    do {
-        *pos++ = '0' + static_cast<char>(val % 10);
-        val /= 10;
-    } while (val > 0);
-
-    // Reverse the digits into the right order
-    int swaps = (pos - buf) / 2;
-    for (int i = 0; i < swaps; i++)
-        std::swap(buf[i], pos[-1 - i]);
-
-    return pos;
-}
-#endif
-
 namespace detail {
 
     template <basic_char Char>
@@ -93,11 +64,107 @@ namespace detail {
     }
 }  // namespace detail
 
+/// A dict key given as a compile-time constant, for the bt_dict_producer methods that take their
+/// key as a template argument (such as `d.append<"id">(123)`), which check the key order at
+/// compile time and write a precomputed key encoding.
+template <size_t N>
+struct bt_key {
+    char str[N]{};
+
+    consteval bt_key(const char (&s)[N]) {
+        for (size_t i = 0; i < N; i++)
+            str[i] = s[i];
+    }
+
+    /// Constructs from a constant string_view, which must have size N-1.
+    explicit consteval bt_key(std::string_view s) {
+        if (s.size() != N - 1)
+            throw std::logic_error{"bt_key size mismatch"};
+        for (size_t i = 0; i < N - 1; i++)
+            str[i] = s[i];
+    }
+
+    constexpr std::string_view view() const { return {str, N - 1}; }
+};
+
+namespace detail {
+
+    /// The encoded form ("<len>:<key>") of a compile-time key.
+    template <bt_key Key>
+    inline constexpr auto bt_key_encoded = [] {
+        constexpr size_t len = Key.view().size();
+        constexpr size_t digits = [] {
+            size_t d = 1;
+            for (size_t n = len; n >= 10; n /= 10)
+                d++;
+            return d;
+        }();
+        std::array<char, digits + 1 + len> enc{};
+        size_t n = len;
+        for (size_t i = digits; i > 0; n /= 10)
+            enc[--i] = static_cast<char>('0' + n % 10);
+        enc[digits] = ':';
+        for (size_t i = 0; i < len; i++)
+            enc[digits + 1 + i] = Key.str[i];
+        return enc;
+    }();
+
+    /// True if the given compile-time keys are in strictly ascending order.
+    template <bt_key... Keys>
+    consteval bool bt_keys_ascending() {
+        std::array<std::string_view, sizeof...(Keys)> keys{Keys.view()...};
+        for (size_t i = 1; i < keys.size(); i++)
+            if (!(keys[i - 1] < keys[i]))
+                return false;
+        return true;
+    }
+
+}  // namespace detail
+
+/// Tag type for constructing a bt_list_producer or bt_dict_producer in scatter-gather mode, in
+/// which string values of at least `min_ref_size` bytes are not copied into the producer's buffer
+/// but rather referenced in place.  The encoded value is then retrieved as a list of pieces (via
+/// `segments()` or `iovecs()`) suitable for passing to `writev`/`sendmsg`, rather than as a single
+/// string, which avoids copying large payloads.  For example:
+///
+///     oxenc::bt_dict_producer d{oxenc::bt_gather{}};
+///     d.append("data", big_payload);  // not copied!
+///     d.append("id", 123);
+///     auto iov = d.iovecs<iovec>();
+///     writev(fd, iov.data(), static_cast<int>(iov.size()));
+///
+/// Referenced strings (which can be keys, values, or `append_encoded` data) are not copied, and so
+/// must remain valid and unchanged until the pieces have been used.
+///
+/// `view()` and `end()` are not available in this mode as the data is not contiguous, but
+/// `view_for_signing()` (and thus `append_signature`) is: it copies the pieces, including any
+/// referenced strings, into a buffer held by the producer.
+struct bt_gather {
+    size_t min_ref_size = 1024;
+};
+
+/// Tag type for constructing a bt_list_producer or bt_dict_producer in chained mode, in which the
+/// encoded value is written into a chain of fixed-size blocks of `block_size` bytes, allocated as
+/// needed.  Unlike string mode, growing the output never reallocates or copies the data already
+/// written, and unlike external buffer mode there is no size limit.  The encoded value can be
+/// retrieved as one piece per block (via `segments()` or `iovecs()`), or flattened into a single
+/// string with `str()`.
+///
+/// As with `bt_gather`, `view()` and `end()` are not available in this mode, while
+/// `view_for_signing()` (and thus `append_signature`) signs a contiguous copy of the data.
+struct bt_chain {
+    size_t block_size = 16384;
+};
+
 /// Class that allows you to build a bt-encoded list manually, optionally without copying or
 /// allocating memory.  This is essentially the reverse of bt_list_consumer: where it lets you
 /// stream-parse a buffer, this class lets you build directly into a buffer.
 ///
 /// Out-of-buffer-space errors throw std::length_error when using an external buffer.
+///
+/// A producer can also be constructed in scatter-gather mode (see `bt_gather`), which avoids
+/// copying large string values into the producer at all, or in chained mode (see `bt_chain`), which
+/// builds large values without ever reallocating.
 class bt_list_producer {
     friend class bt_dict_producer;
 
@@ -107,8 +174,59 @@ class bt_list_producer {
         char* const end;
     };
 
-    // Our output type: either external buffer pointers, or a string that we build:
-    using output = std::variant<std::string, buf_span>;
+    // For scatter-gather mode we build a string, just as in string mode, except that large strings
+    // are not appended to it: instead we record the string along with the position in the buffer
+    // where it belongs.
+    struct gather_buf {
+        std::string buf;
+        std::vector<std::pair<size_t, std::string_view>> refs;  // (position, data), in order
+        size_t min_ref_size;
+        std::string flat;  // Contiguous copy of the data for view_for_signing()
+    };
+
+    // For chained mode we write into a list of fixed-size blocks.  Positions (such as `next`) are
+    // offsets into the concatenation of the blocks.
+    struct chain_buf {
+        std::vector<std::unique_ptr<char[]>> blocks;
+        size_t block_size;
+        size_t size = 0;   // The amount of data written, including the trailing e's
+        std::string flat;  // Contiguous copy of the data for view_for_signing()
+
+        // Calls `f(char* dest, size_t offset, size_t len)` for each block-contained piece of the
+        // `n` bytes starting at `pos` (where `offset` is relative to `pos`), allocating blocks as
+        // needed.
+        template <typename F>
+        void for_each_piece(size_t pos, size_t n, F&& f) {
+            while (blocks.size() * block_size < pos + n)
+                blocks.emplace_back(new char[block_size]);
+            for (size_t done = 0; done < n;) {
+                auto off = (pos + done) % block_size;
+                auto len = std::min(n - done, block_size - off);
+                f(blocks[(pos + done) / block_size].get() + off, done, len);
+                done += len;
+            }
+        }
+
+        // Writes `d` at `pos`, replacing anything at or after `pos`.
+        void write(size_t pos, std::string_view d) {
+            for_each_piece(pos, d.size(), [&](char* dest, size_t offset, size_t len) {
+                std::copy(d.data() + offset, d.data() + offset + len, dest);
+            });
+            size = pos + d.size();
+        }
+
+        // Appends `count` copies of `c` at the end.
+        void fill(size_t count, char c) {
+            for_each_piece(size, count, [&](char* dest, size_t, size_t len) {
+                std::fill(dest, dest + len, c);
+            });
+            size += count;
+        }
+    };
+
+    // Our output type: either external buffer pointers, a string that we build, a string with
+    // references to large strings, or a chain of blocks:
+    using output = std::variant<std::string, buf_span, gather_buf, chain_buf>;
 
     // Our data for the root list is either a begin/end pointer pair or a string; for
     // sublists it is a pointer to the parent list/dict.
@@ -130,9 +248,20 @@ class bt_list_producer {
     // that started this list; `next` is the offset where the next value goes (which will always
     // have a closing `e` in it, to close the list; the `e` gets overwrite upon appending
     // another element).
+    //
+    // In lazy-close mode the closing `e`s are not written after each append, and only the
+    // innermost active producer's `next` is kept up to date: a parent's `next` gets updated when
+    // the child producer is destroyed.
     const size_t from;
     size_t next{from};
 
+    // The nesting depth of this producer: 1 for the root list/dict, 2 for its sublists/subdicts,
+    // and so on.  This is also the number of `e`s required to close everything that is open.
+    const size_t depth = 1;
+
+    // True if in lazy-close mode (inherited from the parent).
+    bool lazy = false;
+
     // Sublist constructors
     explicit bt_list_producer(bt_list_producer* parent, char prefix = 'l');
     explicit bt_list_producer(bt_dict_producer* parent, char prefix = 'l');
@@ -144,33 +273,40 @@ class bt_list_producer {
     // buffer mode.
     explicit bt_list_producer(char prefix, size_t reserve);
 
+    // Internal common constructor for both list and dict producer for scatter-gather mode.
+    bt_list_producer(char prefix, bt_gather g);
+
+    // Internal common constructor for both list and dict producer for chained mode.
+    bt_list_producer(char prefix, bt_chain c);
+
     // Does the actual appending to the buffer, and throwing if we'd overrun.
     void buffer_append(std::string_view d);
 
+    // Appends string data to the buffer, just like buffer_append, except that in scatter-gather
+    // mode a large string is referenced rather than copied.
+    void buffer_append_data(std::string_view d);
+
     // Appends the 'e's into the buffer to close off open sublists/dicts *without* advancing the
     // buffer position; we do this after each append so that the buffer always contains valid
     // encoded data, even while we are still appending to it, and so that appending something raises
     // a length_error if appending it would not leave enough space for the required e's to close the
-    // open list(s)/dict(s).
-    void append_intermediate_ends();
-
-    // Writes an integer to the given buffer; returns the one-past-the-data pointer.  Up to 20 bytes
-    // will be written and must be available in buf.  Used for both string and integer
-    // serialization.
-    template <typename IntType>
-    char* write_integer(IntType val, char* buf) {
-        static_assert(sizeof(IntType) <= 64);
-
-#ifndef OXENC_APPLE_TO_CHARS_WORKAROUND
-        auto [ptr, ec] = std::to_chars(buf, buf + 20, val);
-        assert(ec == std::errc());
-        return ptr;
-#else
-        // Hate apple.
-        return apple_to_chars10(buf, val);
-#endif
+    // open list(s)/dict(s).  Does nothing in lazy-close mode.
+    void append_intermediate_ends() {
+        if (!lazy)
+            write_ends(depth);
     }
 
+    // Writes `count` 'e's at `next` without advancing the buffer position.  (This only touches the
+    // output, not the producer, and so is const).
+    void write_ends(size_t count) const;
+
+    // In lazy-close mode, writes the closing `e` of this list/dict so that its value can be viewed;
+    // throws if there is an active sublist/subdict (as our `next` isn't up to date).
+    void lazy_end() const;
+
+    // Replaces the contents of `buf` with the concatenation of `segments()`, and returns it.
+    std::string_view flatten_into(std::string& buf) const;
+
     // Serializes an integer value and appends it to the output buffer.  Does not call
     // append_intermediate_ends().
     template <std::integral IntType>
@@ -180,7 +316,7 @@ class bt_list_producer {
         else {
             char buf[22];  // 'i' + base10 representation + 'e'
             buf[0] = 'i';
-            auto* ptr = write_integer(val, buf + 1);
+            auto* ptr = detail::write_integer(val, buf + 1);
             *ptr++ = 'e';
             buffer_append({buf, static_cast<size_t>(ptr - buf)});
         }
@@ -189,10 +325,10 @@ class bt_list_producer {
     // Appends a string value, but does not call append_intermediate_ends()
     void append_impl(std::string_view s) {
         char buf[21];  // length + ':'
-        auto* ptr = write_integer(s.size(), buf);
+        auto* ptr = detail::write_integer(s.size(), buf);
         *ptr++ = ':';
         buffer_append({buf, static_cast<size_t>(ptr - buf)});
-        buffer_append(s);
+        buffer_append_data(s);
     }
     void append_impl(std::basic_string_view<unsigned char> s) { append_impl(detail::to_sv(s)); }
     void append_impl(std::basic_string_view<std::byte> s) { append_impl(detail::to_sv(s)); }
@@ -217,19 +353,30 @@ class bt_list_producer {
     /// be passed a non-zero value to reserve an initial size in the std::string.
     explicit bt_list_producer(size_t reserve = 0) : bt_list_producer{'l', reserve} {}
 
+    /// Constructs a list producer in scatter-gather mode; see `bt_gather`.
+    explicit bt_list_producer(bt_gather g) : bt_list_producer{'l', g} {}
+
+    /// Constructs a list producer in chained mode; see `bt_chain`.
+    explicit bt_list_producer(bt_chain c) : bt_list_producer{'l', c} {}
+
     ~bt_list_producer();
 
     /// Returns a string_view into the currently serialized data buffer.  Note that the returned
     /// view includes the `e` list end serialization markers which will be overwritten if the list
     /// (or an active sublist/subdict) is appended to.  Can optionally return a basic_string_view of
-    /// a char-like type other than char for convenience.
+    /// a char-like type other than char for convenience.  Throws logic_error in scatter-gather or
+    /// chained mode, where the data is not contiguous (use `segments()` instead).
     template <basic_char Char = char>
     std::basic_string_view<Char> view() const {
+        lazy_end();
         const char* x;
         if (auto* s = std::get_if<std::string>(&out))
             x = s->data();
+        else if (auto* bs = std::get_if<buf_span>(&out))
+            x = bs->init;
         else
-            x = var::get<buf_span>(out).init;
+            throw std::logic_error{
+                    "Cannot call bt_producer .view() in scatter-gather or chained mode"};
 
         return std::basic_string_view<Char>{
                 reinterpret_cast<const Char*>(x) + from, next - from + 1};
@@ -238,15 +385,31 @@ class bt_list_producer {
     /// Extracts the string, when not using buffer mode.  This is only usable on the root
     /// list/dict producer, and may only be used in rvalue context, as it destroys the internal
     /// buffer, such as: std::move(producer).str().  Throws logic_error if called on a
-    /// sublist/subdict, or on a external buffer producer.
+    /// sublist/subdict, or on a external buffer or scatter-gather producer.  In chained mode this
+    /// flattens the blocks into a single string.
     ///
     /// (If you just want a copy of the string, use `view()` instead).
     std::string str() && {
         if (parent())
             throw std::logic_error{"Cannot call bt_producer .str() on a sublist/subdict"};
+        if (auto* c = std::get_if<chain_buf>(&out)) {
+            std::string ret;
+            ret.reserve(c->size);
+            for (auto seg : segments())
+                ret += seg;
+            // Leave behind an empty producer
+            c->blocks.clear();
+            c->write(0, std::string_view{ret.data(), 1});
+            c->fill(1, 'e');
+            next = 1;
+            return ret;
+        }
         auto* s = std::get_if<std::string>(&out);
         if (!s)
-            throw std::logic_error{"Cannot call bt_producer .str() when using an external buffer"};
+            throw std::logic_error{
+                    "Cannot call bt_producer .str() when using an external buffer or "
+                    "scatter-gather mode"};
+        lazy_end();
 
         std::string ret;
         ret.swap(*s);
@@ -260,20 +423,85 @@ class bt_list_producer {
     /// Returns a reference to the `std::string`, when in string-builder mode.  Unlike `str()`, this
     /// method *can* be used on a subdict/sublist, but always returns a reference to the root
     /// object's string (unlike `.view()` which just returns the view of the current sub-producer).
+    /// In lazy-close mode the string will be missing closing `e`s unless `flush()` is called first.
     const std::string& str_ref() {
         if (auto* p = parent())
             return p->str_ref();
         if (auto* s = std::get_if<std::string>(&out))
             return *s;
-        throw std::logic_error{"Cannot call bt_producer .str_ref() when using an external buffer"};
+        throw std::logic_error{
+                "Cannot call bt_producer .str_ref() when not in string-builder mode"};
     }
 
-    /// Calls `.reserve()` on the underlying std::string, if using string-builder mode.
+    /// Calls `.reserve()` on the underlying std::string, if using string-builder or scatter-gather
+    /// mode.  (In scatter-gather mode this string excludes the referenced large strings).  In
+    /// chained mode this allocates enough blocks to hold `new_cap` bytes.
     void reserve(size_t new_cap) {
         if (auto* p = parent())
             return p->reserve(new_cap);
         if (auto* s = std::get_if<std::string>(&out))
             s->reserve(new_cap);
+        else if (auto* g = std::get_if<gather_buf>(&out))
+            g->buf.reserve(new_cap);
+        else if (auto* c = std::get_if<chain_buf>(&out))
+            c->for_each_piece(0, new_cap, [](char*, size_t, size_t) {});
+    }
+
+    /// Enables (or disables) lazy-close mode.  Normally every append rewrites the `e`s that close
+    /// the list and every enclosing list/dict so that the buffer always holds complete encoded
+    /// data, which costs time proportional to the nesting depth on every append.  In lazy-close
+    /// mode appends do not write any closing `e`s: each sublist/subdict writes its closing `e`
+    /// when it is destroyed, and the closing `e` of a list is written when it is viewed (via
+    /// `view()`, `view_for_signing()`, `segments()`, `end()`, or `str()`), or, for a root list
+    /// writing into an external buffer, when it is destroyed.  `flush()` can be called to
+    /// write all of the closing `e`s.
+    ///
+    /// In lazy-close mode `view()` (and friends) cannot be called on a list with an active
+    /// sublist/subdict.  When using an external buffer, appending still throws if there would not
+    /// be room left for the closing `e`s.
+    ///
+    /// This may only be called on the root list/dict, while it has no active sublist/subdict.
+    void lazy_close(bool enable = true) {
+        if (parent() || has_child)
+            throw std::logic_error{
+                    "bt_producer lazy-close mode can only be changed on the root list/dict while "
+                    "it has no active sublist/subdict"};
+        if (lazy && !enable)
+            write_ends(1);
+        lazy = enable;
+    }
+
+    /// In lazy-close mode, writes the `e`s that close this list and all enclosing lists/dicts so
+    /// that the buffer contains complete encoded data (as it always does when not in lazy-close
+    /// mode).  Throws if this list has an active sublist/subdict.  Does nothing when not in
+    /// lazy-close mode.
+    void flush() {
+        if (!lazy)
+            return;
+        if (has_child)
+            throw std::logic_error{"Cannot flush bt_producer with an active sublist/subdict"};
+        write_ends(depth);
+    }
+
+    /// Returns the currently serialized data as a sequence of pieces which, concatenated, give the
+    /// same value that `view()` would return (including the closing `e`s).  In scatter-gather mode
+    /// the pieces alternate between parts of the producer's buffer and referenced strings; in
+    /// chained mode there is one piece per block; in other modes there is just one piece, the same
+    /// as `view()`.  The pieces are invalidated by further appends.
+    std::vector<std::string_view> segments() const;
+
+    /// Same as `segments()`, but returns the pieces as a vector of `IOVec`s, where IOVec is a type
+    /// with `iov_base` and `iov_len` members (such as the POSIX `struct iovec`) that can be passed
+    /// directly to `writev` or `sendmsg`.
+    template <typename IOVec>
+    std::vector<IOVec> iovecs() const {
+        auto segs = segments();
+        std::vector<IOVec> iov(segs.size());
+        for (size_t i = 0; i < segs.size(); i++) {
+            iov[i].iov_base = const_cast<char*>(segs[i].data());
+            iov[i].iov_len = segs[i].size();
+        }
+        return iov;
     }
 
     /// Returns a view of the current serialized list values suitable for signing.  The returned
@@ -282,21 +510,34 @@ class bt_list_producer {
     /// thus includes all values added to the list so far.  Typically this doesn't need to be used
     /// directly but rather can use `append_signature` to generate an append a signature over a
     /// list's prior elements.
+    ///
+    /// In scatter-gather and chained modes the data is not contiguous, so this copies `segments()`
+    /// into a buffer held by the producer (which is overwritten by the next call) and returns a
+    /// view of that.
     template <typename Char = char>
     std::basic_string_view<Char> view_for_signing() const {
-        auto v = view<Char>();
+        std::string_view v;
+        if (auto* g = std::get_if<gather_buf>(&out))
+            v = flatten_into(g->flat);
+        else if (auto* c = std::get_if<chain_buf>(&out))
+            v = flatten_into(c->flat);
+        else
+            v = view();
         v.remove_suffix(1);
-        return v;
+        return {reinterpret_cast<const Char*>(v.data()), v.size()};
     }
 
     /// Returns the end position in the buffer.  (This is primarily useful for external buffer
-    /// mode, but still works in string mode).
+    /// mode, but still works in string mode).  Throws logic_error in scatter-gather or chained
+    /// mode.  In lazy-close mode this writes the closing `e` (as `view()` does), so the data up to
+    /// the returned position is complete.
     const char* end() const {
+        lazy_end();
         if (auto* s = std::get_if<std::string>(&out))
             return s->data() + next + 1;
-        auto* bs = std::get_if<buf_span>(&out);
-        assert(bs);
-        return bs->init + next + 1;
+        if (auto* bs = std::get_if<buf_span>(&out))
+            return bs->init + next + 1;
+        throw std::logic_error{"Cannot call bt_producer .end() in scatter-gather or chained mode"};
     }
 
     /// Appends an element containing binary string data
@@ -435,6 +676,9 @@ class bt_list_producer {
     /// The signing callable must return either a C string literal or a container of single-byte
     /// elements with contiguous storage with `data()` and `size()` members; e.g. `std::string`,
     /// `std::basic_string_view<std::byte>`, `std::array<unsigned char, 32>` and so on.
+    ///
+    /// In scatter-gather and chained modes the signed data is first copied into a contiguous
+    /// buffer (see `view_for_signing()`), including any referenced large strings.
     template <typename SignFunc>
     void append_signature(SignFunc&& sign) {
         auto result = detail::append_signature_helper(*this, std::forward<SignFunc>(sign));
@@ -457,7 +701,7 @@ class bt_list_producer {
         // on debug build, throw if `encoded` is invalid bt-encoded data
         (void)bt_deserialize<bt_value>(encoded);
 #endif
-        buffer_append(encoded);
+        buffer_append_data(encoded);
         append_intermediate_ends();
     }
 };
@@ -489,6 +733,47 @@ class bt_dict_producer : bt_list_producer {
     }
 #endif
 
+    // Appends a compile-time key and its integer value, in a single buffer append.  Does not call
+    // append_intermediate_ends().
+    template <bt_key Key, std::integral IntType>
+    void append_keyed_impl(IntType val) {
+        constexpr auto& key = detail::bt_key_encoded<Key>;
+        std::array<char, key.size() + 22> buf;  // key + 'i' + base10 representation + 'e'
+        auto* ptr = std::copy(key.begin(), key.end(), buf.data());
+        *ptr++ = 'i';
+        if constexpr (std::same_as<IntType, bool>)
+            *ptr++ = val ? '1' : '0';
+        else
+            ptr = detail::write_integer(val, ptr);
+        *ptr++ = 'e';
+        buffer_append({buf.data(), static_cast<size_t>(ptr - buf.data())});
+    }
+
+    // Appends a compile-time key and its string value.  Does not call append_intermediate_ends().
+    template <bt_key Key>
+    void append_keyed_impl(std::string_view s) {
+        constexpr auto& key = detail::bt_key_encoded<Key>;
+        std::array<char, key.size() + 21> buf;  // key + length + ':'
+        auto* ptr = std::copy(key.begin(), key.end(), buf.data());
+        ptr = detail::write_integer(s.size(), ptr);
+        *ptr++ = ':';
+        buffer_append({buf.data(), static_cast<size_t>(ptr - buf.data())});
+        buffer_append_data(s);
+    }
+    template <bt_key Key>
+    void append_keyed_impl(std::basic_string_view<unsigned char> s) {
+        append_keyed_impl<Key>(detail::to_sv(s));
+    }
+    template <bt_key Key>
+    void append_keyed_impl(std::basic_string_view<std::byte> s) {
+        append_keyed_impl<Key>(detail::to_sv(s));
+    }
+    template <bt_key Key, typename T>
+    void append_keyed_impl(const std::optional<T>& val) {
+        if (val)
+            append_keyed_impl<Key>(*val);
+    }
+
   public:
     /// Constructs a dict producer that writes into the range [begin, end).  If a write would go
     /// beyond the end of the buffer an exception is raised.  Note that this will happen during
@@ -504,6 +789,12 @@ class bt_dict_producer : bt_list_producer {
     /// be passed a non-zero value to reserve an initial size in the std::string.
     explicit bt_dict_producer(size_t reserve = 0) : bt_list_producer{'d', reserve} {}
 
+    /// Constructs a dict producer in scatter-gather mode; see `bt_gather`.
+    explicit bt_dict_producer(bt_gather g) : bt_list_producer{'d', g} {}
+
+    /// Constructs a dict producer in chained mode; see `bt_chain`.
+    explicit bt_dict_producer(bt_chain c) : bt_list_producer{'d', c} {}
+
     /// Returns a string_view (or basic_string_view<Char>) into the currently serialized data
     /// buffer.  Note that the returned view includes the `e` dict end serialization markers which
     /// will be overwritten if the dict (or an active sublist/subdict) is appended to.
@@ -515,7 +806,8 @@ class bt_dict_producer : bt_list_producer {
     /// Extracts the string, when not using buffer mode.  This is only usable on the root
     /// list/dict producer, and may only be used in rvalue context, as it destroys the internal
     /// buffer, such as: std::move(producer).str().  Throws logic_error if called on a
-    /// sublist/subdict, or on a external buffer producer.
+    /// sublist/subdict, or on a external buffer or scatter-gather producer.  In chained mode this
+    /// flattens the blocks into a single string.
     ///
     /// (If you just want a copy of the string, use `view()` instead).
     std::string str() && {
@@ -528,17 +820,37 @@ class bt_dict_producer : bt_list_producer {
     /// Returns a reference to the `std::string`, when in string-builder mode.  Unlike `str()`, this
     /// method *can* be used on a subdict/sublist, but always returns a reference to the root
     /// object's string (unlike `.view()` which just returns the view of the current sub-producer).
+    /// In lazy-close mode the string will be missing closing `e`s unless `flush()` is called first.
     const std::string& str_ref() { return bt_list_producer::str_ref(); }
 
-    /// Calls `.reserve()` on the underlying std::string, if using string-builder mode.
+    /// Calls `.reserve()` on the underlying std::string, if using string-builder or scatter-gather
+    /// mode, or allocates blocks in chained mode; see bt_list_producer::reserve().
     void reserve(size_t new_cap) { bt_list_producer::reserve(new_cap); }
 
+    /// Enables (or disables) lazy-close mode; see bt_list_producer::lazy_close().
+    void lazy_close(bool enable = true) { bt_list_producer::lazy_close(enable); }
+
+    /// Writes all closing `e`s in lazy-close mode; see bt_list_producer::flush().
+    void flush() { bt_list_producer::flush(); }
+
+    /// Returns the currently serialized data as a sequence of pieces; see
+    /// bt_list_producer::segments().
+    std::vector<std::string_view> segments() const { return bt_list_producer::segments(); }
+
+    /// Returns the currently serialized data as a vector of iovec-like pieces; see
+    /// bt_list_producer::iovecs().
+    template <typename IOVec>
+    std::vector<IOVec> iovecs() const {
+        return bt_list_producer::iovecs<IOVec>();
+    }
+
     /// Returns a view of the current serialized dict keys/values suitable for signing.  The
     /// returned value is the currently serialized dict data up to but not including the terminating
     /// `e` (since that `e` will be overwritten if another key is appended), and thus includes all
     /// keys and values added to the dict so far.  Typically this doesn't need to be used directly
     /// but rather can use `append_signature` to generate an append a signature over a dict's prior
-    /// fields.
+    /// fields.  (In scatter-gather and chained modes this is a view of a copy; see
+    /// bt_list_producer::view_for_signing()).
     template <typename Char = char>
     std::basic_string_view<Char> view_for_signing() const {
         return bt_list_producer::view_for_signing<Char>();
@@ -560,6 +872,29 @@ class bt_dict_producer : bt_list_producer {
         append_intermediate_ends();
     }
 
+    /// Appends one or more key-value pairs with string, integer, or optional (of string or
+    /// integer) values, where the keys are compile-time constants:
+    ///
+    ///     d.append<"id">(123);
+    ///     d.append<"method", "params", "~">("get", "", sig);
+    ///
+    /// The keys given together must be in ascending order, which is checked at compile time
+    /// (whether they come after keys appended earlier is only checked in debug builds, as with
+    /// the other append methods).  This is otherwise equivalent to appending each key and value
+    /// separately, but is faster: the key encodings are precomputed, and the buffer is closed
+    /// (with the trailing `e`s) just once at the end.
+    template <bt_key... Keys, typename... T>
+    requires(sizeof...(Keys) > 0 && sizeof...(Keys) == sizeof...(T))
+    void append(const T&... values) {
+        static_assert(
+                detail::bt_keys_ascending<Keys...>(), "bt_dict_producer keys must be ascending");
+        if (has_child)
+            throw std::logic_error{"Cannot append to list when a sublist is active"};
+        (check_incrementing_key(Keys.view()), ...);
+        (append_keyed_impl<Keys>(values), ...);
+        append_intermediate_ends();
+    }
+
     /// Appends an input list container as a sublist.  Equivalenet to append_list(tuple).  Note that
     /// this is not equivalent to the iterator pair overload above: that appends to the current
     /// list, while this one creates a new sublist and appends the container elements to that.
@@ -645,6 +980,17 @@ class bt_dict_producer : bt_list_producer {
         return bt_dict_producer{this};
     }
 
+    /// Same as above, but with a compile-time constant key (whose encoding is precomputed).
+    template <bt_key Key>
+    bt_dict_producer append_dict() {
+        if (has_child)
+            throw std::logic_error{
+                    "Cannot call append_dict while another nested list/dict is active"};
+        check_incrementing_key(Key.view());
+        buffer_append({detail::bt_key_encoded<Key>.data(), detail::bt_key_encoded<Key>.size()});
+        return bt_dict_producer{this};
+    }
+
     /// Appends a list to this dict with the given key (which must be ascii-larger than the previous
     /// key).  Returns a new bt_list_producer that references the parent dict.  The parent cannot be
     /// added to until the sublist is destroyed.
@@ -662,6 +1008,17 @@ class bt_dict_producer : bt_list_producer {
         return bt_list_producer{this};
     }
 
+    /// Same as above, but with a compile-time constant key (whose encoding is precomputed).
+    template <bt_key Key>
+    bt_list_producer append_list() {
+        if (has_child)
+            throw std::logic_error{
+                    "Cannot call append_list while another nested list/dict is active"};
+        check_incrementing_key(Key.view());
+        buffer_append({detail::bt_key_encoded<Key>.data(), detail::bt_key_encoded<Key>.size()});
+        return bt_list_producer{this};
+    }
+
     /// Appends a list to this dict with the given key (which must be ascii-larger than the previous
     /// key), and then appends the given iterator range to it.
     template <typename ForwardIt>
@@ -698,6 +1055,9 @@ class bt_dict_producer : bt_list_producer {
     /// Since the signature signs all previous values, it is typically recommended that the
     /// signature use a late-sorting key; "~" (which is 0x7e, and the last printable 7-bit ascii
     /// value) is suggested.
+    ///
+    /// In scatter-gather and chained modes the signed data is first copied into a contiguous
+    /// buffer (see `view_for_signing()`), including any referenced large strings.
     template <typename SignFunc>
     void append_signature(std::string_view key, SignFunc&& sign) {
         auto result = detail::append_signature_helper(*this, std::forward<SignFunc>(sign));
@@ -723,9 +1083,15 @@ class bt_dict_producer : bt_list_producer {
 };
 
 inline bt_list_producer::bt_list_producer(bt_list_producer* parent, char prefix) :
-        data{parent}, out{parent->out}, from{parent->next} {
+        data{parent},
+        out{parent->out},
+        from{parent->next},
+        depth{parent->depth + 1},
+        lazy{parent->lazy} {
     parent->has_child = true;
     buffer_append(std::string_view{&prefix, 1});
+    if (lazy)
+        return;
     append_intermediate_ends();
     for (; parent; parent = parent->parent())
         parent->next++;
@@ -737,9 +1103,16 @@ inline bt_list_producer::bt_list_producer(bt_dict_producer* parent, char prefix)
 }
 
 inline bt_list_producer::bt_list_producer(bt_list_producer&& other) :
-        data{std::move(other.data)}, out{other.out}, from{other.from}, next{other.next} {
+        data{std::move(other.data)},
+        out{other.out},
+        from{other.from},
+        next{other.next},
+        depth{other.depth},
+        lazy{other.lazy} {
     if (other.has_child)
         throw std::logic_error{"Cannot move bt_list/dict_producer with active sublists/subdicts"};
+    // The moved-from producer must not write a closing `e` when destroyed
+    other.lazy = false;
     var::visit(
             [](auto& x) {
                 if constexpr (!std::same_as<output&, decltype(x)>)
@@ -760,26 +1133,91 @@ inline void bt_list_producer::buffer_append(std::string_view d) {
     if (auto* s = std::get_if<std::string>(&out)) {
         s->resize(next);  // Truncate any trailing e's
         s->append(d);
+    } else if (auto* g = std::get_if<gather_buf>(&out)) {
+        g->buf.resize(next);
+        g->buf.append(d);
+    } else if (auto* c = std::get_if<chain_buf>(&out)) {
+        c->write(next, d);
     } else {
         auto* bs = std::get_if<buf_span>(&out);
         assert(bs);
         auto avail = static_cast<size_t>(std::distance(bs->init + next, bs->end));
-        if (d.size() > avail)
+        // In lazy-close mode we make sure there will still be room for the closing e's, since we
+        // aren't writing them now.
+        if (d.size() + (lazy ? depth : 0) > avail)
             throw std::length_error{"Cannot write bt_producer: buffer size exceeded"};
         std::copy(d.begin(), d.end(), bs->init + next);
     }
-    for (auto* p = this; p; p = p->parent())
-        p->next += d.size();
+    if (lazy)
+        next += d.size();
+    else
+        for (auto* p = this; p; p = p->parent())
+            p->next += d.size();
 }
 
-inline void bt_list_producer::append_intermediate_ends() {
-    size_t count = 0;
-    for (auto* p = this; p; p = p->parent())
-        count++;
+inline void bt_list_producer::buffer_append_data(std::string_view d) {
+    auto* g = std::get_if<gather_buf>(&out);
+    if (!g || d.size() < g->min_ref_size)
+        return buffer_append(d);
+    // The referenced data doesn't occupy any space in our buffer (and so doesn't advance `next`):
+    // it gets spliced in at this position by segments().
+    g->buf.resize(next);
+    g->refs.emplace_back(next, d);
+}
+
+inline std::vector<std::string_view> bt_list_producer::segments() const {
+    lazy_end();
+    if (auto* c = std::get_if<chain_buf>(&out)) {
+        std::vector<std::string_view> segs;
+        for (size_t pos = from; pos <= next;) {
+            auto off = pos % c->block_size;
+            auto len = std::min(next + 1 - pos, c->block_size - off);
+            segs.emplace_back(c->blocks[pos / c->block_size].get() + off, len);
+            pos += len;
+        }
+        return segs;
+    }
+    auto* g = std::get_if<gather_buf>(&out);
+    if (!g)
+        return {view()};
+
+    std::vector<std::string_view> segs;
+    std::string_view buf{g->buf};
+    // Skip references that precede this (sub)producer; a reference at `from` belongs to the value
+    // before our opening `l`/`d`, while one at `next` comes before our closing `e`.
+    auto it = std::upper_bound(
+            g->refs.begin(), g->refs.end(), from, [](size_t pos, const auto& ref) {
+                return pos < ref.first;
+            });
+    size_t pos = from;
+    for (; it != g->refs.end() && it->first <= next; ++it) {
+        if (it->first > pos)
+            segs.push_back(buf.substr(pos, it->first - pos));
+        segs.push_back(it->second);
+        pos = it->first;
+    }
+    segs.push_back(buf.substr(pos, next + 1 - pos));
+    return segs;
+}
+
+inline std::string_view bt_list_producer::flatten_into(std::string& buf) const {
+    buf.clear();
+    for (auto seg : segments())
+        buf += seg;
+    return buf;
+}
 
-    if (auto* s = std::get_if<std::string>(&out))
+inline void bt_list_producer::write_ends(size_t count) const {
+    if (auto* s = std::get_if<std::string>(&out)) {
+        s->resize(next);
         s->append(count, 'e');
-    else {
+    } else if (auto* g = std::get_if<gather_buf>(&out)) {
+        g->buf.resize(next);
+        g->buf.append(count, 'e');
+    } else if (auto* c = std::get_if<chain_buf>(&out)) {
+        c->size = next;
+        c->fill(count, 'e');
+    } else {
         auto* bs = std::get_if<buf_span>(&out);
         assert(bs);
         auto* begin = bs->init + next;
@@ -790,13 +1228,33 @@ inline void bt_list_producer::append_intermediate_ends() {
     }
 }
 
+inline void bt_list_producer::lazy_end() const {
+    if (!lazy)
+        return;
+    if (has_child)
+        throw std::logic_error{
+                "Cannot view a lazy-close bt_producer with an active sublist/subdict"};
+    write_ends(1);
+}
+
 inline bt_list_producer::~bt_list_producer() {
     auto* p = parent();
-    if (!p)
+    if (!p) {
+        // A lazy-close root writing into an external buffer writes its closing `e` (for which
+        // buffer_append always leaves room), since the buffer outlives us.
+        if (lazy && !has_child && std::holds_alternative<buf_span>(out))
+            write_ends(1);
         return;
+    }
     assert(!has_child);
     assert(p->has_child);
     p->has_child = false;
+    if (lazy) {
+        // Close ourself (there is always room for this in an external buffer, as buffer_append
+        // makes sure of it), and update the parent's position which we haven't been maintaining.
+        write_ends(1);
+        p->next = next + 1;
+    }
 }
 
 inline bt_list_producer::bt_list_producer(char* begin, char* end, char prefix) :
@@ -813,6 +1271,26 @@ inline bt_list_producer::bt_list_producer(char prefix, size_t reserve) :
     append_intermediate_ends();
 }
 
+inline bt_list_producer::bt_list_producer(char prefix, bt_gather g) :
+        data{gather_buf{{}, {}, g.min_ref_size, {}}},
+        out{*std::get_if<output>(&data)},
+        from{0},
+        next{0} {
+    buffer_append(std::string_view{&prefix, 1});
+    append_intermediate_ends();
+}
+
+inline bt_list_producer::bt_list_producer(char prefix, bt_chain c) :
+        data{chain_buf{{}, c.block_size, 0, {}}},
+        out{*std::get_if<output>(&data)},
+        from{0},
+        next{0} {
+    if (c.block_size == 0)
+        throw std::invalid_argument{"bt_producer chained mode requires a non-zero block size"};
+    buffer_append(std::string_view{&prefix, 1});
+    append_intermediate_ends();
+}
+
 inline bt_list_producer bt_list_producer::append_list() {
     if (has_child)
         throw std::logic_error{"Cannot call append_list while another nested list/dict is active"};
@@ -1,13 +1,19 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
 #include <concepts>
 #include <cstdint>
 #include <cstring>
 #include <functional>
 #include <limits>
+#include <map>
 #include <optional>
 #include <ostream>
+#include <ranges>
+#include <span>
 #include <sstream>
 #include <stdexcept>
 #include <string>
@@ -19,6 +25,7 @@
 
 #include "bt_value.h"
 #include "common.h"
+#include "endian.h"
 #include "variant.h"
 
 namespace oxenc {
@@ -44,9 +51,112 @@ namespace oxenc {
  * allocations (as long as you know the precise data structure layout).
  */
 
+/// Error codes reported by the non-throwing deserialization interfaces (bt_try_deserialize, and the
+/// `bt_error&`-taking consumer methods).
+enum class bt_errc : uint8_t {
+    ok = 0,
+    /// The data ended before the value being parsed was complete.
+    truncated,
+    /// A string length or integer value did not start with a 0-9 digit.
+    expected_digit,
+    /// An integer value does not fit into a 64-bit integer, or into the requested integer type.
+    integer_overflow,
+    /// A string length was not followed by a `:`.
+    expected_colon,
+    /// An integer or tuple was not terminated by an `e` where one was required.
+    expected_end,
+    /// The next value is valid, but is not of the requested type.  When this is returned nothing
+    /// has been consumed, and so the value can be tried as a different type.
+    wrong_type,
+    /// A nested value (such as a list element or dict value) is not of the requested type.
+    wrong_element_type,
+    /// A list does not have the number of elements required by the requested tuple type.
+    wrong_size,
+    /// Encountered a byte that does not begin any bt-encoded value.
+    invalid_value,
+    /// A dict key is not a string.
+    invalid_key,
+    /// A dict key is not greater than the previous key (bt-encoded dict keys must be unique and in
+    /// ascending order).
+    unsorted_key,
+    /// A dict key is not followed by a value.
+    missing_value,
+    /// Attempted to read a value (or dict key) past the end of a list or dict.
+    end_of_container,
+    /// A required dict key was not found.
+    missing_key,
+    /// Lists and/or dicts are nested more deeply than the maximum allowed depth.
+    too_deep,
+    /// The value was followed by unconsumed data.
+    trailing_data,
+    /// Deserialization failed in a custom bt_deserialize specialization (which reported the error
+    /// by throwing a bt_deserialize_invalid exception).
+    invalid,
+};
+
+/// Returns a static, human-readable description of a bt_errc value.
+constexpr const char* bt_errc_message(bt_errc code) {
+    switch (code) {
+        case bt_errc::ok: return "no error";
+        case bt_errc::truncated: return "unexpected end of data";
+        case bt_errc::expected_digit: return "expected a digit";
+        case bt_errc::integer_overflow: return "integer value out of range";
+        case bt_errc::expected_colon: return "expected ':' after string length";
+        case bt_errc::expected_end: return "expected 'e'";
+        case bt_errc::wrong_type: return "value has the wrong type";
+        case bt_errc::wrong_element_type: return "nested value has the wrong type";
+        case bt_errc::wrong_size: return "list has the wrong number of elements";
+        case bt_errc::invalid_value: return "invalid value; expected one of [0-9idl]";
+        case bt_errc::invalid_key: return "dict key is not a string";
+        case bt_errc::unsorted_key: return "dict keys are not in sorted order";
+        case bt_errc::missing_value: return "dict key is not followed by a value";
+        case bt_errc::end_of_container: return "reached the end of the list or dict";
+        case bt_errc::missing_key: return "required dict key not found";
+        case bt_errc::too_deep: return "lists/dicts are nested too deeply";
+        case bt_errc::trailing_data: return "data continues after the end of the value";
+        case bt_errc::invalid: return "invalid data";
+    }
+    return "unknown error";
+}
+
+/// Deserialization error returned by the non-throwing deserialization interfaces: an error code
+/// and the byte offset, relative to the beginning of the data being deserialized (or for
+/// consumers, to the beginning of the data the consumer was constructed with), at which the error
+/// was detected.  Converts to `true` if an error occurred.  This type never allocates; use
+/// `message()` for a (static) description suitable for logging.
+struct bt_error {
+    bt_errc code = bt_errc::ok;
+    size_t offset = 0;
+
+    explicit operator bool() const { return code != bt_errc::ok; }
+    const char* message() const { return bt_errc_message(code); }
+};
+
+/// The default maximum nesting depth of lists and dicts accepted when skipping, validating, or
+/// deserializing into bt_value/bt_flat_value.  Deeper data fails with bt_errc::too_deep.  (The
+/// limit can be changed for individual calls to bt_validate, and for individual consumers).
+inline constexpr size_t bt_default_max_depth = 256;
+
 /// Exception throw if deserialization fails
 class bt_deserialize_invalid : public std::invalid_argument {
+  public:
     using std::invalid_argument::invalid_argument;
+
+    /// Constructs from an error code, without an offset.
+    explicit bt_deserialize_invalid(bt_errc code) :
+            std::invalid_argument{"Deserialization failed: "s + bt_errc_message(code)},
+            error{code} {}
+
+    /// Constructs from an error code and offset.
+    explicit bt_deserialize_invalid(const bt_error& err) :
+            std::invalid_argument{
+                    "Deserialization failed at byte "s + std::to_string(err.offset) + ": " +
+                    err.message()},
+            error{err} {}
+
+    /// The error code (and offset, if known) of the failure, when thrown by the non-throwing
+    /// interface error handling.  For other errors this is left as `bt_errc::invalid`.
+    bt_error error{bt_errc::invalid};
 };
 
 /// A more specific subclass that is thown if the serialization type is an initial mismatch: for
@@ -55,11 +165,140 @@ class bt_deserialize_invalid : public std::invalid_argument {
 /// error will only be thrown when the input stream has not been advanced (and so can be tried for a
 /// different type).
 class bt_deserialize_invalid_type : public bt_deserialize_invalid {
+  public:
     using bt_deserialize_invalid::bt_deserialize_invalid;
 };
 
 namespace detail {
 
+    /// Output sink that bt_serialize<T> specializations write to.  This writes directly into
+    /// contiguous memory: either a std::string (which is grown as needed), a fixed, caller-provided
+    /// buffer (which throws std::length_error if it runs out of space), or a small internal buffer
+    /// that gets flushed to a std::ostream whenever it fills up.
+    ///
+    /// Whatever constructs the writer must call `finish()` once serialization is complete to
+    /// truncate the string to its final size, or flush the final data to the stream.
+    class bt_writer {
+        char* pos;
+        char* end;
+        char* begin;
+        std::string* str = nullptr;
+        std::ostream* os = nullptr;
+        // Staging buffer for ostream output (unused otherwise)
+        char stage[256];
+
+        // Makes room for at least `n` more bytes, or throws if that isn't possible.
+        void make_room(size_t n);
+
+      public:
+        /// Appends to the end of `s`, growing it as needed.
+        explicit bt_writer(std::string& s) : str{&s} {
+            auto used = s.size();
+            s.resize(std::max<size_t>(used + 64, s.capacity()));
+            begin = s.data();
+            pos = begin + used;
+            end = begin + s.size();
+        }
+
+        /// Writes into `buf`; throws a std::length_error if the serialized value doesn't fit.
+        explicit bt_writer(std::span<char> buf) :
+                pos{buf.data()}, end{buf.data() + buf.size()}, begin{buf.data()} {}
+
+        /// Writes to `o`, via a small internal buffer.
+        explicit bt_writer(std::ostream& o) :
+                pos{stage}, end{stage + sizeof(stage)}, begin{stage}, os{&o} {}
+
+        bt_writer(const bt_writer&) = delete;
+        bt_writer& operator=(const bt_writer&) = delete;
+
+        void put(char c) {
+            if (pos == end)
+                make_room(1);
+            *pos++ = c;
+        }
+
+        void write(std::string_view s) {
+            if (s.size() > static_cast<size_t>(end - pos)) {
+                if (os && s.size() >= sizeof(stage)) {
+                    // Too big to stage; flush what we have and send it along directly
+                    os->write(begin, pos - begin);
+                    pos = begin;
+                    os->write(s.data(), static_cast<std::streamsize>(s.size()));
+                    return;
+                }
+                make_room(s.size());
+            }
+            if (!s.empty())
+                std::memcpy(pos, s.data(), s.size());
+            pos += s.size();
+        }
+
+        template <std::integral T>
+        void write_integer(T val) {
+            if (end - pos < 20) {
+                // Might not need all 20, so go via a temporary buffer to avoid a spurious failure
+                // when writing into a (nearly) full fixed buffer.
+                char tmp[20];
+                write({tmp, static_cast<size_t>(detail::write_integer(val, tmp) - tmp)});
+                return;
+            }
+            pos = detail::write_integer(val, pos);
+        }
+
+        /// Finishes writing: resizes the string to the actual serialized size, or flushes any
+        /// buffered data to the ostream.  Returns the number of bytes written into the string or
+        /// span since the writer was constructed (or the start of the string when appending to a
+        /// string); for an ostream writer this returns 0.
+        size_t finish() {
+            if (os) {
+                os->write(begin, pos - begin);
+                pos = begin;
+                return 0;
+            }
+            auto size = static_cast<size_t>(pos - begin);
+            if (str)
+                str->resize(size);
+            return size;
+        }
+    };
+
+    inline void bt_writer::make_room(size_t n) {
+        if (str) {
+            auto used = static_cast<size_t>(pos - begin);
+            str->resize(std::max(str->size() * 2, used + n));
+            begin = str->data();
+            pos = begin + used;
+            end = begin + str->size();
+        } else if (os) {
+            os->write(begin, pos - begin);
+            pos = begin;
+            assert(n <= sizeof(stage));
+        } else {
+            throw std::length_error{"Cannot bt_serialize: buffer size exceeded"};
+        }
+    }
+
+    /// Returns the number of characters needed to write `val` in base 10 (including a `-` for
+    /// negative values).
+    template <std::integral T>
+    constexpr size_t integer_chars(T val) {
+        if constexpr (std::same_as<T, bool>)
+            return 1;
+        else {
+            size_t n = 1;
+            auto u = static_cast<std::make_unsigned_t<T>>(val);
+            if constexpr (std::signed_integral<T>) {
+                if (val < 0) {
+                    n++;
+                    u = static_cast<std::make_unsigned_t<T>>(0 - u);
+                }
+            }
+            for (; u >= 10; u /= 10)
+                n++;
+            return n;
+        }
+    }
+
     /// Reads digits into an unsigned 64-bit int.
     uint64_t extract_unsigned(std::string_view& s);
     // (Provide non-constant lvalue and rvalue ref functions so that we only accept explicit
@@ -67,24 +306,81 @@ namespace detail {
     inline uint64_t extract_unsigned(std::string_view&& s) {
         return extract_unsigned(s);
     }
+    /// Non-throwing version of the above: sets `val` and returns bt_errc::ok on success.
+    bt_errc extract_unsigned(std::string_view& s, uint64_t& val);
 
-    // Fallback base case; we only get here if none of the partial specializations below work
+    [[noreturn]] inline void throw_bt_error(bt_errc code) {
+        if (code == bt_errc::wrong_type)
+            throw bt_deserialize_invalid_type{code};
+        throw bt_deserialize_invalid{code};
+    }
+    [[noreturn]] inline void throw_bt_error(const bt_error& err) {
+        if (err.code == bt_errc::wrong_type)
+            throw bt_deserialize_invalid_type{err};
+        throw bt_deserialize_invalid{err};
+    }
+
+    /// Throws the appropriate bt_deserialize_invalid exception if `code` is not `bt_errc::ok`.
+    inline void bt_check(bt_errc code) {
+        if (code != bt_errc::ok) [[unlikely]]
+            throw_bt_error(code);
+    }
+
+    /// A wrong_type error from a nested value means something different from the outer value
+    /// having the wrong type (which also promises that nothing was consumed), so we translate it.
+    constexpr bt_errc bt_nested_errc(bt_errc code) {
+        return code == bt_errc::wrong_type ? bt_errc::wrong_element_type : code;
+    }
+
+    // Fallback base case; we only get here if none of the partial specializations below work.
+    //
+    // Each specialization provides `operator()(bt_writer&, const T&)` to write the value and
+    // `size(const T&)` which returns the exact number of bytes operator() will write.
     template <typename T>
     struct bt_serialize {
         static_assert(
                 std::is_void_v<T>, "Cannot serialize T: unsupported type for bt serialization");
     };
 
+    // Each specialization provides `operator()(std::string_view& s, T& val)` which deserializes
+    // from the beginning of `s` into `val`, removing the consumed data from `s`, and throws on
+    // failure.  The built-in specializations also provide a non-throwing
+    // `bt_errc parse(std::string_view& s, T& val)` which returns an error code instead of throwing,
+    // leaving `s` at (or near) the position of the error, upon which their operator() is built.
     template <typename T>
     struct bt_deserialize {
         static_assert(
                 std::is_void_v<T>, "Cannot deserialize T: unsupported type for bt deserialization");
     };
 
+    template <typename T>
+    concept bt_nothrow_deserializable = requires(bt_deserialize<T> d, std::string_view& s, T& val) {
+        { d.parse(s, val) } -> std::same_as<bt_errc>;
+    };
+
+    /// Deserializes a value without throwing a bt_deserialize_invalid, returning the error code
+    /// instead.  For deserializers that only provide the throwing operator() (such as custom
+    /// specializations) the exception is caught and converted.
+    template <typename T>
+    bt_errc bt_parse(std::string_view& s, T& val) {
+        if constexpr (bt_nothrow_deserializable<T>) {
+            return bt_deserialize<T>{}.parse(s, val);
+        } else {
+            try {
+                bt_deserialize<T>{}(s, val);
+            } catch (const bt_deserialize_invalid_type&) {
+                return bt_errc::wrong_type;
+            } catch (const bt_deserialize_invalid& e) {
+                return e.error.code;
+            }
+            return bt_errc::ok;
+        }
+    }
+
     /// Checks that we aren't at the end of a string view and throws if we are.
     inline void bt_need_more(const std::string_view& s) {
         if (s.empty())
-            throw bt_deserialize_invalid{"Unexpected end of string while deserializing"};
+            throw bt_deserialize_invalid{bt_errc::truncated};
     }
 
     using some64 = union {
@@ -97,6 +393,40 @@ namespace detail {
     /// is return in .first.  Throws an exception if the read value doesn't fit in a int64_t (if
     /// negative) or a uint64_t (if positive).  Removes consumed characters from the string_view.
     std::pair<some64, bool> bt_deserialize_integer(std::string_view& s);
+    /// Non-throwing version of the above: sets `val` and returns bt_errc::ok on success.
+    bt_errc bt_deserialize_integer(std::string_view& s, std::pair<some64, bool>& val);
+
+    /// Skips over the next value (of any type) without deserializing it.  Fails with
+    /// bt_errc::too_deep if the value contains lists/dicts nested more than `max_depth` deep.
+    bt_errc bt_skip_value(std::string_view& s, size_t max_depth = bt_default_max_depth);
+
+    /// Checks that the next value (of any type) is valid and advances past it.  If
+    /// `check_key_order` is true then this also requires that the keys of every dict are unique and
+    /// sorted.  On failure `s` is left at the position where the error was detected.
+    bt_errc bt_validate_value(std::string_view& s, bool check_key_order, size_t max_depth);
+
+    /// Same as bt_validate_value, but also calls the methods of `visitor` (see bt_visit) for each
+    /// element as it goes.
+    template <typename Visitor>
+    bt_errc bt_walk_value(
+            std::string_view& s, bool check_key_order, size_t max_depth, Visitor& visitor);
+
+    /// Visitor that ignores everything.
+    struct bt_null_visitor {};
+
+    /// Converts only to exactly T: used to detect whether a visitor has a method taking exactly T
+    /// (rather than something it would be implicitly converted to, e.g. int64_t to uint64_t).
+    template <typename T>
+    struct bt_exactly {
+        template <std::same_as<T> U>
+        operator U() const;
+    };
+
+    /// Deserializes any value into a bt_value or bt_flat_value (with the matching Dict and List
+    /// types).  If `View` is true then string values are stored as string_views into `s` rather
+    /// than being copied.
+    template <typename Value, typename Dict, typename List, bool View = false>
+    bt_errc bt_deserialize_value(std::string_view& s, Value& val, size_t max_depth);
 
     /// Integer specializations
     template <typename T>
@@ -105,53 +435,45 @@ namespace detail {
         static_assert(
                 sizeof(T) <= sizeof(uint64_t),
                 "Serialization of integers larger than uint64_t is not supported");
-        void operator()(std::ostream& os, const T& val) {
-            // Cast 1-byte types to a larger type to avoid iostream interpreting them as single
-            // characters
-            using output_type = std::conditional_t<
-                    (sizeof(T) > 1),
-                    T,
-                    std::conditional_t<std::signed_integral<T>, int, unsigned>>;
-            os << 'i' << static_cast<output_type>(val) << 'e';
+        void operator()(bt_writer& w, const T& val) {
+            w.put('i');
+            if constexpr (std::same_as<T, bool>)
+                w.put(val ? '1' : '0');
+            else
+                w.write_integer(val);
+            w.put('e');
         }
+        size_t size(const T& val) { return 2 + integer_chars(val); }
     };
 
     template <typename T>
     requires std::integral<T>
     struct bt_deserialize<T> {
-        void operator()(std::string_view& s, T& val) {
+        bt_errc parse(std::string_view& s, T& val) {
             constexpr uint64_t umax = static_cast<uint64_t>(std::numeric_limits<T>::max());
             constexpr int64_t smin = static_cast<int64_t>(std::numeric_limits<T>::min());
 
-            auto [v, neg] = bt_deserialize_integer(s);
+            std::string_view orig{s};
+            std::pair<some64, bool> parsed;
+            if (auto ec = bt_deserialize_integer(s, parsed); ec != bt_errc::ok)
+                return ec;
+            auto& [v, neg] = parsed;
 
-            if (std::signed_integral<T>) {
-                if (!neg) {
-                    if (v.u64 > umax)
-                        throw bt_deserialize_invalid(
-                                "Integer deserialization failed: found too-large value " +
-                                std::to_string(v.u64) + " > " + std::to_string(umax));
-                    val = static_cast<T>(v.u64);
-                } else {
-                    auto& sval = v.i64;
-                    if (!std::same_as<T, int64_t> && sval < smin)
-                        throw bt_deserialize_invalid(
-                                "Integer deserialization failed: found too-low value " +
-                                std::to_string(sval) + " < " + std::to_string(smin));
-                    val = static_cast<T>(sval);
-                }
+            bool out_of_range;
+            if constexpr (std::signed_integral<T>) {
+                out_of_range = neg ? !std::same_as<T, int64_t> && v.i64 < smin : v.u64 > umax;
+                val = neg ? static_cast<T>(v.i64) : static_cast<T>(v.u64);
             } else {
-                if (neg)
-                    throw bt_deserialize_invalid(
-                            "Integer deserialization failed: found negative value -" +
-                            std::to_string(v.i64) + " but type is unsigned");
-                if (!std::same_as<T, uint64_t> && v.u64 > umax)
-                    throw bt_deserialize_invalid(
-                            "Integer deserialization failed: found too-large value " +
-                            std::to_string(v.u64) + " > " + std::to_string(umax));
+                out_of_range = neg || (!std::same_as<T, uint64_t> && v.u64 > umax);
                 val = static_cast<T>(v.u64);
             }
+            if (out_of_range) {
+                s = orig;
+                return bt_errc::integer_overflow;
+            }
+            return bt_errc::ok;
         }
+        void operator()(std::string_view& s, T& val) { bt_check(parse(s, val)); }
     };
 
     extern template struct bt_deserialize<int64_t>;
@@ -159,46 +481,58 @@ namespace detail {
 
     template <>
     struct bt_serialize<std::string_view> {
-        void operator()(std::ostream& os, const std::string_view& val) {
-            os << val.size();
-            os.put(':');
-            os.write(val.data(), static_cast<std::streamsize>(val.size()));
+        void operator()(bt_writer& w, const std::string_view& val) {
+            w.write_integer(val.size());
+            w.put(':');
+            w.write(val);
+        }
+        size_t size(const std::string_view& val) {
+            return integer_chars(val.size()) + 1 + val.size();
         }
     };
     template <>
     struct bt_deserialize<std::string_view> {
-        void operator()(std::string_view& s, std::string_view& val);
+        bt_errc parse(std::string_view& s, std::string_view& val);
+        void operator()(std::string_view& s, std::string_view& val) { bt_check(parse(s, val)); }
     };
 
     /// String specialization
     template <>
     struct bt_serialize<std::string> {
-        void operator()(std::ostream& os, const std::string& val) {
-            bt_serialize<std::string_view>{}(os, val);
+        void operator()(bt_writer& w, const std::string& val) {
+            bt_serialize<std::string_view>{}(w, val);
         }
+        size_t size(const std::string& val) { return bt_serialize<std::string_view>{}.size(val); }
     };
     template <>
     struct bt_deserialize<std::string> {
-        void operator()(std::string_view& s, std::string& val) {
+        bt_errc parse(std::string_view& s, std::string& val) {
             std::string_view view;
-            bt_deserialize<std::string_view>{}(s, view);
-            val = {view.data(), view.size()};
+            auto ec = bt_deserialize<std::string_view>{}.parse(s, view);
+            if (ec == bt_errc::ok)
+                val = {view.data(), view.size()};
+            return ec;
         }
+        void operator()(std::string_view& s, std::string& val) { bt_check(parse(s, val)); }
     };
 
     /// char * and string literals -- we allow serialization for convenience, but not
     /// deserialization
     template <>
     struct bt_serialize<char*> {
-        void operator()(std::ostream& os, const char* str) {
-            bt_serialize<std::string_view>{}(os, {str, std::strlen(str)});
+        void operator()(bt_writer& w, const char* str) {
+            bt_serialize<std::string_view>{}(w, {str, std::strlen(str)});
+        }
+        size_t size(const char* str) {
+            return bt_serialize<std::string_view>{}.size({str, std::strlen(str)});
         }
     };
     template <size_t N>
     struct bt_serialize<char[N]> {
-        void operator()(std::ostream& os, const char* str) {
-            bt_serialize<std::string_view>{}(os, {str, N - 1});
+        void operator()(bt_writer& w, const char* str) {
+            bt_serialize<std::string_view>{}(w, {str, N - 1});
         }
+        size_t size(const char* str) { return bt_serialize<std::string_view>{}.size({str, N - 1}); }
     };
 
     /// Determines whether the type looks like something we can insert into (using
@@ -219,6 +553,21 @@ namespace detail {
     // Sanity checks:
     static_assert(bt_input_dict_container<bt_dict>);
     static_assert(bt_output_dict_container<bt_dict>);
+    static_assert(bt_input_dict_container<bt_flat_dict>);
+    static_assert(bt_output_dict_container<bt_flat_dict>);
+
+    /// True if T is a std::map using the default key ordering, in which case iteration is already
+    /// in the order we need for bt-encoded dicts (e.g. bt_dict) and we don't have to sort the keys.
+    /// This also holds for bt_flat_dict, which keeps its elements sorted and (like std::map) does
+    /// not allow keys to be modified through its iterators.
+    template <typename T>
+    constexpr bool bt_sorted_dict = false;
+    template <typename K, typename V, typename A>
+    inline constexpr bool bt_sorted_dict<std::map<K, V, std::less<K>, A>> = true;
+    template <typename K, typename V, typename A>
+    inline constexpr bool bt_sorted_dict<std::map<K, V, std::less<>, A>> = true;
+    template <>
+    inline constexpr bool bt_sorted_dict<bt_flat_dict> = true;
 
     /// Specialization for a dict-like container (such as an unordered_map).  We accept anything for
     /// a dict that is const iterable over something that looks like a pair with std::string for
@@ -227,52 +576,78 @@ namespace detail {
     struct bt_serialize<T> {
         using second_type = typename T::value_type::second_type;
         using ref_pair = std::reference_wrapper<const typename T::value_type>;
-        void operator()(std::ostream& os, const T& dict) {
-            os << 'd';
-            std::vector<ref_pair> pairs;
-            pairs.reserve(dict.size());
-            for (const auto& pair : dict)
-                pairs.emplace(pairs.end(), pair);
-            std::sort(pairs.begin(), pairs.end(), [](ref_pair a, ref_pair b) {
-                return a.get().first < b.get().first;
-            });
-            for (auto& ref : pairs) {
-                bt_serialize<std::string>{}(os, ref.get().first);
-                bt_serialize<second_type>{}(os, ref.get().second);
+        void operator()(bt_writer& w, const T& dict) {
+            w.put('d');
+            if constexpr (bt_sorted_dict<T>) {
+                for (const auto& [k, v] : dict) {
+                    bt_serialize<std::string_view>{}(w, k);
+                    bt_serialize<second_type>{}(w, v);
+                }
+            } else {
+                std::vector<ref_pair> pairs;
+                pairs.reserve(dict.size());
+                for (const auto& pair : dict)
+                    pairs.emplace(pairs.end(), pair);
+                std::sort(pairs.begin(), pairs.end(), [](ref_pair a, ref_pair b) {
+                    return a.get().first < b.get().first;
+                });
+                for (auto& ref : pairs) {
+                    bt_serialize<std::string_view>{}(w, ref.get().first);
+                    bt_serialize<second_type>{}(w, ref.get().second);
+                }
             }
-            os << 'e';
+            w.put('e');
+        }
+        size_t size(const T& dict) {
+            size_t n = 2;
+            for (const auto& [k, v] : dict)
+                n += bt_serialize<std::string_view>{}.size(k) + bt_serialize<second_type>{}.size(v);
+            return n;
         }
     };
 
     template <bt_output_dict_container T>
     struct bt_deserialize<T> {
         using second_type = typename T::value_type::second_type;
-        void operator()(std::string_view& s, T& dict) {
+        bt_errc parse(std::string_view& s, T& dict) {
+            return parse(s, dict, [](std::string_view& s, second_type& val) {
+                return bt_parse(s, val);
+            });
+        }
+        // Same as above, but parses values by calling `parse_value(s, val)` (bt_value
+        // deserialization uses this to limit the nesting depth).
+        template <typename ParseValue>
+        bt_errc parse(std::string_view& s, T& dict, ParseValue&& parse_value) {
             // Smallest dict is 2 bytes "de", for an empty dict.
             if (s.size() < 2)
-                throw bt_deserialize_invalid(
-                        "Deserialization failed: end of string found where dict expected");
+                return bt_errc::truncated;
             if (s[0] != 'd')
-                throw bt_deserialize_invalid_type(
-                        "Deserialization failed: expected 'd', found '"s + s[0] + "'"s);
+                return bt_errc::wrong_type;
             s.remove_prefix(1);
             dict.clear();
-            bt_deserialize<std::string> key_deserializer;
-            bt_deserialize<second_type> val_deserializer;
 
             while (!s.empty() && s[0] != 'e') {
                 std::string key;
                 second_type val;
-                key_deserializer(s, key);
-                val_deserializer(s, val);
-                dict.insert(dict.end(), typename T::value_type{std::move(key), std::move(val)});
+                if (auto ec = bt_parse(s, key); ec != bt_errc::ok)
+                    return ec == bt_errc::wrong_type ? bt_errc::invalid_key : ec;
+                if (s.empty() || s[0] == 'e')
+                    return s.empty() ? bt_errc::truncated : bt_errc::missing_value;
+                if (auto ec = parse_value(s, val); ec != bt_errc::ok)
+                    return bt_nested_errc(ec);
+                // emplace_hint, where available, avoids a copy of the key when the value_type has
+                // a const key (e.g. in a std::map or bt_flat_dict).
+                if constexpr (requires { dict.emplace_hint(dict.end(), key, std::move(val)); })
+                    dict.emplace_hint(dict.end(), std::move(key), std::move(val));
+                else
+                    dict.insert(dict.end(), typename T::value_type{std::move(key), std::move(val)});
             }
             if (s.empty())
-                throw bt_deserialize_invalid(
-                        "Deserialization failed: encountered end of string before dict was "
-                        "finished");
+                return bt_errc::truncated;
             s.remove_prefix(1);  // Consume the 'e'
+            return bt_errc::ok;
         }
+        void operator()(std::string_view& s, T& dict) { bt_check(parse(s, dict)); }
     };
 
     template <typename T>
@@ -282,42 +657,55 @@ namespace detail {
     // Sanity checks:
     static_assert(bt_input_list_container<bt_list>);
     static_assert(bt_output_list_container<bt_list>);
+    static_assert(bt_input_list_container<bt_flat_list>);
+    static_assert(bt_output_list_container<bt_flat_list>);
 
     /// List specialization
     template <bt_input_list_container T>
     struct bt_serialize<T> {
-        void operator()(std::ostream& os, const T& list) {
-            os << 'l';
+        void operator()(bt_writer& w, const T& list) {
+            w.put('l');
             for (const auto& v : list)
-                bt_serialize<std::remove_cv_t<typename T::value_type>>{}(os, v);
-            os << 'e';
+                bt_serialize<std::remove_cv_t<typename T::value_type>>{}(w, v);
+            w.put('e');
+        }
+        size_t size(const T& list) {
+            size_t n = 2;
+            for (const auto& v : list)
+                n += bt_serialize<std::remove_cv_t<typename T::value_type>>{}.size(v);
+            return n;
         }
     };
     template <bt_output_list_container T>
     struct bt_deserialize<T> {
         using value_type = typename T::value_type;
-        void operator()(std::string_view& s, T& list) {
+        bt_errc parse(std::string_view& s, T& list) {
+            return parse(s, list, [](std::string_view& s, value_type& val) {
+                return bt_parse(s, val);
+            });
+        }
+        // Same as above, but parses values by calling `parse_value(s, val)`.
+        template <typename ParseValue>
+        bt_errc parse(std::string_view& s, T& list, ParseValue&& parse_value) {
             // Smallest list is 2 bytes "le", for an empty list.
             if (s.size() < 2)
-                throw bt_deserialize_invalid(
-                        "Deserialization failed: end of string found where list expected");
+                return bt_errc::truncated;
             if (s[0] != 'l')
-                throw bt_deserialize_invalid_type(
-                        "Deserialization failed: expected 'l', found '"s + s[0] + "'"s);
+                return bt_errc::wrong_type;
             s.remove_prefix(1);
             list.clear();
-            bt_deserialize<value_type> deserializer;
             while (!s.empty() && s[0] != 'e') {
                 value_type v;
-                deserializer(s, v);
+                if (auto ec = parse_value(s, v); ec != bt_errc::ok)
+                    return bt_nested_errc(ec);
                 list.insert(list.end(), std::move(v));
             }
             if (s.empty())
-                throw bt_deserialize_invalid(
-                        "Deserialization failed: encountered end of string before list was "
-                        "finished");
+                return bt_errc::truncated;
             s.remove_prefix(1);  // Consume the 'e'
+            return bt_errc::ok;
         }
+        void operator()(std::string_view& s, T& list) { bt_check(parse(s, list)); }
     };
 
     /// Serializes a tuple, pair, or array of serializable values (as a list on the wire)
@@ -327,45 +715,63 @@ namespace detail {
     struct bt_serialize<Tuple> {
       private:
         template <size_t... Is>
-        void operator()(std::ostream& os, const Tuple& elems, std::index_sequence<Is...>) {
-            os << 'l';
-            (bt_serialize<std::tuple_element_t<Is, Tuple>>{}(os, std::get<Is>(elems)), ...);
-            os << 'e';
+        void operator()(bt_writer& w, const Tuple& elems, std::index_sequence<Is...>) {
+            w.put('l');
+            (bt_serialize<std::tuple_element_t<Is, Tuple>>{}(w, std::get<Is>(elems)), ...);
+            w.put('e');
+        }
+        template <size_t... Is>
+        size_t size(const Tuple& elems, std::index_sequence<Is...>) {
+            return (size_t{2} + ... +
+                    bt_serialize<std::tuple_element_t<Is, Tuple>>{}.size(std::get<Is>(elems)));
         }
 
       public:
-        void operator()(std::ostream& os, const Tuple& elems) {
-            operator()(os, elems, std::make_index_sequence<std::tuple_size_v<Tuple>>{});
+        void operator()(bt_writer& w, const Tuple& elems) {
+            operator()(w, elems, std::make_index_sequence<std::tuple_size_v<Tuple>>{});
+        }
+        size_t size(const Tuple& elems) {
+            return size(elems, std::make_index_sequence<std::tuple_size_v<Tuple>>{});
         }
     };
     template <tuple_like Tuple>
     struct bt_deserialize<Tuple> {
       private:
+        template <size_t I>
+        static bt_errc parse_element(std::string_view& s, Tuple& elems) {
+            if (s.empty())
+                return bt_errc::truncated;
+            if (s[0] == 'e')
+                return bt_errc::wrong_size;
+            return bt_nested_errc(bt_parse(s, std::get<I>(elems)));
+        }
+
         template <size_t... Is>
-        void operator()(std::string_view& s, Tuple& elems, std::index_sequence<Is...>) {
+        bt_errc parse(std::string_view& s, Tuple& elems, std::index_sequence<Is...>) {
             // Smallest list is 2 bytes "le", for an empty list.
             if (s.size() < 2)
-                throw bt_deserialize_invalid(
-                        "Deserialization failed: end of string found where tuple expected");
+                return bt_errc::truncated;
             if (s[0] != 'l')
-                throw bt_deserialize_invalid_type(
-                        "Deserialization of tuple failed: expected 'l', found '"s + s[0] + "'"s);
+                return bt_errc::wrong_type;
             s.remove_prefix(1);
-            (bt_deserialize<std::tuple_element_t<Is, Tuple>>{}(s, std::get<Is>(elems)), ...);
+            bt_errc ec = bt_errc::ok;
+            // Parses elements until one fails (the && short-circuits the remaining elements):
+            bool parsed = (((ec = parse_element<Is>(s, elems)) == bt_errc::ok) && ...);
+            if (!parsed)
+                return ec;
             if (s.empty())
-                throw bt_deserialize_invalid(
-                        "Deserialization failed: encountered end of string before tuple was "
-                        "finished");
+                return bt_errc::truncated;
             if (s[0] != 'e')
-                throw bt_deserialize_invalid(
-                        "Deserialization failed: expected end of tuple but found something else");
+                return bt_errc::wrong_size;
             s.remove_prefix(1);  // Consume the 'e'
+            return bt_errc::ok;
         }
 
       public:
-        void operator()(std::string_view& s, Tuple& elems) {
-            operator()(s, elems, std::make_index_sequence<std::tuple_size_v<Tuple>>{});
+        bt_errc parse(std::string_view& s, Tuple& elems) {
+            return parse(s, elems, std::make_index_sequence<std::tuple_size_v<Tuple>>{});
         }
+        void operator()(std::string_view& s, Tuple& elems) { bt_check(parse(s, elems)); }
     };
 
     template <typename T>
@@ -377,20 +783,17 @@ namespace detail {
     // which means we reached the end without finding any variant type capable of holding the value.
     template <typename Variant, typename... Ts>
     struct bt_deserialize_try_variant_impl {
-        void operator()(std::string_view&, Variant&) {
-            throw bt_deserialize_invalid(
-                    "Deserialization failed: could not deserialize value into any variant type");
-        }
+        bt_errc operator()(std::string_view&, Variant&) { return bt_errc::wrong_type; }
     };
 
     template <typename... Ts, typename Variant>
-    void bt_deserialize_try_variant(std::string_view& s, Variant& variant) {
-        bt_deserialize_try_variant_impl<Variant, Ts...>{}(s, variant);
+    bt_errc bt_deserialize_try_variant(std::string_view& s, Variant& variant) {
+        return bt_deserialize_try_variant_impl<Variant, Ts...>{}(s, variant);
     }
 
     template <typename Variant, bt_deserializable T, typename... Ts>
     struct bt_deserialize_try_variant_impl<Variant, T, Ts...> {
-        void operator()(std::string_view& s, Variant& variant) {
+        bt_errc operator()(std::string_view& s, Variant& variant) {
             if (bt_output_list_container<T>    ? s[0] == 'l'
                 : tuple_like<T>                ? s[0] == 'l'
                 : bt_output_dict_container<T>  ? s[0] == 'd'
@@ -398,20 +801,21 @@ namespace detail {
                 : std::same_as<T, std::string> ? s[0] >= '0' && s[0] <= '9'
                                                : false) {
                 T val;
-                bt_deserialize<T>{}(s, val);
-                variant = std::move(val);
-            } else {
-                bt_deserialize_try_variant<Ts...>(s, variant);
+                auto ec = bt_deserialize<T>{}.parse(s, val);
+                if (ec == bt_errc::ok)
+                    variant = std::move(val);
+                return ec;
             }
+            return bt_deserialize_try_variant<Ts...>(s, variant);
         }
     };
 
     template <typename Variant, typename T, typename... Ts>
     requires(!bt_deserializable<T>)
     struct bt_deserialize_try_variant_impl<Variant, T, Ts...> {
-        void operator()(std::string_view& s, Variant& variant) {
+        bt_errc operator()(std::string_view& s, Variant& variant) {
             // Unsupported deserialization type, skip it
-            bt_deserialize_try_variant<Ts...>(s, variant);
+            return bt_deserialize_try_variant<Ts...>(s, variant);
         }
     };
 
@@ -419,14 +823,22 @@ namespace detail {
     template <typename... Ts>
     struct bt_serialize<std::variant<Ts...>> {
         static_assert(
-                (std::invocable<bt_serialize<Ts>, std::ostream&, const Ts&> && ...),
+                (std::invocable<bt_serialize<Ts>, bt_writer&, const Ts&> && ...),
                 "all variant types must be bt-serializable");
 
-        void operator()(std::ostream& os, const std::variant<Ts...>& val) {
+        void operator()(bt_writer& w, const std::variant<Ts...>& val) {
             var::visit(
-                    [&os](const auto& val) {
+                    [&w](const auto& val) {
                         using T = std::remove_cvref_t<decltype(val)>;
-                        bt_serialize<T>{}(os, val);
+                        bt_serialize<T>{}(w, val);
+                    },
+                    val);
+        }
+        size_t size(const std::variant<Ts...>& val) {
+            return var::visit(
+                    [](const auto& val) {
+                        using T = std::remove_cvref_t<decltype(val)>;
+                        return bt_serialize<T>{}.size(val);
                     },
                     val);
         }
@@ -438,9 +850,12 @@ namespace detail {
         static_assert(
                 (bt_deserializable<Ts> || ...), "at least one type must be bt-deserializable");
 
-        void operator()(std::string_view& s, std::variant<Ts...>& val) {
-            bt_deserialize_try_variant<Ts...>(s, val);
+        bt_errc parse(std::string_view& s, std::variant<Ts...>& val) {
+            if (s.empty())
+                return bt_errc::truncated;
+            return bt_deserialize_try_variant<Ts...>(s, val);
         }
+        void operator()(std::string_view& s, std::variant<Ts...>& val) { bt_check(parse(s, val)); }
     };
 
     template <>
@@ -448,7 +863,17 @@ namespace detail {
 
     template <>
     struct bt_deserialize<bt_value> {
-        void operator()(std::string_view& s, bt_value& val);
+        bt_errc parse(std::string_view& s, bt_value& val);
+        void operator()(std::string_view& s, bt_value& val) { bt_check(parse(s, val)); }
+    };
+
+    template <>
+    struct bt_serialize<bt_flat_value> : bt_serialize<bt_flat_variant> {};
+
+    template <>
+    struct bt_deserialize<bt_flat_value> {
+        bt_errc parse(std::string_view& s, bt_flat_value& val);
+        void operator()(std::string_view& s, bt_flat_value& val) { bt_check(parse(s, val)); }
     };
 
     template <typename T>
@@ -456,14 +881,18 @@ namespace detail {
         const T& val;
         explicit bt_stream_serializer(const T& val) : val{val} {}
         operator std::string() const {
-            std::ostringstream oss;
-            oss << *this;
-            return oss.str();
+            std::string out;
+            bt_writer w{out};
+            bt_serialize<T>{}(w, val);
+            w.finish();
+            return out;
         }
     };
     template <typename T>
     std::ostream& operator<<(std::ostream& os, const bt_stream_serializer<T>& s) {
-        bt_serialize<T>{}(os, s.val);
+        bt_writer w{os};
+        bt_serialize<T>{}(w, s.val);
+        w.finish();
         return os;
     }
 
@@ -507,23 +936,159 @@ std::string bt_serialize(const T& val) {
     return bt_serializer(val);
 }
 
+/// Returns the exact number of bytes that `bt_serialize(val)` will produce, without actually
+/// serializing anything.  This can be used to pre-size an output buffer (see bt_serialize_into).
+template <typename T>
+size_t bt_serialized_size(const T& val) {
+    return detail::bt_serialize<T>{}.size(val);
+}
+
+/// Serializes `val` into the given buffer, which must be large enough to hold the serialized value
+/// (see `bt_serialized_size`).  Returns the number of bytes written (i.e. the serialized size).
+/// Throws std::length_error if the buffer is too small, in which case the buffer contents are
+/// unspecified.
+///
+///     std::vector<char> buf(bt_serialized_size(val));
+///     bt_serialize_into(buf, val);
+///
+template <basic_char Char, size_t Extent, typename T>
+size_t bt_serialize_into(std::span<Char, Extent> buf, const T& val) {
+    detail::bt_writer w{std::span<char>{reinterpret_cast<char*>(buf.data()), buf.size()}};
+    detail::bt_serialize<T>{}(w, val);
+    return w.finish();
+}
+
+/// Same as above, but accepts any contiguous container of chars (e.g. std::string,
+/// std::vector<char>, std::array<unsigned char, N>).  Note that the container is *not* resized.
+template <typename Container, typename T>
+requires basic_char<typename Container::value_type> && std::ranges::contiguous_range<Container>
+size_t bt_serialize_into(Container& buf, const T& val) {
+    return bt_serialize_into(std::span{buf}, val);
+}
+
+/// Non-throwing version of `bt_deserialize(s, val)`: deserializes the given string view directly
+/// into `val`, returning a bt_error that converts to false on success.  On failure this returns
+/// the error code and the offset in `s` at which the error was detected; no exception is thrown,
+/// and nothing is allocated beyond what is needed to hold the parsed value.  Usage:
+///
+///     std::vector<int> values;
+///     if (auto err = bt_try_deserialize(encoded, values))
+///         log::warning("Bad data at byte {}: {}", err.offset, err.message());
+///
+/// As with bt_deserialize, `val` may have been partially set when this fails.
+template <typename T>
+requires(!std::is_const_v<T>)
+bt_error bt_try_deserialize(std::string_view s, T& val) {
+    const char* start = s.data();
+    auto ec = detail::bt_parse(s, val);
+    if (ec == bt_errc::ok && !s.empty())
+        ec = bt_errc::trailing_data;
+    if (ec != bt_errc::ok)
+        return {ec, static_cast<size_t>(s.data() - start)};
+    return {};
+}
+
+/// Checks that `s` contains exactly one valid bt-encoded value (of any type), without
+/// deserializing anything.  Returns a bt_error that converts to false if the data is valid, and
+/// otherwise contains the error code and offset of the first error.  This walks the data in a
+/// single non-recursive pass, skipping over string contents without reading them, and does not
+/// allocate unless lists/dicts are nested more than 64 levels deep.
+///
+/// If `check_key_order` is true then this additionally requires that the keys of every dict are
+/// unique and in ascending order (failing with bt_errc::unsorted_key if not), as required for
+/// valid bt-encoding; the deserializers and consumers do not themselves check this.
+///
+/// Lists and dicts may be nested at most `max_depth` levels deep (where a top-level list or dict
+/// is depth 1).
+///
+///     if (auto err = bt_validate(packet, true))
+///         return reject(err);
+///
+inline bt_error bt_validate(
+        std::string_view s,
+        bool check_key_order = false,
+        size_t max_depth = bt_default_max_depth) {
+    const char* start = s.data();
+    auto ec = detail::bt_validate_value(s, check_key_order, max_depth);
+    if (ec == bt_errc::ok && !s.empty())
+        ec = bt_errc::trailing_data;
+    if (ec != bt_errc::ok)
+        return {ec, static_cast<size_t>(s.data() - start)};
+    return {};
+}
+
+/// Walks through the bt-encoded value in `data` in a single pass, calling methods of `visitor` for
+/// each element, without building any intermediate bt_value or consumer objects.  Visitor methods
+/// are all optional (the walk only calls the ones that exist, and calls them directly so that they
+/// can be inlined):
+///
+///     struct visitor {
+///         void begin_list();
+///         void end_list();
+///         void begin_dict();
+///         void end_dict();
+///         void key(std::string_view key);  // Called with each dict key, before its value
+///         void string(std::string_view value);
+///         void integer(int64_t value);   // Called for negative integers
+///         void integer(uint64_t value);  // Called for non-negative integers
+///     };
+///
+/// (The integer methods must take exactly int64_t or uint64_t, or be templates: a visitor with
+/// only `integer(uint64_t)` is not called for negative integers, rather than getting them
+/// converted).
+///
+/// The string_views passed to the visitor point into `data`, and so remain valid as long as
+/// `data` does: a visitor that needs the full path to a value, for instance, can keep a stack of
+/// the keys it has been given (and list positions) without copying them.
+///
+/// Lists and dicts may be nested at most bt_default_max_depth deep.  Dict key order is not
+/// checked (as with the deserializers; use bt_validate() first if that matters).
+///
+/// Invalid data is only detected when the walk reaches it, and so the visitor may already have
+/// been called for the elements that precede the error.  This version throws a
+/// bt_deserialize_invalid exception if `data` is not a single valid value.
+template <typename Visitor>
+void bt_visit(std::string_view data, Visitor&& visitor) {
+    bt_error err;
+    bt_visit(data, visitor, err);
+    if (err)
+        detail::throw_bt_error(err);
+}
+
+/// Same as above, but sets `err` instead of throwing (and clears it on success).
+template <typename Visitor>
+void bt_visit(std::string_view data, Visitor&& visitor, bt_error& err) {
+    const char* start = data.data();
+    auto ec = detail::bt_walk_value(data, false, bt_default_max_depth, visitor);
+    if (ec == bt_errc::ok && !data.empty())
+        ec = bt_errc::trailing_data;
+    err = ec == bt_errc::ok ? bt_error{} : bt_error{ec, static_cast<size_t>(data.data() - start)};
+}
+
 /// Deserializes the given string view directly into `val`.  Usage:
 ///
 ///     std::string encoded = "i42e";
 ///     int value;
 ///     bt_deserialize(encoded, value); // Sets value to 42
 ///
+/// Throws a bt_deserialize_invalid (or bt_deserialize_invalid_type) on failure; see
+/// bt_try_deserialize for a non-throwing alternative.
+///
 /// Note that this method can set a value even if in fails, in particular when the value was parsed
 /// successfully but the parsed string still has remaining content.
 ///
 template <typename T>
 requires(!std::is_const_v<T>)
 void bt_deserialize(std::string_view s, T& val) {
-    detail::bt_deserialize<T>{}(s, val);
-    if (!s.empty())
-        throw bt_deserialize_invalid{
-                "Deserialization failed: did not consume the entire encoded string" +
-                std::to_string(s.size())};
+    if constexpr (detail::bt_nothrow_deserializable<T>) {
+        if (auto err = bt_try_deserialize(s, val)) [[unlikely]]
+            detail::throw_bt_error(err);
+    } else {
+        // Custom deserializer: let its own exceptions propagate as-is
+        detail::bt_deserialize<T>{}(s, val);
+        if (!s.empty())
+            throw bt_deserialize_invalid{bt_errc::trailing_data};
+    }
 }
 
 /// Deserializes the given string_view into a `T`, which is returned.
@@ -552,6 +1117,70 @@ inline bt_value bt_get(std::string_view s) {
     return bt_deserialize<bt_value>(s);
 }
 
+/// Same as `bt_get`, but deserializes into a `bt_flat_value`, which uses contiguous containers
+/// (bt_flat_dict and bt_flat_list) rather than node-based ones for nested dicts and lists.
+inline bt_flat_value bt_get_flat(std::string_view s) {
+    return bt_deserialize<bt_flat_value>(s);
+}
+
+namespace detail {
+    template <typename Value, typename Dict, typename List>
+    Value bt_get_view_impl(std::string_view s) {
+        Value val;
+        const char* start = s.data();
+        auto ec = bt_deserialize_value<Value, Dict, List, true>(s, val, bt_default_max_depth);
+        if (ec == bt_errc::ok && !s.empty())
+            ec = bt_errc::trailing_data;
+        if (ec != bt_errc::ok)
+            throw_bt_error(bt_error{ec, static_cast<size_t>(s.data() - start)});
+        return val;
+    }
+}  // namespace detail
+
+/// Same as `bt_get`, but borrows rather than copies string values: every string value (at any
+/// depth) is stored in the returned bt_value as a `std::string_view` pointing into `s`, rather than
+/// as a `std::string`, which avoids an allocation per string.  (Dict keys are still `std::string`s,
+/// as required by `bt_dict`, though short keys are typically stored without allocation; see
+/// bt_value_arena for a fully non-copying alternative).
+///
+/// The returned value therefore references `s`, and must not be used once the data it views has
+/// been freed or modified.  Copying the returned value copies the views, not the strings.
+///
+/// Code consuming the value must accept `std::string_view` string values: for example
+/// `var::get<std::string_view>(val)` rather than `var::get<std::string>(val)`.  (`get_tuple` and
+/// bt_serialize accept either).
+inline bt_value bt_get_view(std::string_view s) {
+    return detail::bt_get_view_impl<bt_value, bt_dict, bt_list>(s);
+}
+
+/// Same as `bt_get_view`, but returns a `bt_flat_value` (see bt_get_flat).
+inline bt_flat_value bt_get_flat_view(std::string_view s) {
+    return detail::bt_get_view_impl<bt_flat_value, bt_flat_dict, bt_flat_list>(s);
+}
+
+namespace detail {
+    template <std::integral IntType, typename Variant>
+    IntType get_int_impl(const Variant& v) {
+        if (auto* value = std::get_if<uint64_t>(&v)) {
+            if constexpr (!std::same_as<IntType, uint64_t>)
+                if (*value > static_cast<uint64_t>(std::numeric_limits<IntType>::max()))
+                    throw std::overflow_error(
+                            "Unable to extract integer value: stored value is too large for the "
+                            "requested type");
+            return static_cast<IntType>(*value);
+        }
+
+        int64_t value = var::get<int64_t>(v);  // throws if no int contained
+        if constexpr (!std::same_as<IntType, int64_t>)
+            if (value > static_cast<int64_t>(std::numeric_limits<IntType>::max()) ||
+                value < static_cast<int64_t>(std::numeric_limits<IntType>::min()))
+                throw std::overflow_error(
+                        "Unable to extract integer value: stored value is outside the range of "
+                        "the requested type");
+        return static_cast<IntType>(value);
+    }
+}  // namespace detail
+
 /// Helper functions to extract a value of some integral type from a bt_value which contains either
 /// a int64_t or uint64_t.  Does range checking, throwing std::overflow_error if the stored value is
 /// outside the range of the target type.
@@ -563,28 +1192,18 @@ inline bt_value bt_get(std::string_view s) {
 ///     auto v = get_int<uint32_t>(val); // throws if the decoded value doesn't fit in a uint32_t
 template <std::integral IntType>
 IntType get_int(const bt_value& v) {
-    if (auto* value = std::get_if<uint64_t>(&v)) {
-        if constexpr (!std::same_as<IntType, uint64_t>)
-            if (*value > static_cast<uint64_t>(std::numeric_limits<IntType>::max()))
-                throw std::overflow_error(
-                        "Unable to extract integer value: stored value is too large for the "
-                        "requested type");
-        return static_cast<IntType>(*value);
-    }
-
-    int64_t value = var::get<int64_t>(v);  // throws if no int contained
-    if constexpr (!std::same_as<IntType, int64_t>)
-        if (value > static_cast<int64_t>(std::numeric_limits<IntType>::max()) ||
-            value < static_cast<int64_t>(std::numeric_limits<IntType>::min()))
-            throw std::overflow_error(
-                    "Unable to extract integer value: stored value is outside the range of the "
-                    "requested type");
-    return static_cast<IntType>(value);
+    return detail::get_int_impl<IntType>(static_cast<const bt_variant&>(v));
+}
+
+/// Same as above, but for a bt_flat_value.
+template <std::integral IntType, std::same_as<bt_flat_value> Value>
+IntType get_int(const Value& v) {
+    return detail::get_int_impl<IntType>(static_cast<const bt_flat_variant&>(v));
 }
 
 namespace detail {
-    template <tuple_like Tuple, size_t... Is>
-    void get_tuple_impl(Tuple& t, const bt_list& l, std::index_sequence<Is...>);
+    template <tuple_like Tuple, typename List, size_t... Is>
+    void get_tuple_impl(Tuple& t, const List& l, std::index_sequence<Is...>);
 }
 
 /// Converts a bt_list into the given template std::tuple, std::pair, or std::array.  Throws a
@@ -602,20 +1221,35 @@ Tuple get_tuple(const bt_value& x) {
     return get_tuple<Tuple>(var::get<bt_list>(static_cast<const bt_variant&>(x)));
 }
 
+/// Same as above, but for a bt_flat_list or a bt_flat_value containing a bt_flat_list.
+template <tuple_like Tuple>
+Tuple get_tuple(const bt_flat_list& x) {
+    Tuple t;
+    detail::get_tuple_impl(t, x, std::make_index_sequence<std::tuple_size_v<Tuple>>{});
+    return t;
+}
+template <tuple_like Tuple>
+Tuple get_tuple(const bt_flat_value& x) {
+    return get_tuple<Tuple>(var::get<bt_flat_list>(static_cast<const bt_flat_variant&>(x)));
+}
+
 class bt_dict_consumer;
 class bt_list_consumer;
 
 namespace detail {
     template <typename T, typename It>
     void get_tuple_impl_one(T& t, It& it) {
-        const bt_variant& v = *it++;
+        // Either a bt_value or a bt_flat_value, and the matching list type:
+        using Value = std::remove_cvref_t<decltype(*it)>;
+        using List = std::conditional_t<std::same_as<Value, bt_value>, bt_list, bt_flat_list>;
+        const Value& v = *it++;
         if constexpr (std::integral<T>) {
             t = oxenc::get_int<T>(v);
         } else if constexpr (tuple_like<T>) {
-            if (std::holds_alternative<bt_list>(v))
+            if (!std::holds_alternative<List>(v))
                 throw std::invalid_argument{
                         "Unable to convert tuple: cannot create sub-tuple from non-bt_list"};
-            t = get_tuple<T>(var::get<bt_list>(v));
+            t = get_tuple<T>(var::get<List>(v));
         } else if constexpr (std::same_as<std::string, T> || std::same_as<std::string_view, T>) {
             // If we request a string/string_view, we might have the other one and need to copy/view
             // it.
@@ -627,8 +1261,8 @@ namespace detail {
             t = var::get<T>(v);
         }
     }
-    template <tuple_like Tuple, size_t... Is>
-    void get_tuple_impl(Tuple& t, const bt_list& l, std::index_sequence<Is...>) {
+    template <tuple_like Tuple, typename List, size_t... Is>
+    void get_tuple_impl(Tuple& t, const List& l, std::index_sequence<Is...>) {
         if (l.size() != sizeof...(Is))
             throw std::invalid_argument{"Unable to convert tuple: bt_list has wrong size"};
         auto it = l.begin();
@@ -653,6 +1287,40 @@ namespace detail {
         }
     }
 
+    template <typename T, typename Consumer>
+    T consume_impl(Consumer& c, bt_error& err) {
+        if constexpr (std::integral<T>)
+            return c.template consume_integer<T>(err);
+        else if constexpr (is_string_like<T>)
+            return T{c.template consume_string_view<typename T::value_type>(err)};
+        else if constexpr (
+                std::same_as<T, bt_list> || tuple_like<T> || bt_output_list_container<T>) {
+            T list{};
+            c.consume_list(list, err);
+            return list;
+        } else if constexpr (std::same_as<T, bt_dict> || bt_output_dict_container<T>) {
+            T dict{};
+            c.consume_dict(dict, err);
+            return dict;
+        } else if constexpr (std::same_as<T, bt_dict_consumer>)
+            return c.consume_dict_consumer(err);
+        else {
+            static_assert(std::same_as<T, bt_list_consumer>, "Unsupported consume type");
+            return c.consume_list_consumer(err);
+        }
+    }
+
+    // Returns the value that the non-throwing `require<T>` returns when the key isn't found.
+    template <typename T>
+    T empty_consume_value() {
+        if constexpr (std::same_as<T, bt_dict_consumer>)
+            return T{"de"sv};
+        else if constexpr (std::same_as<T, bt_list_consumer>)
+            return T{"le"sv};
+        else
+            return T{};
+    }
+
 }  // namespace detail
 
 /// Class that allows you to walk through a bt-encoded list in memory without copying or allocating
@@ -663,11 +1331,63 @@ class bt_list_consumer {
     std::string_view data;            // Remaining data; this gets prefix-removed as we go
     const char* start = data.data();  // Pointer to the start of the initial data, so that we can
                                       // get the entire data when needed (e.g. for signatures)
+    size_t max_depth_ = bt_default_max_depth;
     bt_list_consumer() = default;
 
     struct load_tag {};
     bt_list_consumer(std::string_view data, load_tag) : data{data} {}
 
+    // Sets `err` to the given error code at the position of `at` (which must be within the data).
+    void set_error(bt_error& err, bt_errc code, std::string_view at) const {
+        err = {code, static_cast<size_t>(at.data() - start)};
+    }
+
+    static void check(const bt_error& err) {
+        if (err) [[unlikely]]
+            detail::throw_bt_error(err);
+    }
+
+    // Deserializes the next value into `val` and advances past it.  On failure this sets `err` and
+    // returns false without advancing.
+    template <typename T>
+    bool parse_next(T& val, bt_error& err) {
+        std::string_view next{data};
+        if (auto ec = detail::bt_parse(next, val); ec != bt_errc::ok) [[unlikely]] {
+            set_error(err, ec, next);
+            return false;
+        }
+        err = {};
+        data = next;
+        return true;
+    }
+
+    // Skips over the next value, which must be a list or dict (as given by `type`), and returns
+    // the data of the skipped value.
+    template <basic_char Char>
+    std::basic_string_view<Char> consume_data(char type, bt_error& err) {
+        std::string_view next{data};
+        auto ec = next.empty()      ? bt_errc::truncated
+                : next[0] != type ? bt_errc::wrong_type
+                                  : detail::bt_skip_value(next, max_depth_);
+        if (ec != bt_errc::ok) {
+            set_error(err, ec, next);
+            return {};
+        }
+        err = {};
+        std::basic_string_view<Char> result{
+                reinterpret_cast<const Char*>(data.data()), data.size() - next.size()};
+        data = next;
+        return result;
+    }
+
+    // Applies our depth limit (less one, for the consumed list/dict itself) to a consumer of one
+    // of our values.
+    template <typename Consumer>
+    Consumer nested(Consumer c) const {
+        c.set_max_depth(max_depth_ > 0 ? max_depth_ - 1 : 0);
+        return c;
+    }
+
   public:
     bt_list_consumer(std::string_view data_) : bt_list_consumer{data_, load_tag{}} {
         if (data.empty())
@@ -676,6 +1396,22 @@ class bt_list_consumer {
             throw std::runtime_error{"Cannot create a bt_list_consumer with non-list data"};
         data.remove_prefix(1);
     }
+    /// Non-throwing constructor: if `data_` does not start with a bt-encoded list then `err` is set
+    /// and the consumer is left empty (i.e. `is_finished()` will be true).  `err` is cleared on
+    /// success.
+    ///
+    /// Each of the consume methods also has a non-throwing version taking a `bt_error&` which is
+    /// set on failure (without advancing the consumer) and cleared on success.  Error offsets are
+    /// relative to the beginning of the data that the consumer was constructed with.
+    bt_list_consumer(std::string_view data_, bt_error& err) : bt_list_consumer{data_, load_tag{}} {
+        err = {};
+        if (data.size() < 2 || data[0] != 'l') {
+            err.code = data.size() < 2 ? bt_errc::truncated : bt_errc::wrong_type;
+            data = "le"sv;
+            start = data.data();
+        }
+        data.remove_prefix(1);
+    }
     bt_list_consumer(std::basic_string_view<unsigned char> data) :
             bt_list_consumer{
                     std::string_view{reinterpret_cast<const char*>(data.data()), data.size()}} {}
@@ -688,6 +1424,14 @@ class bt_list_consumer {
     bt_list_consumer(const bt_list_consumer&) = default;
     bt_list_consumer& operator=(const bt_list_consumer&) = default;
 
+    /// Returns the maximum nesting depth of lists/dicts allowed inside values skipped over by this
+    /// consumer (via the `skip_value`, `finish`, and `consume_*_data` methods).
+    size_t max_depth() const { return max_depth_; }
+    /// Changes the maximum nesting depth (which defaults to `bt_default_max_depth`).  Values that
+    /// are nested more deeply fail with bt_errc::too_deep.  Consumers of nested lists/dicts
+    /// obtained from this consumer inherit the limit (less one for the level of nesting).
+    void set_max_depth(size_t depth) { max_depth_ = depth; }
+
     /// Returns true if the next value indicates the end of the list
     bool is_finished() const { return data.front() == 'e'; }
     /// Returns true if the next element looks like an encoded string
@@ -721,13 +1465,20 @@ class bt_list_consumer {
     }
     template <basic_char Char = char>
     std::basic_string_view<Char> consume_string_view() {
-        if (data.empty())
-            throw bt_deserialize_invalid{"expected a string, but reached end of data"};
-        else if (!is_string())
-            throw bt_deserialize_invalid_type{"expected a string, but found "s + data.front()};
-        std::string_view next{data}, result;
-        detail::bt_deserialize<std::string_view>{}(next, result);
-        data = next;
+        bt_error err;
+        auto result = consume_string_view<Char>(err);
+        check(err);
+        return result;
+    }
+    /// Non-throwing versions of the above: on failure, sets `err` and returns an empty string.
+    template <basic_char Char = char>
+    std::basic_string<Char> consume_string(bt_error& err) {
+        return std::basic_string<Char>{consume_string_view<Char>(err)};
+    }
+    template <basic_char Char = char>
+    std::basic_string_view<Char> consume_string_view(bt_error& err) {
+        std::string_view result;
+        parse_next(result, err);
         return {reinterpret_cast<const Char*>(result.data()), result.size()};
     }
 
@@ -735,12 +1486,17 @@ class bt_list_consumer {
     /// next value is not an integer.
     template <typename IntType>
     IntType consume_integer() {
-        if (!is_integer())
-            throw bt_deserialize_invalid_type{"next value is not an integer"};
-        std::string_view next{data};
+        bt_error err;
+        auto result = consume_integer<IntType>(err);
+        check(err);
+        return result;
+    }
+    /// Non-throwing version of the above: on failure, sets `err` and returns 0.
+    template <typename IntType>
+    IntType consume_integer(bt_error& err) {
         IntType ret;
-        detail::bt_deserialize<IntType>{}(next, ret);
-        data = next;
+        if (!parse_next(ret, err))
+            return IntType{};
         return ret;
     }
 
@@ -758,11 +1514,17 @@ class bt_list_consumer {
     /// Same as above, but takes a pre-existing list-like data type.
     template <typename T>
     void consume_list(T& list) {
-        if (!is_list())
-            throw bt_deserialize_invalid_type{"next bt value is not a list"};
-        std::string_view n{data};
-        detail::bt_deserialize<T>{}(n, list);
-        data = n;
+        bt_error err;
+        consume_list(list, err);
+        check(err);
+    }
+    /// Non-throwing version of the above: sets `err` on failure (in which case `list` may have
+    /// been partially filled).
+    template <typename T>
+    void consume_list(T& list, bt_error& err) {
+        if (!data.empty() && !is_list())
+            return set_error(err, bt_errc::wrong_type, data);
+        parse_next(list, err);
     }
 
     /// Consumes a dict, return it as a dict-like type.  This typically requires dynamic allocation,
@@ -778,11 +1540,17 @@ class bt_list_consumer {
     /// Same as above, but takes a pre-existing dict-like data type.
     template <typename T>
     void consume_dict(T& dict) {
-        if (!is_dict())
-            throw bt_deserialize_invalid_type{"next bt value is not a dict"};
-        std::string_view n{data};
-        detail::bt_deserialize<T>{}(n, dict);
-        data = n;
+        bt_error err;
+        consume_dict(dict, err);
+        check(err);
+    }
+    /// Non-throwing version of the above: sets `err` on failure (in which case `dict` may have
+    /// been partially filled).
+    template <typename T>
+    void consume_dict(T& dict, bt_error& err) {
+        if (!data.empty() && !is_dict())
+            return set_error(err, bt_errc::wrong_type, data);
+        parse_next(dict, err);
     }
 
     /// Attempts to parse the next value as a list and returns the string_view that contains the
@@ -791,20 +1559,15 @@ class bt_list_consumer {
     /// aren't separately needed).  This, however, does not require dynamic memory allocation.
     template <basic_char Char = char>
     std::basic_string_view<Char> consume_list_data() {
-        std::basic_string_view<Char> orig{reinterpret_cast<const Char*>(data.data()), data.size()};
-        if (data.size() < 2 || !is_list())
-            throw bt_deserialize_invalid_type{"next bt value is not a list"};
-        data.remove_prefix(1);  // Descend into the sublist, consume the "l"
-        while (!is_finished()) {
-            skip_value();
-            if (data.empty())
-                throw bt_deserialize_invalid{
-                        "bt list consumption failed: hit the end of string before the list was "
-                        "done"};
-        }
-        data.remove_prefix(1);  // Back out from the sublist, consume the "e"
-        orig.remove_suffix(data.size());
-        return orig;
+        bt_error err;
+        auto result = consume_list_data<Char>(err);
+        check(err);
+        return result;
+    }
+    /// Non-throwing version of the above: on failure, sets `err` and returns an empty view.
+    template <basic_char Char = char>
+    std::basic_string_view<Char> consume_list_data(bt_error& err) {
+        return consume_data<Char>('l', err);
     }
 
     /// Attempts to parse the next value as a dict and returns the string_view that contains the
@@ -813,28 +1576,30 @@ class bt_list_consumer {
     /// aren't separately needed).  This, however, does not require dynamic memory allocation.
     template <basic_char Char = char>
     std::basic_string_view<Char> consume_dict_data() {
-        std::basic_string_view<Char> orig{reinterpret_cast<const Char*>(data.data()), data.size()};
-        if (data.size() < 2 || !is_dict())
-            throw bt_deserialize_invalid_type{"next bt value is not a dict"};
-        data.remove_prefix(1);  // Descent into the dict, consumer the "d"
-        while (!is_finished()) {
-            consume_string_view();  // Key is always a string
-            if (!data.empty())
-                skip_value();
-            if (data.empty())
-                throw bt_deserialize_invalid{
-                        "bt dict consumption failed: hit the end of string before the dict was "
-                        "done"};
-        }
-        data.remove_prefix(1);  // Back out of the dict, consume the "e"
-        orig.remove_suffix(data.size());
-        return orig;
+        bt_error err;
+        auto result = consume_dict_data<Char>(err);
+        check(err);
+        return result;
+    }
+    /// Non-throwing version of the above: on failure, sets `err` and returns an empty view.
+    template <basic_char Char = char>
+    std::basic_string_view<Char> consume_dict_data(bt_error& err) {
+        return consume_data<Char>('d', err);
     }
 
     /// Shortcut for wrapping `consume_list_data()` in a new list consumer
-    bt_list_consumer consume_list_consumer() { return consume_list_data(); }
+    bt_list_consumer consume_list_consumer() {
+        return nested(bt_list_consumer{consume_list_data()});
+    }
     /// Shortcut for wrapping `consume_dict_data()` in a new dict consumer
     inline bt_dict_consumer consume_dict_consumer();
+    /// Non-throwing versions of the above; on failure these set `err` and return an empty
+    /// consumer.
+    bt_list_consumer consume_list_consumer(bt_error& err) {
+        auto list = consume_list_data(err);
+        return nested(bt_list_consumer{err ? "le"sv : list});
+    }
+    inline bt_dict_consumer consume_dict_consumer(bt_error& err);
 
     /// Consumes a string as a signature value, as added via bt_list_producer::append_signature.
     /// The expected signed message (i.e. the data parsed up to the current point) and the signature
@@ -884,16 +1649,19 @@ class bt_list_consumer {
 
     /// Consumes a value without returning it.
     void skip_value() {
-        if (is_string())
-            consume_string_view();
-        else if (is_integer())
-            detail::bt_deserialize_integer(data);
-        else if (is_list())
-            consume_list_data();
-        else if (is_dict())
-            consume_dict_data();
-        else
-            throw bt_deserialize_invalid_type{"next bt value has unknown type"};
+        bt_error err;
+        skip_value(err);
+        check(err);
+    }
+    /// Non-throwing version of the above: sets `err` on failure.
+    void skip_value(bt_error& err) {
+        std::string_view next{data};
+        auto ec = !next.empty() && next[0] == 'e' ? bt_errc::end_of_container
+                                                  : detail::bt_skip_value(next, max_depth_);
+        if (ec != bt_errc::ok)
+            return set_error(err, ec, next);
+        err = {};
+        data = next;
     }
 
     /// Finishes reading the list by reading through (and ignoring) any remaining values until it
@@ -904,13 +1672,23 @@ class bt_list_consumer {
     /// It is not required to call this, but not calling it will not notice if there is invalid data
     /// later in the list or after the end of the list.
     void finish() {
-        while (!is_finished())
-            skip_value();
-
-        // If we consumed the entire buffer we should have only the terminating 'e' left (and
-        // `is_finished()` already checked that it is in fact an `e`).
-        if (data.size() != 1)
-            throw bt_deserialize_invalid{"Dict finished without consuming the entire buffer"};
+        bt_error err;
+        finish(err);
+        check(err);
+    }
+    /// Non-throwing version of the above: sets `err` on failure.
+    void finish(bt_error& err) {
+        err = {};
+        while (!data.empty() && data[0] != 'e') {
+            skip_value(err);
+            if (err)
+                return;
+        }
+        // If we consumed the entire buffer we should have only the terminating 'e' left.
+        if (data.empty())
+            set_error(err, bt_errc::truncated, data);
+        else if (data.size() != 1)
+            set_error(err, bt_errc::trailing_data, data.substr(1));
     }
 };
 
@@ -927,16 +1705,45 @@ class bt_dict_consumer : private bt_list_consumer {
     bool consume_key() {
         if (key_.data())
             return true;
-        if (data.empty())
-            throw bt_deserialize_invalid_type{"expected a key or dict end, found end of string"};
+        bt_error err;
+        bool found = consume_key(err);
+        check(err);
+        return found;
+    }
+
+    /// Non-throwing version of consume_key(): returns false (with `err` set) on failure.
+    bool consume_key(bt_error& err) {
+        err = {};
+        if (key_.data())
+            return true;
+        if (data.empty()) {
+            set_error(err, bt_errc::truncated, data);
+            return false;
+        }
         if (data[0] == 'e')
             return false;
-        key_ = bt_list_consumer::consume_string_view();
-        if (data.empty() || data[0] == 'e')
-            throw bt_deserialize_invalid{"dict key isn't followed by a value"};
+        std::string_view next{data}, key;
+        auto ec = detail::bt_deserialize<std::string_view>{}.parse(next, key);
+        if (ec == bt_errc::ok && (next.empty() || next[0] == 'e'))
+            ec = next.empty() ? bt_errc::truncated : bt_errc::missing_value;
+        if (ec != bt_errc::ok) {
+            set_error(err, ec == bt_errc::wrong_type ? bt_errc::invalid_key : ec, next);
+            return false;
+        }
+        key_ = key;
+        data = next;
         return true;
     }
 
+    /// Same as consume_key(err), but also sets `err` if we are at the end of the dict.
+    bool next_key(bt_error& err) {
+        if (consume_key(err))
+            return true;
+        if (!err)
+            set_error(err, bt_errc::end_of_container, data);
+        return false;
+    }
+
     /// Clears the cached key and returns it.  Must have already called consume_key directly or
     /// indirectly via one of the `is_{...}` methods.
     std::string_view flush_key() {
@@ -959,14 +1766,47 @@ class bt_dict_consumer : private bt_list_consumer {
     bt_dict_consumer(std::basic_string_view<std::byte> data) :
             bt_dict_consumer{
                     std::string_view{reinterpret_cast<const char*>(data.data()), data.size()}} {}
+    /// Non-throwing constructor: if `data_` does not start with a bt-encoded dict then `err` is set
+    /// and the consumer is left empty (i.e. `is_finished()` will be true).  `err` is cleared on
+    /// success.
+    ///
+    /// The methods that consume or look at the next key (`is_finished`, `key`, and the `next_*`,
+    /// `consume_*`, `skip_until`, `required`, `require`, `maybe` and `finish` methods) also have
+    /// non-throwing versions taking a `bt_error&` which is set on failure (without advancing past
+    /// the value) and cleared on success.  Error offsets are relative to the beginning of the data
+    /// that the consumer was constructed with.  For example:
+    ///
+    ///     bt_error err;
+    ///     bt_dict_consumer d{data, err};
+    ///     auto a = d.require<int>("a", err);
+    ///     if (!err)
+    ///         d.finish(err);
+    ///     if (err)
+    ///         log::debug("Invalid request at byte {}: {}", err.offset, err.message());
+    bt_dict_consumer(std::string_view data_, bt_error& err) : bt_list_consumer{data_, load_tag{}} {
+        err = {};
+        if (data.size() < 2 || data[0] != 'd') {
+            err.code = data.size() < 2 ? bt_errc::truncated : bt_errc::wrong_type;
+            data = "de"sv;
+            start = data.data();
+        }
+        data.remove_prefix(1);
+    }
 
     /// Copy constructor.  Making a copy copies the current position so can be used for multipass
     /// iteration through a list.
     bt_dict_consumer(const bt_dict_consumer&) = default;
     bt_dict_consumer& operator=(const bt_dict_consumer&) = default;
 
+    using bt_list_consumer::max_depth;
+    using bt_list_consumer::set_max_depth;
+
     /// Returns true if the next value indicates the end of the dict
     bool is_finished() { return !consume_key() && data.front() == 'e'; }
+    /// Non-throwing version of the above: returns true at the end of the dict, *or* if the next
+    /// key could not be parsed (in which case `err` is set).  Once this has returned false, the
+    /// other `is_*` methods will not throw (until the next value is consumed).
+    bool is_finished(bt_error& err) { return !consume_key(err); }
     /// Operator bool is an alias for `!is_finished()`
     operator bool() { return !is_finished(); }
     /// Returns true if the next value looks like an encoded string
@@ -988,8 +1828,16 @@ class bt_dict_consumer : private bt_list_consumer {
     /// other method; accessing it multiple times simple accesses the cache until the next value is
     /// consumed.
     std::string_view key() {
-        if (!consume_key())
-            throw bt_deserialize_invalid{"Cannot access next key: at the end of the dict"};
+        bt_error err;
+        auto k = key(err);
+        check(err);
+        return k;
+    }
+    /// Non-throwing version of the above: on failure (or at the end of the dict) sets `err` and
+    /// returns an empty key.
+    std::string_view key(bt_error& err) {
+        if (!next_key(err))
+            return {};
         return key_;
     }
 
@@ -997,11 +1845,20 @@ class bt_dict_consumer : private bt_list_consumer {
     /// if the next value is not a string.
     template <basic_char Char = char>
     std::pair<std::string_view, std::basic_string_view<Char>> next_string() {
-        if (!is_string())
-            throw bt_deserialize_invalid_type{"expected a string, but found "s + data.front()};
+        bt_error err;
+        auto ret = next_string<Char>(err);
+        check(err);
+        return ret;
+    }
+    /// Non-throwing version of the above: on failure, sets `err` and returns empty values.
+    template <basic_char Char = char>
+    std::pair<std::string_view, std::basic_string_view<Char>> next_string(bt_error& err) {
         std::pair<std::string_view, std::basic_string_view<Char>> ret;
-        ret.second = bt_list_consumer::consume_string_view<Char>();
-        ret.first = flush_key();
+        if (next_key(err)) {
+            ret.second = bt_list_consumer::consume_string_view<Char>(err);
+            if (!err)
+                ret.first = flush_key();
+        }
         return ret;
     }
 
@@ -1009,11 +1866,20 @@ class bt_dict_consumer : private bt_list_consumer {
     /// Throws if the next value is not an integer.
     template <typename IntType>
     std::pair<std::string_view, IntType> next_integer() {
-        if (!is_integer())
-            throw bt_deserialize_invalid_type{"next bt dict value is not an integer"};
-        std::pair<std::string_view, IntType> ret;
-        ret.second = bt_list_consumer::consume_integer<IntType>();
-        ret.first = flush_key();
+        bt_error err;
+        auto ret = next_integer<IntType>(err);
+        check(err);
+        return ret;
+    }
+    /// Non-throwing version of the above: on failure, sets `err` and returns an empty key and 0.
+    template <typename IntType>
+    std::pair<std::string_view, IntType> next_integer(bt_error& err) {
+        std::pair<std::string_view, IntType> ret{};
+        if (next_key(err)) {
+            ret.second = bt_list_consumer::consume_integer<IntType>(err);
+            if (!err)
+                ret.first = flush_key();
+        }
         return ret;
     }
 
@@ -1031,10 +1897,18 @@ class bt_dict_consumer : private bt_list_consumer {
     /// Same as above, but takes a pre-existing list-like data type.  Returns the key.
     template <typename T>
     std::string_view next_list(T& list) {
-        if (!is_list())
-            throw bt_deserialize_invalid_type{"next bt value is not a list"};
-        bt_list_consumer::consume_list(list);
-        return flush_key();
+        bt_error err;
+        auto key = next_list(list, err);
+        check(err);
+        return key;
+    }
+    /// Non-throwing version of the above: on failure, sets `err` and returns an empty key.
+    template <typename T>
+    std::string_view next_list(T& list, bt_error& err) {
+        if (!next_key(err))
+            return {};
+        bt_list_consumer::consume_list(list, err);
+        return err ? std::string_view{} : flush_key();
     }
 
     /// Consumes a string->dict pair, return it as a dict-like type.  This typically requires
@@ -1051,10 +1925,18 @@ class bt_dict_consumer : private bt_list_consumer {
     /// Same as above, but takes a pre-existing dict-like data type.  Returns the key.
     template <typename T>
     std::string_view next_dict(T& dict) {
-        if (!is_dict())
-            throw bt_deserialize_invalid_type{"next bt value is not a dict"};
-        bt_list_consumer::consume_dict(dict);
-        return flush_key();
+        bt_error err;
+        auto key = next_dict(dict, err);
+        check(err);
+        return key;
+    }
+    /// Non-throwing version of the above: on failure, sets `err` and returns an empty key.
+    template <typename T>
+    std::string_view next_dict(T& dict, bt_error& err) {
+        if (!next_key(err))
+            return {};
+        bt_list_consumer::consume_dict(dict, err);
+        return err ? std::string_view{} : flush_key();
     }
 
     /// Attempts to parse the next value as a string->list pair and returns the string_view that
@@ -1063,13 +1945,28 @@ class bt_dict_consumer : private bt_list_consumer {
     /// but aren't separately needed).  This, however, does not require dynamic memory allocation.
     template <basic_char Char = char>
     std::pair<std::string_view, std::basic_string_view<Char>> next_list_data() {
-        if (data.size() < 2 || !is_list())
-            throw bt_deserialize_invalid_type{"next bt dict value is not a list"};
-        return {flush_key(), bt_list_consumer::consume_list_data<Char>()};
+        bt_error err;
+        auto ret = next_list_data<Char>(err);
+        check(err);
+        return ret;
+    }
+    /// Non-throwing version of the above: on failure, sets `err` and returns empty values.
+    template <basic_char Char = char>
+    std::pair<std::string_view, std::basic_string_view<Char>> next_list_data(bt_error& err) {
+        std::pair<std::string_view, std::basic_string_view<Char>> ret;
+        if (next_key(err)) {
+            ret.second = bt_list_consumer::consume_list_data<Char>(err);
+            if (!err)
+                ret.first = flush_key();
+        }
+        return ret;
     }
 
     /// Same as next_list_data(), but wraps the value in a bt_list_consumer for convenience
-    std::pair<std::string_view, bt_list_consumer> next_list_consumer() { return next_list_data(); }
+    std::pair<std::string_view, bt_list_consumer> next_list_consumer() {
+        auto [key, list] = next_list_data();
+        return {key, nested(bt_list_consumer{list})};
+    }
 
     /// Attempts to parse the next value as a string->dict pair and returns the string_view that
     /// contains the entire thing.  This is recursive into both lists and dicts and likely to be
@@ -1077,13 +1974,28 @@ class bt_dict_consumer : private bt_list_consumer {
     /// but aren't separately needed).  This, however, does not require dynamic memory allocation.
     template <basic_char Char = char>
     std::pair<std::string_view, std::basic_string_view<Char>> next_dict_data() {
-        if (data.size() < 2 || !is_dict())
-            throw bt_deserialize_invalid_type{"next bt dict value is not a dict"};
-        return {flush_key(), bt_list_consumer::consume_dict_data<Char>()};
+        bt_error err;
+        auto ret = next_dict_data<Char>(err);
+        check(err);
+        return ret;
+    }
+    /// Non-throwing version of the above: on failure, sets `err` and returns empty values.
+    template <basic_char Char = char>
+    std::pair<std::string_view, std::basic_string_view<Char>> next_dict_data(bt_error& err) {
+        std::pair<std::string_view, std::basic_string_view<Char>> ret;
+        if (next_key(err)) {
+            ret.second = bt_list_consumer::consume_dict_data<Char>(err);
+            if (!err)
+                ret.first = flush_key();
+        }
+        return ret;
     }
 
     /// Same as next_dict_data(), but wraps the value in a bt_dict_consumer for convenience
-    std::pair<std::string_view, bt_dict_consumer> next_dict_consumer() { return next_dict_data(); }
+    std::pair<std::string_view, bt_dict_consumer> next_dict_consumer() {
+        auto [key, dict] = next_dict_data();
+        return {key, nested(bt_dict_consumer{dict})};
+    }
 
     /// Parses the next value as a string->string pair that has been constructed to contain a
     /// signature produced via bt_dict_producer::append_signature.  Returns a tuple of three
@@ -1145,11 +2057,20 @@ class bt_dict_consumer : private bt_list_consumer {
     ///   however, make a copy of the bt_dict_consumer before calling and use the copy to return to
     ///   the pre-skipped position).
     bool skip_until(std::string_view find) {
-        while (consume_key() && key_ < find) {
+        bt_error err;
+        bool found = skip_until(find, err);
+        check(err);
+        return found;
+    }
+    /// Non-throwing version of the above: returns false and sets `err` on failure.
+    bool skip_until(std::string_view find, bt_error& err) {
+        while (consume_key(err) && key_ < find) {
+            skip_value(err);
+            if (err)
+                return false;
             flush_key();
-            skip_value();
         }
-        return key_ == find;
+        return !err && key_ == find;
     }
 
     /// This functions nearly identically to skip_until; it will return if we found an exact match
@@ -1168,6 +2089,12 @@ class bt_dict_consumer : private bt_list_consumer {
         if (!skip_until(find))
             throw std::out_of_range{"Key " + std::string{find} + " not found!"};
     }
+    /// Non-throwing version of the above: sets `err` on failure, including when the key is not
+    /// found (with code bt_errc::missing_key).
+    void required(std::string_view find, bt_error& err) {
+        if (!skip_until(find, err) && !err)
+            set_error(err, bt_errc::missing_key, data);
+    }
 
     /// The `consume_*` functions are wrappers around next_whatever that discard the returned key.
     ///
@@ -1183,14 +2110,26 @@ class bt_dict_consumer : private bt_list_consumer {
         return next_string<Char>().second;
     }
     template <basic_char Char = char>
+    auto consume_string_view(bt_error& err) {
+        return next_string<Char>(err).second;
+    }
+    template <basic_char Char = char>
     auto consume_string() {
         return std::basic_string<Char>{consume_string_view<Char>()};
     }
+    template <basic_char Char = char>
+    auto consume_string(bt_error& err) {
+        return std::basic_string<Char>{consume_string_view<Char>(err)};
+    }
 
     template <typename IntType>
     auto consume_integer() {
         return next_integer<IntType>().second;
     }
+    template <typename IntType>
+    auto consume_integer(bt_error& err) {
+        return next_integer<IntType>(err).second;
+    }
 
     template <typename T = bt_list>
     auto consume_list() {
@@ -1201,6 +2140,10 @@ class bt_dict_consumer : private bt_list_consumer {
     void consume_list(T& list) {
         next_list(list);
     }
+    template <typename T>
+    void consume_list(T& list, bt_error& err) {
+        next_list(list, err);
+    }
 
     template <typename T = bt_dict>
     auto consume_dict() {
@@ -1211,20 +2154,46 @@ class bt_dict_consumer : private bt_list_consumer {
     void consume_dict(T& dict) {
         next_dict(dict);
     }
+    template <typename T>
+    void consume_dict(T& dict, bt_error& err) {
+        next_dict(dict, err);
+    }
 
     template <basic_char Char = char>
     std::basic_string_view<Char> consume_list_data() {
         return next_list_data<Char>().second;
     }
     template <basic_char Char = char>
+    std::basic_string_view<Char> consume_list_data(bt_error& err) {
+        return next_list_data<Char>(err).second;
+    }
+    template <basic_char Char = char>
     std::basic_string_view<Char> consume_dict_data() {
         return next_dict_data<Char>().second;
     }
+    template <basic_char Char = char>
+    std::basic_string_view<Char> consume_dict_data(bt_error& err) {
+        return next_dict_data<Char>(err).second;
+    }
 
     /// Shortcut for wrapping `consume_list_data()` in a new list consumer
-    bt_list_consumer consume_list_consumer() { return consume_list_data(); }
+    bt_list_consumer consume_list_consumer() {
+        return nested(bt_list_consumer{consume_list_data()});
+    }
     /// Shortcut for wrapping `consume_dict_data()` in a new dict consumer
-    bt_dict_consumer consume_dict_consumer() { return consume_dict_data(); }
+    bt_dict_consumer consume_dict_consumer() {
+        return nested(bt_dict_consumer{consume_dict_data()});
+    }
+    /// Non-throwing versions of the above; on failure these set `err` and return an empty
+    /// consumer.
+    bt_list_consumer consume_list_consumer(bt_error& err) {
+        auto list = consume_list_data(err);
+        return nested(bt_list_consumer{err ? "le"sv : list});
+    }
+    bt_dict_consumer consume_dict_consumer(bt_error& err) {
+        auto dict = consume_dict_data(err);
+        return nested(bt_dict_consumer{err ? "de"sv : dict});
+    }
 
     /// Consumes and verifies a signature.  This method, unlike the above consume_ functions, is a
     /// little different from its `next_signature` counterpart: it returns nothing, but takes a
@@ -1282,6 +2251,11 @@ class bt_dict_consumer : private bt_list_consumer {
     T consume() {
         return detail::consume_impl<T>(*this);
     }
+    /// Non-throwing version of the above: on failure, sets `err` (and returns an empty value).
+    template <typename T>
+    T consume(bt_error& err) {
+        return detail::consume_impl<T>(*this, err);
+    }
 
     /// Advances to and requires the given key (as if by calling `required()`) and then throws if
     /// the key was not found; otherwise returns the value parsed into the given type.
@@ -1290,6 +2264,14 @@ class bt_dict_consumer : private bt_list_consumer {
         required(key);
         return consume<T>();
     }
+    /// Non-throwing version of the above: on failure, sets `err` (and returns an empty value).
+    template <typename T>
+    T require(std::string_view key, bt_error& err) {
+        required(key, err);
+        if (err)
+            return detail::empty_consume_value<T>();
+        return consume<T>(err);
+    }
 
     /// Advances to and requires the given key (as if by calling `required()`) and then throws if
     /// the key was not found; otherwise calls consume_signature() with the given verification
@@ -1310,6 +2292,17 @@ class bt_dict_consumer : private bt_list_consumer {
             return std::nullopt;
         return consume<T>();
     }
+    /// Non-throwing version of the above: returns std::nullopt, with `err` set, on failure (and
+    /// std::nullopt with `err` cleared if the key is not present).
+    template <typename T>
+    std::optional<T> maybe(std::string_view key, bt_error& err) {
+        if (!skip_until(key, err))
+            return std::nullopt;
+        auto val = consume<T>(err);
+        if (err)
+            return std::nullopt;
+        return val;
+    }
 
     /// Finishes reading the dict by reading through (and ignoring) any remaining keys until it
     /// reaches the end of the dict, and confirms that the end of the dict is in fact the end of the
@@ -1319,60 +2312,399 @@ class bt_dict_consumer : private bt_list_consumer {
     /// It is not required to call this, but not calling it will not notice if there is invalid data
     /// later in the dict or after the end of the dict.
     void finish() {
-        while (!is_finished()) {
+        bt_error err;
+        finish(err);
+        check(err);
+    }
+    /// Non-throwing version of the above: sets `err` on failure.
+    void finish(bt_error& err) {
+        while (consume_key(err)) {
+            skip_value(err);
+            if (err)
+                return;
             flush_key();
-            skip_value();
         }
+        if (err)
+            return;
         // If we consumed the entire buffer we should have only the terminating 'e' left (and
-        // `is_finished()` already checked that it is in fact an `e`).
+        // `consume_key()` already checked that it is in fact an `e`).
         if (data.size() != 1)
-            throw bt_deserialize_invalid{"Dict finished without consuming the entire buffer"};
+            set_error(err, bt_errc::trailing_data, data.substr(1));
     }
 };
 
 inline bt_dict_consumer bt_list_consumer::consume_dict_consumer() {
-    return consume_dict_data();
+    return nested(bt_dict_consumer{consume_dict_data()});
+}
+inline bt_dict_consumer bt_list_consumer::consume_dict_consumer(bt_error& err) {
+    auto dict = consume_dict_data(err);
+    return nested(bt_dict_consumer{err ? "de"sv : dict});
 }
 
 namespace detail {
+    // Consumer positioned at a single value inside some larger bt-encoded data, used to parse the
+    // values found by bt_dict_index.  Error offsets are relative to `whole`.
+    class bt_single_value_consumer : public bt_list_consumer {
+      public:
+        bt_single_value_consumer(std::string_view whole, std::string_view value) :
+                bt_list_consumer{value, load_tag{}} {
+            start = whole.data();
+        }
+    };
+}  // namespace detail
 
-    /// Reads digits into an unsigned 64-bit int.
-    inline uint64_t extract_unsigned(std::string_view& s) {
+/// Random-access view of a bt-encoded dict.  Construction makes a single validating pass over the
+/// dict, recording where each key and value is; after that any key can be looked up (in any order,
+/// any number of times) with a binary search rather than a forward scan.  Like the consumers, this
+/// does not copy the data, and so the caller must ensure that the referenced memory stays valid for
+/// the lifetime of the bt_dict_index object.
+///
+/// Dicts with up to `inline_capacity` keys are indexed without any heap allocation; larger dicts
+/// allocate one vector to hold the index.
+///
+/// Example:
+///
+///     bt_dict_index req{data};
+///     auto method = req.require<std::string_view>("method");
+///     auto id = req.find<int64_t>("id");
+///     auto params = req.require<bt_dict_consumer>("params");
+class bt_dict_index {
+  public:
+    static constexpr size_t inline_capacity = 32;
+
+  private:
+    struct entry {
+        const char* key;
+        size_t key_size;
+        const char* end;  // End of the value (which begins immediately after the key)
+
+        std::string_view key_view() const { return {key, key_size}; }
+        std::string_view value() const {
+            return {key + key_size, static_cast<size_t>(end - key - key_size)};
+        }
+    };
+
+    std::string_view data_;
+    size_t size_ = 0;
+    std::array<entry, inline_capacity> inline_;
+    std::vector<entry> heap_;
+
+    const entry* entries() const {
+        return size_ <= inline_capacity ? inline_.data() : heap_.data();
+    }
+
+    void push(const entry& e) {
+        if (size_ < inline_capacity)
+            inline_[size_] = e;
+        else {
+            if (size_ == inline_capacity)
+                heap_.assign(inline_.begin(), inline_.end());
+            heap_.push_back(e);
+        }
+        size_++;
+    }
+
+    const entry* lookup(std::string_view key) const {
+        auto* begin = entries();
+        auto* end = begin + size_;
+        auto* it = std::lower_bound(begin, end, key, [](const entry& e, std::string_view k) {
+            return e.key_view() < k;
+        });
+        return it != end && it->key_view() == key ? it : nullptr;
+    }
+
+    static void check(const bt_error& err) {
+        if (err) [[unlikely]]
+            detail::throw_bt_error(err);
+    }
+
+    void index(std::string_view data, bt_error& err) {
+        data_ = data;
+        err = {};
+        auto fail = [&](bt_errc code, std::string_view at) {
+            err = {code, static_cast<size_t>(at.data() - data.data())};
+            data_ = "de"sv;
+            size_ = 0;
+            heap_.clear();
+        };
+        if (data.size() < 2 || data[0] != 'd')
+            return fail(data.size() < 2 ? bt_errc::truncated : bt_errc::wrong_type, data);
+        std::string_view s = data.substr(1), prev;
+        while (true) {
+            if (s.empty())
+                return fail(bt_errc::truncated, s);
+            if (s[0] == 'e')
+                break;
+            std::string_view key;
+            std::string_view next{s};
+            auto ec = detail::bt_deserialize<std::string_view>{}.parse(next, key);
+            if (ec != bt_errc::ok)
+                return fail(ec == bt_errc::wrong_type ? bt_errc::invalid_key : ec, next);
+            if (size_ > 0 && key <= prev)
+                return fail(bt_errc::unsorted_key, s);
+            if (next.empty() || next[0] == 'e')
+                return fail(next.empty() ? bt_errc::truncated : bt_errc::missing_value, next);
+            if (ec = detail::bt_skip_value(next); ec != bt_errc::ok)
+                return fail(ec, next);
+            push({key.data(), key.size(), next.data()});
+            prev = key;
+            s = next;
+        }
+        if (s.size() > 1)
+            return fail(bt_errc::trailing_data, s.substr(1));
+    }
+
+  public:
+    /// Indexes the given bt-encoded dict, which must make up the entire input.  Throws a
+    /// bt_deserialize_invalid exception if the data is not a valid bt-encoded dict, or if its keys
+    /// are not unique and sorted.
+    explicit bt_dict_index(std::string_view data) {
+        bt_error err;
+        index(data, err);
+        check(err);
+    }
+    explicit bt_dict_index(std::basic_string_view<unsigned char> data) :
+            bt_dict_index{
+                    std::string_view{reinterpret_cast<const char*>(data.data()), data.size()}} {}
+    explicit bt_dict_index(std::basic_string_view<std::byte> data) :
+            bt_dict_index{
+                    std::string_view{reinterpret_cast<const char*>(data.data()), data.size()}} {}
+
+    /// Non-throwing constructor: on failure `err` is set and the index is left empty.  `err` is
+    /// cleared on success.
+    bt_dict_index(std::string_view data, bt_error& err) { index(data, err); }
+
+    /// Returns the number of keys in the dict.
+    size_t size() const { return size_; }
+    /// Returns true if the dict has no keys.
+    bool empty() const { return size_ == 0; }
+    /// Returns the entire encoded dict.
+    std::string_view data() const { return data_; }
+
+    /// Returns true if the dict contains the given key.
+    bool contains(std::string_view key) const { return lookup(key); }
+
+    /// Returns the encoded value of the given key, or an empty string_view if the key is not
+    /// present.  (Encoded values are never empty).
+    std::string_view find_data(std::string_view key) const {
+        auto* e = lookup(key);
+        return e ? e->value() : std::string_view{};
+    }
+
+    /// Looks up the given key and returns its value parsed into the given type (string_view,
+    /// string, integer, bt_dict_consumer, etc., as with `bt_dict_consumer::consume<T>()`), or
+    /// std::nullopt if the key is not present.  Throws if the key exists but has an incompatible
+    /// value.
+    template <typename T>
+    std::optional<T> find(std::string_view key) const {
+        bt_error err;
+        auto val = find<T>(key, err);
+        check(err);
+        return val;
+    }
+    /// Non-throwing version of the above: returns std::nullopt, with `err` set, if the value can't
+    /// be parsed (and std::nullopt with `err` cleared if the key is not present).
+    template <typename T>
+    std::optional<T> find(std::string_view key, bt_error& err) const {
+        err = {};
+        auto* e = lookup(key);
+        if (!e)
+            return std::nullopt;
+        detail::bt_single_value_consumer c{data_, e->value()};
+        auto val = detail::consume_impl<T>(c, err);
+        if (err)
+            return std::nullopt;
+        return val;
+    }
+
+    /// Same as find(), but throws std::out_of_range if the key is not present.
+    template <typename T>
+    T require(std::string_view key) const {
+        if (auto val = find<T>(key))
+            return *std::move(val);
+        throw std::out_of_range{"Key " + std::string{key} + " not found!"};
+    }
+    /// Non-throwing version of the above: on failure, sets `err` (with bt_errc::missing_key if the
+    /// key is not present) and returns an empty value.
+    template <typename T>
+    T require(std::string_view key, bt_error& err) const {
+        if (auto val = find<T>(key, err))
+            return *std::move(val);
+        if (!err)
+            err = {bt_errc::missing_key, data_.size() - 1};
+        return detail::empty_consume_value<T>();
+    }
+};
+
+namespace detail {
+
+    // SWAR helpers for extract_unsigned: these operate on 8 input chars loaded little-endian into
+    // a uint64_t (so that the first char is in the least significant byte).
+
+    // Returns the number (0-8) of leading chars of `x` that are ASCII digits.
+    inline int swar_digit_count(uint64_t x) {
+        // A byte is a digit iff its high nibble is 3 and its low nibble + 6 doesn't carry into the
+        // high nibble; this leaves a 0 byte for each digit, and non-zero for anything else.
+        uint64_t m = ((x & 0xF0F0F0F0F0F0F0F0) ^ 0x3030303030303030) |
+                     (((x & 0x0F0F0F0F0F0F0F0F) + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0);
+        return std::countr_zero(m) / 8;
+    }
+
+    // Returns the value of the first `n` (1-8) chars of `x`, which must all be digits.
+    inline uint64_t swar_parse_digits(uint64_t x, int n) {
+        x -= 0x3030303030303030;
+        // Shift out whatever follows the digits; this leaves 0 bytes (i.e. leading 0 digits) at
+        // the beginning, which don't change the value.
+        x <<= 8 * (8 - n);
+        x = x * 10 + (x >> 8);  // Pairs of digits
+        x = ((x & 0x000000FF000000FF) * (100 + (1000000ULL << 32)) +
+             ((x >> 16) & 0x000000FF000000FF) * (1 + (10000ULL << 32))) >>
+            32;
+        return static_cast<uint32_t>(x);
+    }
+
+    struct extracted_unsigned {
+        uint64_t value;
+        const char* end;  // One past the last digit, or nullptr if the value overflowed
+    };
+
+    // Long path of extract_unsigned for 5 or more digits.  This takes and returns plain pointers,
+    // rather than the caller's string_view by reference, so that an out-of-line call doesn't force
+    // the caller to keep its string_view in memory.
+    inline extracted_unsigned extract_unsigned_long(const char* p, const char* end) {
+        constexpr uint64_t pow10[] = {
+                1, 10, 100, 1'000, 10'000, 100'000, 1'000'000, 10'000'000, 100'000'000};
+
+        // Common case: up to 20 digits with enough data after them to load 8 chars at a time.
+        if (end - p >= 24) {
+            auto x = load_little_to_host<uint64_t>(p);
+            int n = swar_digit_count(x);
+            if (n < 8)
+                return {swar_parse_digits(x, n), p + n};
+            uint64_t uval = swar_parse_digits(x, 8);
+            x = load_little_to_host<uint64_t>(p + 8);
+            n = swar_digit_count(x);
+            if (n < 8)
+                return {n ? uval * pow10[n] + swar_parse_digits(x, n) : uval, p + 8 + n};
+            uval = uval * pow10[8] + swar_parse_digits(x, 8);
+            x = load_little_to_host<uint64_t>(p + 16);
+            n = swar_digit_count(x);
+            if (n < 4)
+                return {n ? uval * pow10[n] + swar_parse_digits(x, n) : uval, p + 16 + n};
+            // 20+ digits: fall through to the general case below
+        }
+
+        // Find the length of the digit run (8 chars at a time where we can):
+        const char* q = p;
+        int d = 8;
+        while (d == 8 && end - q >= 8) {
+            d = swar_digit_count(load_little_to_host<uint64_t>(q));
+            q += d;
+        }
+        if (d == 8)
+            while (q < end && *q >= '0' && *q <= '9')
+                q++;
+
+        // Leading 0s aren't valid bt-encoding, but have always been tolerated here:
+        while (q - p > 20 && *p == '0')
+            p++;
+        if (q - p > 20)  // 2^64 has 20 digits
+            return {0, nullptr};
+
+        // Up to 19 digits can't overflow, so we accumulate those without any checks, then add the
+        // 20th digit (if there is one) with an overflow check.
+        const char* safe_end = std::min(q, p + 19);
         uint64_t uval = 0;
-        bool once = false;
-        while (!s.empty() && (s[0] >= '0' && s[0] <= '9')) {
-            once = true;
-            uint64_t bigger = uval * 10 + static_cast<uint64_t>(s[0] - '0');
-            s.remove_prefix(1);
-            if (bigger < uval)  // overflow
-                throw bt_deserialize_invalid(
-                        "Integer deserialization failed: value is too large for a 64-bit int");
-            uval = bigger;
+        while (p < safe_end) {
+            int n = static_cast<int>(std::min<ptrdiff_t>(8, safe_end - p));
+            if (end - p >= 8)
+                uval = uval * pow10[n] + swar_parse_digits(load_little_to_host<uint64_t>(p), n);
+            else
+                for (const char* c = p; c < p + n; c++)
+                    uval = uval * 10 + static_cast<uint64_t>(*c - '0');
+            p += n;
+        }
+        if (p < q) {
+            auto last = static_cast<uint64_t>(*p - '0');
+            if (uval > (std::numeric_limits<uint64_t>::max() - last) / 10)
+                return {0, nullptr};
+            uval = uval * 10 + last;
+        }
+        return {uval, q};
+    }
+
+    // Pointer-based version of extract_unsigned(s, val), for use by code that walks the data with
+    // plain pointers: reads digits starting at `p` (which must be < `end`) into `val` and advances
+    // `p` past them.  `p` is not changed on failure.
+    inline bt_errc extract_unsigned(const char*& p, const char* end, uint64_t& val) {
+        // Short path for 1-4 digits (e.g. string length prefixes).  This is deliberately plain
+        // scalar code: when parsing a sequence of values the position of the next value depends on
+        // the number of digits, and predicted branches let the CPU carry on speculatively where
+        // computing the digit count via SWAR would have to wait on the loaded data.
+        size_t n = std::min<size_t>(static_cast<size_t>(end - p), 5);
+        if (n == 0 || p[0] < '0' || p[0] > '9')
+            return bt_errc::expected_digit;
+        auto uval = static_cast<uint64_t>(p[0] - '0');
+        for (size_t i = 1; i < n; i++) {
+            if (p[i] < '0' || p[i] > '9') {
+                p += i;
+                val = uval;
+                return bt_errc::ok;
+            }
+            if (i == 4) {
+                auto [v, digits_end] = extract_unsigned_long(p, end);
+                if (!digits_end)
+                    return bt_errc::integer_overflow;
+                p = digits_end;
+                val = v;
+                return bt_errc::ok;
+            }
+            uval = uval * 10 + static_cast<uint64_t>(p[i] - '0');
         }
-        if (!once)
-            throw bt_deserialize_invalid{"Expected 0-9 was not found"};
-        return uval;
+        p += n;
+        val = uval;
+        return bt_errc::ok;
+    }
+
+    inline bt_errc extract_unsigned(std::string_view& s, uint64_t& val) {
+        const char* p = s.data();
+        auto ec = extract_unsigned(p, p + s.size(), val);
+        s.remove_prefix(static_cast<size_t>(p - s.data()));
+        return ec;
+    }
+
+    /// Reads digits into an unsigned 64-bit int.
+    inline uint64_t extract_unsigned(std::string_view& s) {
+        uint64_t val;
+        bt_check(extract_unsigned(s, val));
+        return val;
     }
 
-    inline void bt_deserialize<std::string_view>::operator()(
+    inline bt_errc bt_deserialize<std::string_view>::parse(
             std::string_view& s, std::string_view& val) {
-        if (s.size() < 2)
-            throw bt_deserialize_invalid{
-                    "Deserialize failed: given data is not an bt-encoded string"};
+        if (s.empty())
+            return bt_errc::truncated;
         if (s[0] < '0' || s[0] > '9')
-            throw bt_deserialize_invalid_type{"Expected 0-9 but found '"s + s[0] + "'"};
-        auto len = static_cast<size_t>(extract_unsigned(s));
-        if (s.empty() || s[0] != ':')
-            throw bt_deserialize_invalid{"Did not find expected ':' during string deserialization"};
-        s.remove_prefix(1);
+            return bt_errc::wrong_type;
+        std::string_view next{s};
+        uint64_t len;
+        if (auto ec = extract_unsigned(next, len); ec != bt_errc::ok)
+            return ec;
+        if (next.empty())
+            return bt_errc::truncated;
+        if (next[0] != ':') {
+            s = next;
+            return bt_errc::expected_colon;
+        }
+        next.remove_prefix(1);
 
-        if (len > s.size())
-            throw bt_deserialize_invalid{
-                    "String deserialization failed: encoded string length is longer than the "
-                    "serialized data"};
+        if (len > next.size())
+            return bt_errc::truncated;
 
-        val = {s.data(), len};
-        s.remove_prefix(len);
+        val = {next.data(), static_cast<size_t>(len)};
+        next.remove_prefix(static_cast<size_t>(len));
+        s = next;
+        return bt_errc::ok;
     }
 
     // Check that we are on a 2's complement architecture.  It's highly unlikely that this code ever
@@ -1385,71 +2717,88 @@ namespace detail {
                             (uint64_t{1} << 63),
             "Non 2s-complement architecture not supported!");
 
-    inline std::pair<some64, bool> bt_deserialize_integer(std::string_view& s) {
+    inline bt_errc bt_deserialize_integer(std::string_view& s, std::pair<some64, bool>& result) {
         // Smallest possible encoded integer is 3 chars: "i0e"
-        if (s.size() < 3)
-            throw bt_deserialize_invalid(
-                    "Deserialization failed: end of string found where integer expected");
+        if (s.empty())
+            return bt_errc::truncated;
         if (s[0] != 'i')
-            throw bt_deserialize_invalid_type(
-                    "Deserialization failed: expected 'i', found '"s + s[0] + '\'');
-        s.remove_prefix(1);
-        std::pair<some64, bool> result;
+            return bt_errc::wrong_type;
+        if (s.size() < 3)
+            return bt_errc::truncated;
+        std::string_view next{s.substr(1)};
         auto& [val, negative] = result;
-        if (s[0] == '-') {
-            negative = true;
-            s.remove_prefix(1);
-            val.u64 = extract_unsigned(s);
-            if (val.u64 > (uint64_t{1} << 63))
-                throw bt_deserialize_invalid(
-                        "Deserialization of integer failed: negative integer value is too large "
-                        "for a 64-bit signed int");
-            val.i64 = -static_cast<int64_t>(val.u64);
-        } else {
-            val.u64 = extract_unsigned(s);
+        negative = next[0] == '-';
+        if (negative)
+            next.remove_prefix(1);
+        if (auto ec = extract_unsigned(next, val.u64); ec != bt_errc::ok) {
+            s = next;
+            return ec;
+        }
+        if (negative) {
+            if (val.u64 > (uint64_t{1} << 63)) {
+                s = next;
+                return bt_errc::integer_overflow;
+            }
+            val.i64 = static_cast<int64_t>(-val.u64);
         }
 
-        if (s.empty())
-            throw bt_deserialize_invalid(
-                    "Integer deserialization failed: encountered end of string before integer was "
-                    "finished");
-        if (s[0] != 'e')
-            throw bt_deserialize_invalid(
-                    "Integer deserialization failed: expected digit or 'e', found '"s + s[0] +
-                    '\'');
-        s.remove_prefix(1);
+        if (next.empty()) {
+            s = next;
+            return bt_errc::truncated;
+        }
+        if (next[0] != 'e') {
+            s = next;
+            return bt_errc::expected_end;
+        }
+        next.remove_prefix(1);
+        s = next;
+        return bt_errc::ok;
+    }
 
+    inline std::pair<some64, bool> bt_deserialize_integer(std::string_view& s) {
+        std::pair<some64, bool> result;
+        bt_check(bt_deserialize_integer(s, result));
         return result;
     }
 
     template struct bt_deserialize<int64_t>;
     template struct bt_deserialize<uint64_t>;
 
-    inline void bt_deserialize<bt_value>::operator()(std::string_view& s, bt_value& val) {
-        if (s.size() < 2)
-            throw bt_deserialize_invalid(
-                    "Deserialization failed: end of string found where bt-encoded value expected");
+    // Common implementation of bt_value and bt_flat_value deserialization.  Nested lists/dicts
+    // are parsed by recursion, so we limit the depth to avoid exhausting the stack.
+    template <typename Value, typename Dict, typename List, bool View>
+    bt_errc bt_deserialize_value(std::string_view& s, Value& val, size_t max_depth) {
+        if (s.empty())
+            return bt_errc::truncated;
 
+        auto parse_nested = [max_depth](std::string_view& s, Value& v) {
+            return bt_deserialize_value<Value, Dict, List, View>(s, v, max_depth - 1);
+        };
         switch (s[0]) {
             case 'd': {
-                bt_dict dict;
-                bt_deserialize<bt_dict>{}(s, dict);
+                if (max_depth == 0)
+                    return bt_errc::too_deep;
+                Dict dict;
+                auto ec = bt_deserialize<Dict>{}.parse(s, dict, parse_nested);
                 val = std::move(dict);
-                break;
+                return ec;
             }
             case 'l': {
-                bt_list list;
-                bt_deserialize<bt_list>{}(s, list);
+                if (max_depth == 0)
+                    return bt_errc::too_deep;
+                List list;
+                auto ec = bt_deserialize<List>{}.parse(s, list, parse_nested);
                 val = std::move(list);
-                break;
+                return ec;
             }
             case 'i': {
-                auto [v, negative] = bt_deserialize_integer(s);
-                if (negative)
+                std::pair<some64, bool> parsed;
+                auto ec = bt_deserialize_integer(s, parsed);
+                if (auto& [v, negative] = parsed; negative)
                     val = v.i64;
                 else
                     val = v.u64;
-                break;
+                return ec;
             }
             case '0':
             case '1':
@@ -1461,16 +2810,204 @@ namespace detail {
             case '7':
             case '8':
             case '9': {
-                std::string str;
-                bt_deserialize<std::string>{}(s, str);
-                val = std::move(str);
-                break;
+                if constexpr (View) {
+                    std::string_view str;
+                    auto ec = bt_deserialize<std::string_view>{}.parse(s, str);
+                    val = str;
+                    return ec;
+                } else {
+                    std::string str;
+                    auto ec = bt_deserialize<std::string>{}.parse(s, str);
+                    val = std::move(str);
+                    return ec;
+                }
             }
-            default:
-                throw bt_deserialize_invalid(
-                        "Deserialize failed: encountered invalid value '"s + s[0] +
-                        "'; expected one of [0-9idl]");
+            default: return bt_errc::invalid_value;
+        }
+    }
+
+    inline bt_errc bt_deserialize<bt_value>::parse(std::string_view& s, bt_value& val) {
+        return bt_deserialize_value<bt_value, bt_dict, bt_list>(s, val, bt_default_max_depth);
+    }
+
+    inline bt_errc bt_deserialize<bt_flat_value>::parse(std::string_view& s, bt_flat_value& val) {
+        return bt_deserialize_value<bt_flat_value, bt_flat_dict, bt_flat_list>(
+                s, val, bt_default_max_depth);
+    }
+
+    inline bt_errc bt_skip_value(std::string_view& s, size_t max_depth) {
+        return bt_validate_value(s, false, max_depth);
+    }
+
+    inline bt_errc bt_validate_value(
+            std::string_view& s, bool check_key_order, size_t max_depth) {
+        bt_null_visitor v;
+        return bt_walk_value(s, check_key_order, max_depth, v);
+    }
+
+    template <typename Visitor>
+    bt_errc bt_walk_value(
+            std::string_view& s, bool check_key_order, size_t max_depth, Visitor& v) {
+        // This walks the data with plain pointers (rather than string_views passed by reference to
+        // the value parsers) so that the position stays in a register, and rather than recursing
+        // into lists and dicts keeps its own stack of the open containers (and, for dicts, the
+        // previous key for checking the key order).
+        struct frame {
+            bool dict;
+            const char* prev_key;  // nullptr until the dict's first key
+            size_t prev_key_size;
+        };
+        std::array<frame, 64> inline_stack;
+        std::vector<frame> heap_stack;
+        size_t depth = 0;
+        frame* top = nullptr;
+
+        const char* p = s.data();
+        const char* const end = p + s.size();
+        auto fail = [&](bt_errc ec, const char* at) {
+            s.remove_prefix(static_cast<size_t>(at - s.data()));
+            return ec;
+        };
+
+        // Reads a string at `p`, which must start with a digit, and advances `p` past it.  Error
+        // positions are the same as those of bt_deserialize<std::string_view>.
+        auto read_string = [&end](const char*& p, std::string_view& str) {
+            const char* q = p;
+            uint64_t len;
+            if (auto ec = extract_unsigned(q, end, len); ec != bt_errc::ok)
+                return ec;
+            if (q == end)
+                return bt_errc::truncated;
+            if (*q != ':') {
+                p = q;
+                return bt_errc::expected_colon;
+            }
+            q++;
+            if (len > static_cast<uint64_t>(end - q))
+                return bt_errc::truncated;
+            str = {q, static_cast<size_t>(len)};
+            p = q + len;
+            return bt_errc::ok;
+        };
+
+        while (true) {
+            if (top) {
+                // We're at the next element of a list or the next key of a dict (or the end of
+                // either)
+                if (p == end)
+                    return fail(bt_errc::truncated, p);
+                if (*p == 'e') {
+                    p++;
+                    if (top->dict) {
+                        if constexpr (requires { v.end_dict(); })
+                            v.end_dict();
+                    } else {
+                        if constexpr (requires { v.end_list(); })
+                            v.end_list();
+                    }
+                    if (depth > inline_stack.size())
+                        heap_stack.pop_back();
+                    if (--depth == 0)
+                        break;
+                    top = depth <= inline_stack.size() ? &inline_stack[depth - 1]
+                                                       : &heap_stack.back();
+                    continue;
+                }
+                if (top->dict) {
+                    const char* key_start = p;
+                    if (*p < '0' || *p > '9')
+                        return fail(bt_errc::invalid_key, p);
+                    std::string_view key;
+                    if (auto ec = read_string(p, key); ec != bt_errc::ok)
+                        return fail(ec, p);
+                    if (check_key_order) {
+                        if (top->prev_key &&
+                            key <= std::string_view{top->prev_key, top->prev_key_size})
+                            return fail(bt_errc::unsorted_key, key_start);
+                        top->prev_key = key.data();
+                        top->prev_key_size = key.size();
+                    }
+                    if constexpr (requires { v.key(key); })
+                        v.key(key);
+                    if (p == end || *p == 'e')
+                        return fail(p == end ? bt_errc::truncated : bt_errc::missing_value, p);
+                }
+            } else if (p == end) {
+                return fail(bt_errc::truncated, p);
+            }
+
+            switch (*p) {
+                case 'l':
+                case 'd': {
+                    if (depth == max_depth)
+                        return fail(bt_errc::too_deep, p);
+                    frame f{*p == 'd', nullptr, 0};
+                    if (depth < inline_stack.size())
+                        top = &(inline_stack[depth] = f);
+                    else
+                        top = &heap_stack.emplace_back(f);
+                    depth++;
+                    if (f.dict) {
+                        if constexpr (requires { v.begin_dict(); })
+                            v.begin_dict();
+                    } else {
+                        if constexpr (requires { v.begin_list(); })
+                            v.begin_list();
+                    }
+                    p++;
+                    continue;
+                }
+                case 'i': {
+                    // Error positions are the same as those of bt_deserialize_integer
+                    if (end - p < 3)
+                        return fail(bt_errc::truncated, p);
+                    const char* q = p + 1;
+                    bool negative = *q == '-';
+                    if (negative)
+                        q++;
+                    uint64_t val;
+                    if (auto ec = extract_unsigned(q, end, val); ec != bt_errc::ok)
+                        return fail(ec, q);
+                    if (negative && val > (uint64_t{1} << 63))
+                        return fail(bt_errc::integer_overflow, q);
+                    if (q == end)
+                        return fail(bt_errc::truncated, q);
+                    if (*q != 'e')
+                        return fail(bt_errc::expected_end, q);
+                    if (negative) {
+                        if constexpr (requires { v.integer(bt_exactly<int64_t>{}); })
+                            v.integer(static_cast<int64_t>(0 - val));
+                    } else {
+                        if constexpr (requires { v.integer(bt_exactly<uint64_t>{}); })
+                            v.integer(val);
+                    }
+                    p = q + 1;
+                    break;
+                }
+                case '0':
+                case '1':
+                case '2':
+                case '3':
+                case '4':
+                case '5':
+                case '6':
+                case '7':
+                case '8':
+                case '9': {
+                    std::string_view str;
+                    if (auto ec = read_string(p, str); ec != bt_errc::ok)
+                        return fail(ec, p);
+                    if constexpr (requires { v.string(str); })
+                        v.string(str);
+                    break;
+                }
+                default: return fail(bt_errc::invalid_value, p);
+            }
+            if (!top)
+                break;
         }
+        s.remove_prefix(static_cast<size_t>(p - s.data()));
+        return bt_errc::ok;
     }
 
 }  // namespace detail
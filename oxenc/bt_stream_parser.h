@@ -0,0 +1,405 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include "bt_serialize.h"
+
+namespace oxenc {
+
+/** \file
+ * Incremental ("push") parser for bt-encoded data that arrives in pieces, such as from a socket.
+ *
+ * Rather than requiring the entire message in one contiguous buffer, a `bt_stream_parser` accepts
+ * the data one chunk at a time, remembering where it is between chunks in a small state stack, and
+ * reports what it parses by calling methods of a handler object (SAX-style).  Strings are reported
+ * as views of the chunks themselves (in fragments, if a string is split across chunks), so large
+ * values are never copied or buffered by the parser.
+ *
+ * Handler methods are all optional: the parser only calls the ones that the handler has.
+ *
+ *     struct handler {
+ *         void begin_list();
+ *         void end_list();
+ *         void begin_dict();
+ *         void end_dict();
+ *         // Called with the (possibly partial) contents of a dict key: `fragment` contains
+ *         // bytes [offset, offset+fragment.size()) of a key of `size` bytes.  Every key produces
+ *         // at least one call (even if empty), and fragments are always reported in order.
+ *         void key(std::string_view fragment, uint64_t offset, uint64_t size);
+ *         // Same as key(), but for string values.
+ *         void string(std::string_view fragment, uint64_t offset, uint64_t size);
+ *         // Called with an integer value: int64_t for negative values, uint64_t otherwise.  (Only
+ *         // methods taking exactly int64_t/uint64_t are called; a handler that has only one of
+ *         // them does not get the other type converted to it).
+ *         void integer(int64_t value);
+ *         void integer(uint64_t value);
+ *     };
+ *
+ *     bt_stream_parser parser;
+ *     handler h;
+ *     while (!parser.done()) {
+ *         auto chunk = socket.read(std::max<uint64_t>(parser.needed(), 4096));
+ *         bt_error err;
+ *         auto used = parser.feed(chunk, h, err);
+ *         if (err)
+ *             return close_connection(err);
+ *         // If the message ended within this chunk, then chunk.substr(used) is the beginning of
+ *         // the next message.
+ *     }
+ *
+ * The parser accepts the same data as the other deserializers, except that it imposes no
+ * requirements on dict key order.
+ *
+ * For just finding where each message of a stream ends, see bt_frame_length() below.
+ */
+class bt_stream_parser {
+    enum class state : uint8_t {
+        value,       // At the start of a value, dict key, or list/dict end
+        int_start,   // After the 'i' of an integer
+        int_digits,  // In the digits of an integer
+        str_len,     // In the length prefix of a string (or key)
+        str_data,    // In the contents of a string (or key)
+        done,        // Finished parsing a complete value
+        failed,      // Failed (and `error_` is set)
+    };
+
+    state state_ = state::value;
+    bool key_ = false;       // True if the current string is a dict key
+    bool want_key_ = false;  // True if the next thing in the current dict is a key (or the end)
+    bool negative_ = false;
+    bool have_digit_ = false;
+    uint64_t num_ = 0;      // The integer value or string length being parsed
+    uint64_t str_pos_ = 0;  // How much of the current string we have already passed on
+    std::vector<bool> stack_;  // One element per open list (false) or dict (true)
+    size_t max_depth_;
+    uint64_t offset_ = 0;
+    bt_error error_;
+
+    // Updates the state after finishing a complete value.
+    void value_done() {
+        if (stack_.empty())
+            state_ = state::done;
+        else {
+            state_ = state::value;
+            want_key_ = stack_.back();
+        }
+    }
+
+    static uint64_t saturating_add(uint64_t a, uint64_t b) {
+        return b > std::numeric_limits<uint64_t>::max() - a ? std::numeric_limits<uint64_t>::max()
+                                                            : a + b;
+    }
+
+  public:
+    /// Constructs a parser for a single bt-encoded value.  Lists and dicts may be nested at most
+    /// `max_depth` deep.
+    explicit bt_stream_parser(size_t max_depth = bt_default_max_depth) : max_depth_{max_depth} {}
+
+    /// Parses as much of `data` as possible, calling the methods of `handler` as values are parsed,
+    /// and returns the number of bytes consumed.  This is all of `data` unless the end of the value
+    /// was reached (in which case the remaining data is left unconsumed) or the data is invalid.
+    ///
+    /// On failure `err` is set (with the offset relative to the beginning of the *stream*, i.e. the
+    /// total number of bytes before the error, including previous chunks), and every further call
+    /// fails with the same error until the parser is reset.  `err` is cleared on success.
+    template <typename Handler>
+    size_t feed(std::string_view data, Handler&& handler, bt_error& err);
+
+    /// Same as above, but throws a bt_deserialize_invalid exception on failure.
+    template <typename Handler>
+    size_t feed(std::string_view data, Handler&& handler) {
+        bt_error err;
+        auto used = feed(data, handler, err);
+        if (err)
+            detail::throw_bt_error(err);
+        return used;
+    }
+
+    /// Returns true once a complete value has been parsed.
+    bool done() const { return state_ == state::done; }
+
+    /// Returns true if parsing has failed.
+    bool failed() const { return state_ == state::failed; }
+
+    /// Returns the error of a failed parser (or a cleared error if it hasn't failed).
+    const bt_error& error() const { return error_; }
+
+    /// Returns a lower bound on the number of bytes still needed to complete the value: i.e. the
+    /// value cannot be complete until at least this many more bytes have been fed, but may need
+    /// more.  This accounts for the remaining contents of a partially received string, so when
+    /// receiving a large string value this reports the entire remainder of the string.  Returns 0
+    /// if done or failed.
+    uint64_t needed() const {
+        if (state_ == state::done || state_ == state::failed)
+            return 0;
+        uint64_t n = stack_.size();  // The `e`s to close open lists/dicts
+        switch (state_) {
+            case state::value:
+                // We need a value (at least 2 bytes, e.g. "le") at the top level or after a dict
+                // key; otherwise we could be at the end of a list or dict.
+                if (stack_.empty() || (stack_.back() && !want_key_))
+                    n += 2;
+                break;
+            case state::int_start: n += 2; break;
+            case state::int_digits: n += have_digit_ ? 1 : 2; break;
+            case state::str_len: n = saturating_add(n, saturating_add(num_, 1)); break;
+            case state::str_data: n = saturating_add(n, num_ - str_pos_); break;
+            default: break;
+        }
+        if (key_)
+            n = saturating_add(n, 2);  // The key's value
+        return n;
+    }
+
+    /// Returns the current list/dict nesting depth.
+    size_t depth() const { return stack_.size(); }
+
+    /// Returns the total number of bytes consumed so far.
+    uint64_t offset() const { return offset_; }
+
+    /// Resets the parser to parse a new value (keeping the depth limit).
+    void reset() {
+        state_ = state::value;
+        key_ = want_key_ = negative_ = have_digit_ = false;
+        num_ = str_pos_ = offset_ = 0;
+        stack_.clear();
+        error_ = {};
+    }
+};
+
+template <typename Handler>
+size_t bt_stream_parser::feed(std::string_view data, Handler&& h, bt_error& err) {
+    const char* const begin = data.data();
+    const char* const end = begin + data.size();
+    const char* p = begin;
+    auto fail = [&](bt_errc code) {
+        state_ = state::failed;
+        error_ = {code, static_cast<size_t>(offset_ + static_cast<uint64_t>(p - begin))};
+    };
+    auto is_digit = [](char c) { return c >= '0' && c <= '9'; };
+
+    while (p < end && state_ != state::done && state_ != state::failed) {
+        switch (state_) {
+            case state::value: {
+                char c = *p;
+                bool in_dict = !stack_.empty() && stack_.back();
+                if (c == 'e' && !stack_.empty() && (!in_dict || want_key_)) {
+                    p++;
+                    stack_.pop_back();
+                    if (in_dict) {
+                        if constexpr (requires { h.end_dict(); })
+                            h.end_dict();
+                    } else {
+                        if constexpr (requires { h.end_list(); })
+                            h.end_list();
+                    }
+                    value_done();
+                    break;
+                }
+                if (in_dict && want_key_) {
+                    if (!is_digit(c)) {
+                        fail(bt_errc::invalid_key);
+                        break;
+                    }
+                    key_ = true;
+                }
+                switch (c) {
+                    case 'l':
+                    case 'd':
+                        if (stack_.size() >= max_depth_) {
+                            fail(bt_errc::too_deep);
+                            break;
+                        }
+                        p++;
+                        stack_.push_back(c == 'd');
+                        want_key_ = c == 'd';
+                        if (c == 'd') {
+                            if constexpr (requires { h.begin_dict(); })
+                                h.begin_dict();
+                        } else {
+                            if constexpr (requires { h.begin_list(); })
+                                h.begin_list();
+                        }
+                        break;
+                    case 'i':
+                        p++;
+                        state_ = state::int_start;
+                        break;
+                    default:
+                        if (is_digit(c)) {
+                            // The digit itself gets consumed in the str_len state
+                            state_ = state::str_len;
+                            num_ = 0;
+                        } else {
+                            fail(c == 'e' && in_dict ? bt_errc::missing_value
+                                                     : bt_errc::invalid_value);
+                        }
+                }
+                break;
+            }
+
+            case state::int_start:
+                negative_ = *p == '-';
+                if (negative_)
+                    p++;
+                num_ = 0;
+                have_digit_ = false;
+                state_ = state::int_digits;
+                break;
+
+            case state::int_digits: {
+                for (; p < end && is_digit(*p); p++) {
+                    auto d = static_cast<uint64_t>(*p - '0');
+                    if (num_ > (std::numeric_limits<uint64_t>::max() - d) / 10) {
+                        fail(bt_errc::integer_overflow);
+                        break;
+                    }
+                    num_ = num_ * 10 + d;
+                    have_digit_ = true;
+                }
+                if (p == end || state_ == state::failed)
+                    break;
+                if (!have_digit_) {
+                    fail(bt_errc::expected_digit);
+                    break;
+                }
+                if (*p != 'e') {
+                    fail(bt_errc::expected_end);
+                    break;
+                }
+                if (negative_) {
+                    if (num_ > (uint64_t{1} << 63)) {
+                        fail(bt_errc::integer_overflow);
+                        break;
+                    }
+                    if constexpr (requires { h.integer(detail::bt_exactly<int64_t>{}); })
+                        h.integer(static_cast<int64_t>(0 - num_));
+                } else {
+                    if constexpr (requires { h.integer(detail::bt_exactly<uint64_t>{}); })
+                        h.integer(num_);
+                }
+                p++;
+                value_done();
+                break;
+            }
+
+            case state::str_len: {
+                for (; p < end && is_digit(*p); p++) {
+                    auto d = static_cast<uint64_t>(*p - '0');
+                    if (num_ > (std::numeric_limits<uint64_t>::max() - d) / 10) {
+                        fail(bt_errc::integer_overflow);
+                        break;
+                    }
+                    num_ = num_ * 10 + d;
+                }
+                if (p == end || state_ == state::failed)
+                    break;
+                if (*p != ':') {
+                    fail(bt_errc::expected_colon);
+                    break;
+                }
+                p++;
+                str_pos_ = 0;
+                state_ = state::str_data;
+                if (num_ > 0)
+                    break;
+                // An empty string still gets reported:
+                [[fallthrough]];
+            }
+
+            case state::str_data: {
+                auto avail = static_cast<uint64_t>(end - p);
+                auto n = static_cast<size_t>(std::min(avail, num_ - str_pos_));
+                std::string_view fragment{p, n};
+                if (key_) {
+                    if constexpr (requires { h.key(fragment, str_pos_, num_); })
+                        h.key(fragment, str_pos_, num_);
+                } else {
+                    if constexpr (requires { h.string(fragment, str_pos_, num_); })
+                        h.string(fragment, str_pos_, num_);
+                }
+                p += n;
+                str_pos_ += n;
+                if (str_pos_ == num_) {
+                    if (key_) {
+                        key_ = false;
+                        want_key_ = false;
+                        state_ = state::value;
+                    } else {
+                        value_done();
+                    }
+                }
+                break;
+            }
+
+            case state::done:
+            case state::failed: break;
+        }
+    }
+
+    offset_ += static_cast<uint64_t>(p - begin);
+    err = error_;
+    return static_cast<size_t>(p - begin);
+}
+
+/// Result of bt_frame_length.
+struct bt_frame {
+    /// True if the data contains a complete value.
+    bool complete = false;
+    /// If not complete, a lower bound on the number of additional bytes needed to complete the
+    /// value (see bt_stream_parser::needed()).
+    uint64_t needed = 0;
+    /// If complete, the length of the value; otherwise the number of bytes examined so far (i.e.
+    /// all of them, unless the data is invalid).
+    size_t length = 0;
+    /// Set if the data is not a valid bt-encoded value.
+    bt_error error;
+};
+
+/// Finds the end of the bt-encoded value at the beginning of `data`, for framing messages that are
+/// sent back to back on a stream.  `state` holds the progress from previous calls with the same
+/// (but shorter) data, so that each call only has to examine the newly received bytes:
+///
+///     bt_stream_parser state;
+///     std::string buf;
+///     while (true) {
+///         buf += socket.read();
+///         auto frame = bt_frame_length(buf, state);
+///         if (frame.error)
+///             return close_connection(frame.error);
+///         while (frame.complete) {
+///             dispatch(std::string_view{buf}.substr(0, frame.length));
+///             buf.erase(0, frame.length);
+///             state.reset();
+///             frame = bt_frame_length(buf, state);
+///         }
+///     }
+///
+/// `data` must begin with the same bytes as were passed in previous calls with the same `state`
+/// (since the last reset).  Throws std::invalid_argument if `data` is shorter than what was
+/// previously examined.  Once the frame is complete (or invalid) further calls return the same
+/// result until the state is reset.
+inline bt_frame bt_frame_length(std::string_view data, bt_stream_parser& state) {
+    if (data.size() < state.offset())
+        throw std::invalid_argument{"bt_frame_length: data is shorter than the saved state"};
+    bt_frame frame;
+    state.feed(data.substr(static_cast<size_t>(state.offset())), detail::bt_null_visitor{},
+               frame.error);
+    frame.complete = state.done();
+    frame.needed = state.needed();
+    frame.length = static_cast<size_t>(state.offset());
+    return frame;
+}
+
+/// Same as above, but without saved state: examines `data` from the beginning.
+inline bt_frame bt_frame_length(std::string_view data, size_t max_depth = bt_default_max_depth) {
+    bt_stream_parser state{max_depth};
+    return bt_frame_length(data, state);
+}
+
+}  // namespace oxenc
@@ -0,0 +1,274 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+
+#include "bt_producer.h"
+#include "bt_serialize.h"
+
+namespace oxenc {
+
+/** \file
+ * Serialization of structs to and from bt-encoded dicts, driven by a compile-time description of
+ * the struct's fields.  A struct describes its fields by providing a static constexpr `bt_fields()`
+ * method returning a tuple of `bt_field`s, each of which gives a dict key and the struct member it
+ * maps to:
+ *
+ *     struct request {
+ *         uint64_t id;
+ *         std::string method;
+ *         std::optional<int64_t> ns;
+ *         std::vector<std::string> tags;
+ *         params p;  // Another struct with bt_fields()
+ *
+ *         static constexpr auto bt_fields() {
+ *             return std::tuple{
+ *                     oxenc::bt_field{"id", &request::id},
+ *                     oxenc::bt_field{"method", &request::method},
+ *                     oxenc::bt_field{"ns", &request::ns},
+ *                     oxenc::bt_field{"tags", &request::tags},
+ *                     oxenc::bt_field{"params", &request::p}};
+ *         }
+ *     };
+ *
+ *     std::string encoded = oxenc::bt_serialize_struct(req);
+ *     auto req2 = oxenc::bt_deserialize_struct<request>(encoded);
+ *
+ * Fields may be listed in any order: they are sorted by key at compile time (and duplicate keys
+ * are a compile-time error), so the serializer always writes the keys in the required order, and
+ * the deserializer reads the fields in a single pass through the dict, in key order, comparing
+ * against constant keys (and skipping any keys that the struct doesn't know about).
+ *
+ * Supported member types are those that bt_dict_producer::append and bt_dict_consumer::consume
+ * support (integers, strings, string_views, lists, tuples, etc.), plus:
+ * - other structs with bt_fields(), which are encoded as nested dicts;
+ * - lists (e.g. vectors) of such structs, encoded as a list of dicts;
+ * - std::optional of any of the above, for optional keys: an empty optional is omitted when
+ *   serializing, and left empty when the key is absent when deserializing.  Every non-optional
+ *   field is required when deserializing.
+ */
+
+/// Describes one field of a struct: its dict key and the member it is stored in.
+template <typename Class, typename Member>
+struct bt_field {
+    std::string_view key;
+    Member Class::* member;
+
+    constexpr bt_field(std::string_view key, Member Class::* member) : key{key}, member{member} {}
+};
+
+/// Concept for a struct that describes its fields for bt_serialize_struct and friends.
+template <typename T>
+concept bt_struct = requires {
+    { std::tuple_size<decltype(T::bt_fields())>::value };
+};
+
+namespace detail {
+
+    template <typename T>
+    constexpr bool is_optional = false;
+    template <typename T>
+    constexpr bool is_optional<std::optional<T>> = true;
+
+    template <typename T>
+    concept bt_struct_list =
+            bt_output_list_container<T> && bt_struct<typename T::value_type> && requires(T v) {
+                v.begin();
+                v.end();
+            };
+
+    /// The number of fields of bt_struct T.
+    template <bt_struct T>
+    constexpr size_t bt_field_count = std::tuple_size_v<decltype(T::bt_fields())>;
+
+    /// The keys of bt_struct T, in the order that T lists them.
+    template <bt_struct T>
+    constexpr auto bt_field_keys() {
+        return std::apply(
+                [](const auto&... f) {
+                    return std::array<std::string_view, sizeof...(f)>{f.key...};
+                },
+                T::bt_fields());
+    }
+
+    /// Indices of the fields of bt_struct T, sorted by key.
+    template <bt_struct T>
+    constexpr auto bt_field_order = [] {
+        constexpr auto keys = bt_field_keys<T>();
+        std::array<size_t, keys.size()> order{};
+        for (size_t i = 0; i < order.size(); i++)
+            order[i] = i;
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return keys[a] < keys[b];
+        });
+        return order;
+    }();
+
+    /// The key of field J of bt_struct T, as a compile-time bt_key.
+    template <bt_struct T, size_t J>
+    constexpr auto bt_field_key = [] {
+        constexpr auto key = std::get<J>(T::bt_fields()).key;
+        return bt_key<key.size() + 1>{key};
+    }();
+
+    template <bt_struct T>
+    constexpr bool bt_field_keys_unique() {
+        constexpr auto keys = bt_field_keys<T>();
+        constexpr auto& order = bt_field_order<T>;
+        for (size_t i = 1; i < order.size(); i++)
+            if (keys[order[i - 1]] == keys[order[i]])
+                return false;
+        return true;
+    }
+
+    template <bt_struct T>
+    void bt_append_fields(bt_dict_producer& d, const T& val);
+
+    template <bt_key Key, typename M>
+    void bt_append_field(bt_dict_producer& d, const M& val) {
+        if constexpr (is_optional<M>) {
+            if (val)
+                bt_append_field<Key>(d, *val);
+        } else if constexpr (bt_struct<M>) {
+            auto sub = d.append_dict<Key>();
+            bt_append_fields(sub, val);
+        } else if constexpr (bt_struct_list<M>) {
+            auto list = d.append_list<Key>();
+            for (const auto& elem : val) {
+                auto sub = list.append_dict();
+                bt_append_fields(sub, elem);
+            }
+        } else if constexpr (std::integral<M> || string_view_compatible<M>) {
+            d.append<Key>(val);
+        } else {
+            d.append(Key.view(), val);
+        }
+    }
+
+    template <bt_struct T>
+    void bt_append_fields(bt_dict_producer& d, const T& val) {
+        static_assert(bt_field_keys_unique<T>(), "bt_fields() contains a duplicate key");
+        constexpr auto fields = T::bt_fields();
+        [&]<size_t... I>(std::index_sequence<I...>) {
+            (bt_append_field<bt_field_key<T, bt_field_order<T>[I]>>(
+                     d, val.*(std::get<bt_field_order<T>[I]>(fields).member)),
+             ...);
+        }(std::make_index_sequence<bt_field_count<T>>{});
+    }
+
+    template <bt_struct T>
+    void bt_load_fields(bt_dict_consumer& c, T& val, bt_error& err);
+
+    template <typename M>
+    void bt_load_field(bt_dict_consumer& c, M& val, bt_error& err) {
+        if constexpr (is_optional<M>) {
+            bt_load_field(c, val.emplace(), err);
+        } else if constexpr (bt_struct<M>) {
+            auto sub = c.consume_dict_consumer(err);
+            if (!err)
+                bt_load_fields(sub, val, err);
+        } else if constexpr (bt_struct_list<M>) {
+            auto list = c.consume_list_consumer(err);
+            val.clear();
+            while (!err && !list.is_finished()) {
+                auto sub = list.consume_dict_consumer(err);
+                if (!err)
+                    bt_load_fields(sub, *val.insert(val.end(), typename M::value_type{}), err);
+            }
+        } else {
+            val = c.consume<M>(err);
+        }
+    }
+
+    template <bt_struct T>
+    void bt_load_fields(bt_dict_consumer& c, T& val, bt_error& err) {
+        static_assert(bt_field_keys_unique<T>(), "bt_fields() contains a duplicate key");
+        constexpr auto fields = T::bt_fields();
+        auto load_one = [&]<size_t J>(std::integral_constant<size_t, J>) {
+            constexpr auto field = std::get<J>(fields);
+            auto& member = val.*(field.member);
+            if constexpr (is_optional<std::remove_cvref_t<decltype(member)>>) {
+                if (c.skip_until(field.key, err))
+                    bt_load_field(c, member, err);
+                else
+                    member.reset();
+            } else {
+                c.required(field.key, err);
+                if (!err)
+                    bt_load_field(c, member, err);
+            }
+            return !err;
+        };
+        err = {};
+        [&]<size_t... I>(std::index_sequence<I...>) {
+            (load_one(std::integral_constant<size_t, bt_field_order<T>[I]>{}) && ...);
+        }(std::make_index_sequence<bt_field_count<T>>{});
+    }
+
+}  // namespace detail
+
+/// Appends the fields of `val` to dict producer `d`.  The struct's keys must all sort after any
+/// keys already in `d`, and any keys added after this must sort after the struct's keys.
+template <bt_struct T>
+void bt_append_struct(bt_dict_producer& d, const T& val) {
+    detail::bt_append_fields(d, val);
+}
+
+/// Serializes `val` as a bt-encoded dict, returned as a std::string.
+template <bt_struct T>
+std::string bt_serialize_struct(const T& val) {
+    bt_dict_producer d;
+    detail::bt_append_fields(d, val);
+    return std::move(d).str();
+}
+
+/// Loads the fields of `val` from dict consumer `c`.  The consumer is left positioned after the
+/// last of the struct's keys (so that further keys can be read from it).  Throws a
+/// bt_deserialize_invalid exception if a required field is missing (with code
+/// bt_errc::missing_key) or has an invalid value.  If this throws then `val` may have been
+/// partially updated.
+template <bt_struct T>
+void bt_load_struct(bt_dict_consumer& c, T& val) {
+    bt_error err;
+    detail::bt_load_fields(c, val, err);
+    if (err)
+        detail::throw_bt_error(err);
+}
+
+/// Non-throwing version of the above: sets `err` on failure (and clears it on success).  Note that
+/// errors in nested structs have offsets relative to the nested dict.
+template <bt_struct T>
+void bt_load_struct(bt_dict_consumer& c, T& val, bt_error& err) {
+    detail::bt_load_fields(c, val, err);
+}
+
+/// Deserializes a struct from a bt-encoded dict, which must be the entire input.  Throws a
+/// bt_deserialize_invalid exception on failure.
+template <bt_struct T>
+T bt_deserialize_struct(std::string_view data) {
+    T val{};
+    bt_dict_consumer c{data};
+    bt_load_struct(c, val);
+    c.finish();
+    return val;
+}
+
+/// Non-throwing version of bt_deserialize_struct: deserializes into `val`, returning a set bt_error
+/// on failure (in which case `val` may have been partially updated).
+template <bt_struct T>
+bt_error bt_try_deserialize_struct(std::string_view data, T& val) {
+    bt_error err;
+    bt_dict_consumer c{data, err};
+    if (!err)
+        detail::bt_load_fields(c, val, err);
+    if (!err)
+        c.finish(err);
+    return err;
+}
+
+}  // namespace oxenc
@@ -3,14 +3,20 @@
 // This header is here to provide just the basic bt_value/bt_dict/bt_list definitions without
 // needing to include the full bt_serialize.h header.
 
+#include <algorithm>
 #include <concepts>
+#include <cstddef>
 #include <cstdint>
+#include <initializer_list>
 #include <list>
 #include <map>
+#include <stdexcept>
 #include <string>
 #include <string_view>
 #include <type_traits>
+#include <utility>
 #include <variant>
+#include <vector>
 
 namespace oxenc {
 
@@ -26,9 +32,9 @@ using bt_list = std::list<bt_value>;
 using bt_variant = std::variant<std::string, std::string_view, int64_t, uint64_t, bt_list, bt_dict>;
 
 namespace detail {
-    template <typename Tuple, size_t... Is>
-    bt_list tuple_to_list(const Tuple& tuple, std::index_sequence<Is...>) {
-        return {{bt_value{std::get<Is>(tuple)}...}};
+    template <typename List, typename Tuple, size_t... Is>
+    List tuple_to_list(const Tuple& tuple, std::index_sequence<Is...>) {
+        return {{typename List::value_type{std::get<Is>(tuple)}...}};
     }
     template <typename T>
     constexpr bool is_tuple = false;
@@ -58,11 +64,11 @@ struct bt_value : bt_variant {
 
     template <typename... T>
     bt_value(const std::tuple<T...>& tuple) :
-            bt_variant{detail::tuple_to_list(tuple, std::index_sequence_for<T...>{})} {}
+            bt_variant{detail::tuple_to_list<bt_list>(tuple, std::index_sequence_for<T...>{})} {}
 
     template <typename S, typename T>
     bt_value(const std::pair<S, T>& pair) :
-            bt_variant{detail::tuple_to_list(pair, std::index_sequence_for<S, T>{})} {}
+            bt_variant{detail::tuple_to_list<bt_list>(pair, std::index_sequence_for<S, T>{})} {}
 
     template <typename T>
     requires(!std::integral<std::remove_cvref_t<T>> && !detail::is_tuple<std::remove_cvref_t<T>>)
@@ -71,4 +77,305 @@ struct bt_value : bt_variant {
     bt_value(const char* s) : bt_value{std::string_view{s}} {}
 };
 
+struct bt_flat_value;
+
+/// Flat alternative to bt_dict: a vector of key/value pairs kept sorted by key, rather than a
+/// std::map.  This provides the commonly used subset of the std::map interface (find, at,
+/// operator[], insert, emplace, erase, and sorted iteration), with lookups done via binary search.
+///
+/// Since bt-encoded dicts are sorted, deserializing into a bt_flat_dict just appends each element
+/// (an insert with an end() hint of a key greater than the current last key is a push_back).
+///
+/// As with std::map, the stored pairs have const keys, so that the keys (and thus the sort order)
+/// can't be changed through an iterator.  That means elements can't be shifted by move-assignment:
+/// an insert or erase anywhere but at the end rebuilds the vector, moving the values but copying
+/// the keys.
+class bt_flat_dict {
+  public:
+    using key_type = std::string;
+    using mapped_type = bt_flat_value;
+    using value_type = std::pair<const std::string, bt_flat_value>;
+    using container_type = std::vector<value_type>;
+    using size_type = size_t;
+    using iterator = container_type::iterator;
+    using const_iterator = container_type::const_iterator;
+
+  private:
+    container_type items;
+
+    // Constructs a new element from `args` at index `pos`.
+    template <typename... Args>
+    iterator emplace_at(size_t pos, Args&&... args);
+
+    // Rebuilds `items` with the given capacity, leaving out the element at index `skip` (if any).
+    void rebuild(size_t capacity, size_t skip = static_cast<size_t>(-1));
+
+  public:
+    bt_flat_dict() = default;
+    /// Constructs from a list of pairs, which do not need to be sorted.  If a key is duplicated,
+    /// only the first value is kept (as with std::map).
+    bt_flat_dict(std::initializer_list<value_type> init);
+
+    iterator begin();
+    iterator end();
+    const_iterator begin() const;
+    const_iterator end() const;
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+
+    size_t size() const;
+    bool empty() const;
+    void clear();
+    void reserve(size_t n);
+
+    /// Finds the element with the given key, returning end() if not found.
+    iterator find(std::string_view key);
+    const_iterator find(std::string_view key) const;
+    bool contains(std::string_view key) const;
+    size_t count(std::string_view key) const;
+
+    /// Returns the value with the given key, throwing std::out_of_range if not found.
+    bt_flat_value& at(std::string_view key);
+    const bt_flat_value& at(std::string_view key) const;
+
+    /// Returns the value with the given key, inserting a default-constructed value if not found.
+    bt_flat_value& operator[](std::string_view key);
+
+    /// Inserts a new key/value pair, if the key isn't already present.  Returns an iterator to the
+    /// inserted (or existing) element and a bool that is true if the element was inserted.
+    std::pair<iterator, bool> insert(value_type v);
+
+    /// Inserts with a hint.  Only the hint `end()` is used, to take a fast path for appending a key
+    /// greater than the current last key (i.e. when inserting elements in sorted order).
+    iterator insert(const_iterator hint, value_type v);
+
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(std::string key, Args&&... args);
+
+    /// Same as `insert(hint, ...)`, but constructs the value from `args` (and moves, rather than
+    /// copies, the key).
+    template <typename... Args>
+    iterator emplace_hint(const_iterator hint, std::string key, Args&&... args);
+
+    iterator erase(const_iterator it);
+    size_t erase(std::string_view key);
+
+    bool operator==(const bt_flat_dict& other) const;
+};
+
+/// Flat alternative to bt_list: a contiguous vector rather than a std::list.
+using bt_flat_list = std::vector<bt_flat_value>;
+
+/// Variant type of the flat representation (see bt_variant)
+using bt_flat_variant =
+        std::variant<std::string, std::string_view, int64_t, uint64_t, bt_flat_list, bt_flat_dict>;
+
+/// Flat-container equivalent of bt_value, using bt_flat_dict and bt_flat_list (rather than bt_dict
+/// and bt_list) for nested values.  It supports the same conversions as bt_value, and can be used
+/// with bt_serialize, bt_deserialize (or bt_get_flat), append_bt, get_int, and get_tuple.
+struct bt_flat_value : bt_flat_variant {
+    using bt_flat_variant::bt_flat_variant;
+    using bt_flat_variant::operator=;
+
+    template <typename T>
+    requires std::unsigned_integral<std::remove_cvref_t<T>>
+    bt_flat_value(T&& u_val) : bt_flat_variant{static_cast<uint64_t>(u_val)} {}
+
+    template <typename T>
+    requires std::signed_integral<std::remove_cvref_t<T>>
+    bt_flat_value(T&& s_val) : bt_flat_variant{static_cast<int64_t>(s_val)} {}
+
+    template <typename... T>
+    bt_flat_value(const std::tuple<T...>& tuple) :
+            bt_flat_variant{
+                    detail::tuple_to_list<bt_flat_list>(tuple, std::index_sequence_for<T...>{})} {}
+
+    template <typename S, typename T>
+    bt_flat_value(const std::pair<S, T>& pair) :
+            bt_flat_variant{
+                    detail::tuple_to_list<bt_flat_list>(pair, std::index_sequence_for<S, T>{})} {}
+
+    template <typename T>
+    requires(!std::integral<std::remove_cvref_t<T>> && !detail::is_tuple<std::remove_cvref_t<T>>)
+    bt_flat_value(T&& v) : bt_flat_variant{std::forward<T>(v)} {}
+
+    bt_flat_value(const char* s) : bt_flat_value{std::string_view{s}} {}
+};
+
+namespace detail {
+    template <typename It>
+    It flat_dict_lower_bound(It begin, It end, std::string_view key) {
+        return std::lower_bound(
+                begin, end, key, [](const auto& a, std::string_view k) { return a.first < k; });
+    }
+}  // namespace detail
+
+inline bt_flat_dict::bt_flat_dict(std::initializer_list<value_type> init) {
+    std::vector<const value_type*> sorted;
+    sorted.reserve(init.size());
+    for (const auto& v : init)
+        sorted.push_back(&v);
+    std::stable_sort(sorted.begin(), sorted.end(), [](const auto* a, const auto* b) {
+        return a->first < b->first;
+    });
+    items.reserve(sorted.size());
+    for (const auto* v : sorted)
+        if (items.empty() || items.back().first != v->first)
+            items.push_back(*v);
+}
+
+inline void bt_flat_dict::rebuild(size_t capacity, size_t skip) {
+    container_type rebuilt;
+    rebuilt.reserve(capacity);
+    for (size_t i = 0; i < items.size(); i++)
+        if (i != skip)
+            rebuilt.emplace_back(items[i].first, std::move(items[i].second));
+    items = std::move(rebuilt);
+}
+
+template <typename... Args>
+bt_flat_dict::iterator bt_flat_dict::emplace_at(size_t pos, Args&&... args) {
+    if (pos == items.size()) {
+        // vector would copy (rather than move) the values when growing, because the implicit move
+        // constructor of a pair with a const std::string isn't noexcept, so we grow it ourselves.
+        if (items.size() == items.capacity())
+            rebuild(std::max<size_t>(4, 2 * items.size()));
+        items.emplace_back(std::forward<Args>(args)...);
+        return std::prev(items.end());
+    }
+    container_type rebuilt;
+    rebuilt.reserve(
+            items.size() < items.capacity() ? items.capacity()
+                                            : std::max<size_t>(4, 2 * items.size()));
+    for (size_t i = 0; i < pos; i++)
+        rebuilt.emplace_back(items[i].first, std::move(items[i].second));
+    rebuilt.emplace_back(std::forward<Args>(args)...);
+    for (size_t i = pos; i < items.size(); i++)
+        rebuilt.emplace_back(items[i].first, std::move(items[i].second));
+    items = std::move(rebuilt);
+    return items.begin() + static_cast<ptrdiff_t>(pos);
+}
+
+inline bt_flat_dict::iterator bt_flat_dict::begin() {
+    return items.begin();
+}
+inline bt_flat_dict::iterator bt_flat_dict::end() {
+    return items.end();
+}
+inline bt_flat_dict::const_iterator bt_flat_dict::begin() const {
+    return items.begin();
+}
+inline bt_flat_dict::const_iterator bt_flat_dict::end() const {
+    return items.end();
+}
+inline size_t bt_flat_dict::size() const {
+    return items.size();
+}
+inline bool bt_flat_dict::empty() const {
+    return items.empty();
+}
+inline void bt_flat_dict::clear() {
+    items.clear();
+}
+inline void bt_flat_dict::reserve(size_t n) {
+    if (n > items.capacity())
+        rebuild(n);
+}
+
+inline bt_flat_dict::iterator bt_flat_dict::find(std::string_view key) {
+    auto it = detail::flat_dict_lower_bound(items.begin(), items.end(), key);
+    return it != items.end() && it->first == key ? it : items.end();
+}
+inline bt_flat_dict::const_iterator bt_flat_dict::find(std::string_view key) const {
+    auto it = detail::flat_dict_lower_bound(items.begin(), items.end(), key);
+    return it != items.end() && it->first == key ? it : items.end();
+}
+
+inline bool bt_flat_dict::contains(std::string_view key) const {
+    return find(key) != end();
+}
+inline size_t bt_flat_dict::count(std::string_view key) const {
+    return contains(key);
+}
+
+inline bt_flat_value& bt_flat_dict::at(std::string_view key) {
+    if (auto it = find(key); it != end())
+        return it->second;
+    throw std::out_of_range{"bt_flat_dict key not found"};
+}
+inline const bt_flat_value& bt_flat_dict::at(std::string_view key) const {
+    if (auto it = find(key); it != end())
+        return it->second;
+    throw std::out_of_range{"bt_flat_dict key not found"};
+}
+
+inline bt_flat_value& bt_flat_dict::operator[](std::string_view key) {
+    auto it = detail::flat_dict_lower_bound(items.begin(), items.end(), key);
+    if (it == items.end() || it->first != key)
+        it = emplace_at(
+                static_cast<size_t>(it - items.begin()),
+                std::piecewise_construct,
+                std::forward_as_tuple(key),
+                std::forward_as_tuple());
+    return it->second;
+}
+
+inline std::pair<bt_flat_dict::iterator, bool> bt_flat_dict::insert(value_type v) {
+    auto it = detail::flat_dict_lower_bound(items.begin(), items.end(), v.first);
+    if (it != items.end() && it->first == v.first)
+        return {it, false};
+    return {emplace_at(static_cast<size_t>(it - items.begin()), std::move(v)), true};
+}
+
+inline bt_flat_dict::iterator bt_flat_dict::insert(const_iterator hint, value_type v) {
+    if (hint == items.end() && (items.empty() || items.back().first < v.first))
+        return emplace_at(items.size(), std::move(v));
+    return insert(std::move(v)).first;
+}
+
+template <typename... Args>
+std::pair<bt_flat_dict::iterator, bool> bt_flat_dict::emplace(std::string key, Args&&... args) {
+    auto it = detail::flat_dict_lower_bound(items.begin(), items.end(), key);
+    if (it != items.end() && it->first == key)
+        return {it, false};
+    return {emplace_at(
+                    static_cast<size_t>(it - items.begin()),
+                    std::piecewise_construct,
+                    std::forward_as_tuple(std::move(key)),
+                    std::forward_as_tuple(std::forward<Args>(args)...)),
+            true};
+}
+
+template <typename... Args>
+bt_flat_dict::iterator bt_flat_dict::emplace_hint(
+        const_iterator hint, std::string key, Args&&... args) {
+    if (hint == items.end() && (items.empty() || items.back().first < key))
+        return emplace_at(
+                items.size(),
+                std::piecewise_construct,
+                std::forward_as_tuple(std::move(key)),
+                std::forward_as_tuple(std::forward<Args>(args)...));
+    return emplace(std::move(key), std::forward<Args>(args)...).first;
+}
+
+inline bt_flat_dict::iterator bt_flat_dict::erase(const_iterator it) {
+    auto pos = static_cast<size_t>(it - items.cbegin());
+    if (pos + 1 == items.size())
+        items.pop_back();
+    else
+        rebuild(items.capacity(), pos);
+    return items.begin() + static_cast<ptrdiff_t>(pos);
+}
+inline size_t bt_flat_dict::erase(std::string_view key) {
+    if (auto it = find(key); it != end()) {
+        erase(it);
+        return 1;
+    }
+    return 0;
+}
+
+inline bool bt_flat_dict::operator==(const bt_flat_dict& other) const {
+    return items == other.items;
+}
+
 }  // namespace oxenc
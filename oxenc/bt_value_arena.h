@@ -0,0 +1,371 @@
+#pragma once
+
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "bt_serialize.h"
+#include "common.h"
+
+namespace oxenc {
+
+/** \file
+ * An alternative, read-only bt_value-like tree for decoding where every node is allocated from a
+ * monotonic arena and every string (including dict keys) is a view into the source data.
+ *
+ * Decoding a message into a `bt_value` (via `bt_get()`) requires a heap allocation for every
+ * dict/list node, every key, and every string value.  Decoding with a `bt_value_arena` instead
+ * takes a handful of pointer bumps, and once the arena has grown large enough for the messages
+ * being decoded, calling `reset()` between messages means subsequent decoding does not allocate at
+ * all:
+ *
+ *     oxenc::bt_value_arena arena;
+ *     for (std::string_view msg : incoming) {
+ *         arena.reset();
+ *         auto& root = arena.parse(msg);
+ *         auto n = root.at("n").integer<int>();
+ *         for (auto& item : root.at("items").list())
+ *             handle(item.str());
+ *     }
+ *
+ * Values returned by `parse()` (and everything reachable from them) remain valid until the arena is
+ * reset or destroyed *and* as long as the source data remains valid.
+ */
+
+class bt_arena_value;
+
+/// A key/value pair of a dict inside a bt_value_arena tree.
+struct bt_arena_dict_entry;
+
+/// A read-only decoded value allocated inside a bt_value_arena.  Holds an integer, a string view
+/// into the source data, or a list or dict of child values (also inside the arena).
+class bt_arena_value {
+  public:
+    enum class type : uint8_t { string, int64, uint64, list, dict };
+
+  private:
+    friend class bt_value_arena;
+
+    type type_ = type::uint64;
+    size_t size_ = 0;  // String length, or list/dict element count
+    union {
+        const char* str_;
+        int64_t i64_;
+        uint64_t u64_ = 0;
+        const bt_arena_value* list_;
+        const bt_arena_dict_entry* dict_;
+    };
+
+    void require(type t, const char* what) const {
+        if (type_ != t)
+            throw std::invalid_argument{
+                    "bt_arena_value does not contain "s + what + "; cannot access it as one"};
+    }
+
+  public:
+    /// Returns the type of value stored.  As with bt_value, negative integers are stored as int64
+    /// and non-negative integers as uint64.
+    type kind() const { return type_; }
+
+    /// Returns true if the value is a string
+    bool is_string() const { return type_ == type::string; }
+    /// Returns true if the value is an integer (of either sign)
+    bool is_integer() const { return type_ == type::int64 || type_ == type::uint64; }
+    /// Returns true if the value is a negative integer
+    bool is_negative_integer() const { return type_ == type::int64; }
+    /// Returns true if the value is a non-negative integer
+    bool is_unsigned_integer() const { return type_ == type::uint64; }
+    /// Returns true if the value is a list
+    bool is_list() const { return type_ == type::list; }
+    /// Returns true if the value is a dict
+    bool is_dict() const { return type_ == type::dict; }
+
+    /// Returns the string (as a view into the source data).  Throws std::invalid_argument if this
+    /// value is not a string.
+    std::string_view str() const {
+        require(type::string, "a string");
+        return {str_, size_};
+    }
+
+    /// Returns the integer, which must fit into the given integral type.  Throws
+    /// std::invalid_argument if this value is not an integer, or std::overflow_error if the value
+    /// doesn't fit into `IntType` (the same as `get_int<IntType>()` does for a bt_value).
+    template <std::integral IntType>
+    IntType integer() const {
+        if (type_ == type::uint64) {
+            if constexpr (!std::same_as<IntType, uint64_t>)
+                if (u64_ > static_cast<uint64_t>(std::numeric_limits<IntType>::max()))
+                    throw std::overflow_error(
+                            "Unable to extract integer value: stored value is too large for the "
+                            "requested type");
+            return static_cast<IntType>(u64_);
+        }
+        require(type::int64, "an integer");
+        if constexpr (!std::same_as<IntType, int64_t>)
+            if (i64_ > static_cast<int64_t>(std::numeric_limits<IntType>::max()) ||
+                i64_ < static_cast<int64_t>(std::numeric_limits<IntType>::min()))
+                throw std::overflow_error(
+                        "Unable to extract integer value: stored value is outside the range of "
+                        "the requested type");
+        return static_cast<IntType>(i64_);
+    }
+
+    /// Returns the list elements.  Throws std::invalid_argument if this value is not a list.
+    std::span<const bt_arena_value> list() const {
+        require(type::list, "a list");
+        return {list_, size_};
+    }
+
+    /// Returns the dict elements, sorted by key.  Throws std::invalid_argument if this value is not
+    /// a dict.
+    std::span<const bt_arena_dict_entry> dict() const;
+
+    /// Returns the string length, or the number of list or dict elements.  Returns 0 for integers.
+    size_t size() const { return is_integer() ? 0 : size_; }
+
+    /// Looks up a key in a dict value (with a binary search), returning a pointer to the value if
+    /// found, nullptr if not found.  Throws std::invalid_argument if this value is not a dict.
+    const bt_arena_value* find(std::string_view key) const;
+
+    /// Same as `find()`, but throws a std::out_of_range if the key does not exist.
+    const bt_arena_value& at(std::string_view key) const {
+        if (auto* v = find(key))
+            return *v;
+        throw std::out_of_range{"Key '" + std::string{key} + "' not found in bt_arena_value dict"};
+    }
+};
+
+struct bt_arena_dict_entry {
+    std::string_view key;
+    bt_arena_value value;
+};
+
+inline std::span<const bt_arena_dict_entry> bt_arena_value::dict() const {
+    require(type::dict, "a dict");
+    return {dict_, size_};
+}
+
+inline const bt_arena_value* bt_arena_value::find(std::string_view key) const {
+    auto d = dict();
+    auto it = std::lower_bound(d.begin(), d.end(), key, [](const auto& e, std::string_view k) {
+        return e.key < k;
+    });
+    if (it != d.end() && it->key == key)
+        return &it->value;
+    return nullptr;
+}
+
+/// Monotonic arena for decoding bt-encoded data into a tree of `bt_arena_value`s.  Memory is
+/// allocated in chunks that are only released when the arena is destroyed; `reset()` makes all the
+/// memory available again (invalidating any previously parsed values).
+class bt_value_arena {
+    struct chunk {
+        std::unique_ptr<std::byte[]> data;
+        size_t size;
+    };
+    std::vector<chunk> chunks;
+    size_t current = 0;  // Index of the chunk we are currently allocating from
+    std::byte* pos = nullptr;
+    std::byte* end = nullptr;
+    size_t next_chunk_size;
+
+    // Reusable stack of parsed values that we accumulate list/dict elements into until we know how
+    // many there are.
+    std::vector<bt_arena_value> scratch;
+
+    // Allocates (uninitialized) space for `n` Ts inside the arena.
+    template <typename T>
+    T* allocate(size_t n) {
+        static_assert(std::is_trivially_destructible_v<T>);
+        auto bytes = n * sizeof(T);
+        auto align_pad = [this] {
+            return (alignof(T) - reinterpret_cast<uintptr_t>(pos) % alignof(T)) % alignof(T);
+        };
+        while (static_cast<size_t>(end - pos) < bytes + align_pad())
+            next_chunk(bytes + alignof(T));
+        pos += align_pad();
+        auto* p = reinterpret_cast<T*>(pos);
+        pos += bytes;
+        return p;
+    }
+
+    // Moves on to the next chunk, reusing it if it is big enough, or allocating a new one if not.
+    void next_chunk(size_t min_size) {
+        if (chunks.empty() || current + 1 >= chunks.size() ||
+            chunks[current + 1].size < min_size) {
+            auto size = std::max(next_chunk_size, min_size);
+            chunks.insert(
+                    chunks.begin() + static_cast<ptrdiff_t>(chunks.empty() ? 0 : current + 1),
+                    chunk{std::make_unique_for_overwrite<std::byte[]>(size), size});
+            next_chunk_size = size * 2;
+        }
+        if (pos)
+            current++;
+        pos = chunks[current].data.get();
+        end = pos + chunks[current].size;
+    }
+
+    bt_arena_value parse_value(std::string_view& s, size_t max_depth);
+
+  public:
+    /// Constructs an arena.  `initial_size` is the size of the first chunk of memory, which will be
+    /// allocated the first time something is parsed; later chunks double in size.
+    explicit bt_value_arena(size_t initial_size = 4096) : next_chunk_size{initial_size} {}
+
+    bt_value_arena(bt_value_arena&&) = default;
+    bt_value_arena& operator=(bt_value_arena&&) = default;
+
+    /// Parses a bt-encoded value, returning a reference to the root value.  The returned value (and
+    /// all values reachable from it) stays valid until `reset()` is called or the arena is
+    /// destroyed, but contains views into `data` and so also requires that `data` stays valid.
+    ///
+    /// Throws a bt_deserialize_invalid if the data is not a single, valid bt-encoded value, or if it
+    /// contains lists/dicts nested more than `max_depth` deep (with error code bt_errc::too_deep).
+    /// Memory allocated during a failed parse is not reclaimed until the next reset().
+    const bt_arena_value& parse(std::string_view data, size_t max_depth = bt_default_max_depth) {
+        scratch.clear();
+        auto val = parse_value(data, max_depth);
+        if (!data.empty())
+            throw bt_deserialize_invalid{
+                    "Deserialization failed: did not consume the entire encoded string"};
+        return *std::construct_at(allocate<bt_arena_value>(1), val);
+    }
+    template <basic_char Char>
+    const bt_arena_value& parse(
+            std::basic_string_view<Char> data, size_t max_depth = bt_default_max_depth) {
+        return parse(
+                std::string_view{reinterpret_cast<const char*>(data.data()), data.size()},
+                max_depth);
+    }
+
+    /// Invalidates all previously parsed values and makes all of the arena memory available for
+    /// reuse.  If more than one chunk of memory was allocated, they are replaced by a single chunk
+    /// of the combined size, so that parsing a similar amount of data again will not allocate.
+    void reset() {
+        if (chunks.size() > 1) {
+            size_t total = 0;
+            for (auto& c : chunks)
+                total += c.size;
+            chunks.clear();
+            chunks.push_back(chunk{std::make_unique_for_overwrite<std::byte[]>(total), total});
+            next_chunk_size = total * 2;
+        }
+        current = 0;
+        pos = chunks.empty() ? nullptr : chunks.front().data.get();
+        end = chunks.empty() ? nullptr : pos + chunks.front().size;
+    }
+
+    /// Returns the total number of bytes of memory allocated by the arena.
+    size_t capacity() const {
+        size_t total = 0;
+        for (auto& c : chunks)
+            total += c.size;
+        return total;
+    }
+};
+
+// Nested lists/dicts are parsed by recursion, so we limit the depth to avoid exhausting the stack.
+inline bt_arena_value bt_value_arena::parse_value(std::string_view& s, size_t max_depth) {
+    if (s.size() < 2)
+        throw bt_deserialize_invalid(
+                "Deserialization failed: end of string found where bt-encoded value expected");
+
+    bt_arena_value val;
+    switch (s[0]) {
+        case 'd':
+        case 'l': {
+            if (max_depth == 0)
+                throw bt_deserialize_invalid{bt_errc::too_deep};
+            bool dict = s[0] == 'd';
+            s.remove_prefix(1);
+            size_t base = scratch.size();
+            while (!s.empty() && s[0] != 'e') {
+                if (dict) {
+                    std::string_view key;
+                    detail::bt_deserialize<std::string_view>{}(s, key);
+                    auto& k = scratch.emplace_back();
+                    k.type_ = bt_arena_value::type::string;
+                    k.str_ = key.data();
+                    k.size_ = key.size();
+                }
+                auto v = parse_value(s, max_depth - 1);
+                scratch.push_back(v);
+            }
+            if (s.empty())
+                throw bt_deserialize_invalid(
+                        "Deserialization failed: encountered end of string before "s +
+                        (dict ? "dict" : "list") + " was finished");
+            s.remove_prefix(1);  // Consume the 'e'
+
+            auto elems = std::span{scratch}.subspan(base);
+            if (dict) {
+                val.type_ = bt_arena_value::type::dict;
+                val.size_ = elems.size() / 2;
+                auto* entries = allocate<bt_arena_dict_entry>(val.size_);
+                for (size_t i = 0; i < val.size_; i++)
+                    std::construct_at(
+                            entries + i,
+                            std::string_view{elems[2 * i].str_, elems[2 * i].size_},
+                            elems[2 * i + 1]);
+                // Keys are supposed to be sorted already, but if they aren't, sort them so that
+                // lookups work.  (A stable sort so that, as with bt_dict, the first of any
+                // duplicate keys is the one that gets found).
+                auto by_key = [](const auto& a, const auto& b) { return a.key < b.key; };
+                if (!std::is_sorted(entries, entries + val.size_, by_key))
+                    std::stable_sort(entries, entries + val.size_, by_key);
+                val.dict_ = entries;
+            } else {
+                val.type_ = bt_arena_value::type::list;
+                val.size_ = elems.size();
+                auto* items = allocate<bt_arena_value>(val.size_);
+                std::uninitialized_copy(elems.begin(), elems.end(), items);
+                val.list_ = items;
+            }
+            scratch.resize(base);
+            break;
+        }
+        case 'i': {
+            auto [v, negative] = detail::bt_deserialize_integer(s);
+            if (negative) {
+                val.type_ = bt_arena_value::type::int64;
+                val.i64_ = v.i64;
+            } else {
+                val.type_ = bt_arena_value::type::uint64;
+                val.u64_ = v.u64;
+            }
+            break;
+        }
+        case '0':
+        case '1':
+        case '2':
+        case '3':
+        case '4':
+        case '5':
+        case '6':
+        case '7':
+        case '8':
+        case '9': {
+            std::string_view str;
+            detail::bt_deserialize<std::string_view>{}(s, str);
+            val.type_ = bt_arena_value::type::string;
+            val.str_ = str.data();
+            val.size_ = str.size();
+            break;
+        }
+        default:
+            throw bt_deserialize_invalid(
+                    "Deserialize failed: encountered invalid value '"s + s[0] +
+                    "'; expected one of [0-9idl]");
+    }
+    return val;
+}
+
+}  // namespace oxenc
@@ -4,30 +4,48 @@
 #include "bt_value.h"
 #include "variant.h"
 
-/// This header provides the implementations of append_bt(bt_value/bt_list/bt_dict) for
-/// bt_serialize.  (It is optional to avoid unnecessary includes when not wanted).
+/// This header provides the implementations of append_bt(bt_value/bt_list/bt_dict), and of their
+/// flat equivalents (bt_flat_value/bt_flat_list/bt_flat_dict), for bt_serialize.  (It is optional
+/// to avoid unnecessary includes when not wanted).
 
 namespace oxenc {
 
 namespace detail {
 
-    void serialize_list(bt_list_producer& out, const bt_list& l);
-    void serialize_dict(bt_dict_producer& out, const bt_dict& l);
+    template <typename List>
+    void serialize_list(bt_list_producer& out, const List& l);
+    template <typename Dict>
+    void serialize_dict(bt_dict_producer& out, const Dict& l);
+
+    inline const bt_variant& as_variant(const bt_value& v) {
+        return v;
+    }
+    inline const bt_flat_variant& as_variant(const bt_flat_value& v) {
+        return v;
+    }
+
+    template <typename T>
+    concept bt_value_dict = std::same_as<T, bt_dict> || std::same_as<T, bt_flat_dict>;
+    template <typename T>
+    concept bt_value_list = std::same_as<T, bt_list> || std::same_as<T, bt_flat_list>;
 
     struct dict_appender {
         bt_dict_producer& out;
         std::string_view key;
         dict_appender(bt_dict_producer& out, std::string_view key) : out{out}, key{key} {}
 
-        void operator()(const bt_dict& d) {
+        template <bt_value_dict D>
+        void operator()(const D& d) {
             auto subdict = out.append_dict(key);
             serialize_dict(subdict, d);
         }
-        void operator()(const bt_list& l) {
+        template <bt_value_list L>
+        void operator()(const L& l) {
             auto sublist = out.append_list(key);
             serialize_list(sublist, l);
         }
         template <typename T>
+        requires(!bt_value_dict<T> && !bt_value_list<T>)
         void operator()(const T& other) {
             out.append(key, other);
         }
@@ -37,28 +55,33 @@ namespace detail {
         bt_list_producer& out;
         explicit list_appender(bt_list_producer& out) : out{out} {}
 
-        void operator()(const bt_dict& d) {
+        template <bt_value_dict D>
+        void operator()(const D& d) {
             auto subdict = out.append_dict();
             serialize_dict(subdict, d);
         }
-        void operator()(const bt_list& l) {
+        template <bt_value_list L>
+        void operator()(const L& l) {
             auto sublist = out.append_list();
             serialize_list(sublist, l);
         }
         template <typename T>
+        requires(!bt_value_dict<T> && !bt_value_list<T>)
         void operator()(const T& other) {
             out.append(other);
         }
     };
 
-    inline void serialize_dict(bt_dict_producer& out, const bt_dict& d) {
+    template <typename Dict>
+    void serialize_dict(bt_dict_producer& out, const Dict& d) {
         for (const auto& [k, v] : d)
-            var::visit(dict_appender{out, k}, static_cast<const bt_variant&>(v));
+            var::visit(dict_appender{out, k}, as_variant(v));
     }
 
-    inline void serialize_list(bt_list_producer& out, const bt_list& l) {
+    template <typename List>
+    void serialize_list(bt_list_producer& out, const List& l) {
         for (auto& val : l)
-            var::visit(list_appender{out}, static_cast<const bt_variant&>(val));
+            var::visit(list_appender{out}, as_variant(val));
     }
 }  // namespace detail
 
@@ -95,4 +118,38 @@ template <>
 inline void bt_dict_producer::append_bt(std::string_view key, const bt_value& bt) {
     var::visit(detail::dict_appender{*this, key}, static_cast<const bt_variant&>(bt));
 }
+
+template <>
+inline void bt_list_producer::append_bt(const bt_flat_dict& bt) {
+    auto subdict = append_dict();
+    detail::serialize_dict(subdict, bt);
+}
+
+template <>
+inline void bt_list_producer::append_bt(const bt_flat_list& bt) {
+    auto sublist = append_list();
+    detail::serialize_list(sublist, bt);
+}
+
+template <>
+inline void bt_list_producer::append_bt(const bt_flat_value& bt) {
+    var::visit(detail::list_appender{*this}, static_cast<const bt_flat_variant&>(bt));
+}
+
+template <>
+inline void bt_dict_producer::append_bt(std::string_view key, const bt_flat_dict& bt) {
+    auto subdict = append_dict(key);
+    detail::serialize_dict(subdict, bt);
+}
+
+template <>
+inline void bt_dict_producer::append_bt(std::string_view key, const bt_flat_list& bt) {
+    auto sublist = append_list(key);
+    detail::serialize_list(sublist, bt);
+}
+
+template <>
+inline void bt_dict_producer::append_bt(std::string_view key, const bt_flat_value& bt) {
+    var::visit(detail::dict_appender{*this, key}, static_cast<const bt_flat_variant&>(bt));
+}
 }  // namespace oxenc
@@ -35,4 +35,11 @@ struct byte_type<OutputIt> {
 template <typename OutputIt>
 using byte_type_t = typename byte_type<OutputIt>::type;
 
+// True if an input/output iterator pair can be handed off to the bulk (contiguous memory) encoding
+// and decoding kernels: both have to be contiguous iterators over single-byte values.
+template <typename InputIt, typename OutputIt>
+concept bulk_codec_iterators =
+        std::contiguous_iterator<InputIt> && std::contiguous_iterator<OutputIt> &&
+        sizeof(std::iter_value_t<InputIt>) == 1 && sizeof(std::iter_value_t<OutputIt>) == 1;
+
 }  // namespace oxenc::detail
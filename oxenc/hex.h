@@ -8,6 +8,7 @@
 
 #include "byte_type.h"
 #include "common.h"
+#include "simd.h"
 
 namespace oxenc {
 
@@ -17,7 +18,9 @@ namespace detail {
     struct hex_table {
         char from_hex_lut[256];
         char to_hex_lut[16];
-        consteval hex_table() noexcept : from_hex_lut{}, to_hex_lut{} {
+        // Both hex digits of every possible byte value, used by the bulk encoder.
+        char to_hex_pair_lut[512];
+        consteval hex_table() noexcept : from_hex_lut{}, to_hex_lut{}, to_hex_pair_lut{} {
             for (char c = 0; c < 10; c++) {
                 from_hex_lut['0' + c] = static_cast<char>(0 + c);
                 to_hex_lut[0 + c] = static_cast<char>('0' + c);
@@ -27,6 +30,10 @@ namespace detail {
                 from_hex_lut['A' + c] = static_cast<char>(10 + c);
                 to_hex_lut[10 + c] = static_cast<char>('a' + c);
             }
+            for (int b = 0; b < 256; b++) {
+                to_hex_pair_lut[2 * b] = to_hex_lut[b >> 4];
+                to_hex_pair_lut[2 * b + 1] = to_hex_lut[b & 0x0f];
+            }
         }
         constexpr char from_hex(unsigned char c) const noexcept { return from_hex_lut[c]; }
         constexpr char to_hex(unsigned char b) const noexcept { return to_hex_lut[b]; }
@@ -39,6 +46,210 @@ namespace detail {
             hex_lut.from_hex('a') == 10 && hex_lut.from_hex('F') == 15 && hex_lut.to_hex(13) == 'd',
             "");
 
+    // Bulk hex kernels for contiguous input.  These are used by to_hex/from_hex/is_hex whenever the
+    // input (and, when writing to an output iterator, the output) is contiguous memory and we
+    // aren't being evaluated at compile time.  The `_ssse3`/`_avx2` kernels only handle whole
+    // blocks and return how many input bytes they consumed; the `_portable` versions handle
+    // anything and finish off whatever the vectorized kernels leave behind.
+
+    inline void hex_encode_portable(const unsigned char* in, size_t n, char* out) {
+        for (size_t i = 0; i < n; i++) {
+            const char* pair = hex_lut.to_hex_pair_lut + 2 * in[i];
+            out[2 * i] = pair[0];
+            out[2 * i + 1] = pair[1];
+        }
+    }
+
+    // `n` is the number of hex characters, and must be even.
+    inline void hex_decode_portable(const char* in, size_t n, unsigned char* out) {
+        for (size_t i = 0; i < n; i += 2)
+            out[i / 2] = static_cast<unsigned char>(
+                    (hex_lut.from_hex(static_cast<unsigned char>(in[i])) << 4) |
+                    hex_lut.from_hex(static_cast<unsigned char>(in[i + 1])));
+    }
+
+    inline bool hex_validate_portable(const char* in, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            auto c = static_cast<unsigned char>(in[i]);
+            if (hex_lut.from_hex(c) == 0 && c != '0')
+                return false;
+        }
+        return true;
+    }
+
+#ifdef OXENC_SIMD_X86
+    OXENC_TARGET_SSSE3 inline size_t hex_encode_ssse3(
+            const unsigned char* in, size_t n, char* out) {
+        const __m128i lut = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hex_lut.to_hex_lut));
+        const __m128i mask = _mm_set1_epi8(0x0f);
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+            __m128i hi = _mm_shuffle_epi8(lut, _mm_and_si128(_mm_srli_epi16(v, 4), mask));
+            __m128i lo = _mm_shuffle_epi8(lut, _mm_and_si128(v, mask));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * i), _mm_unpacklo_epi8(hi, lo));
+            _mm_storeu_si128(
+                    reinterpret_cast<__m128i*>(out + 2 * i + 16), _mm_unpackhi_epi8(hi, lo));
+        }
+        return i;
+    }
+
+    OXENC_TARGET_AVX2 inline size_t hex_encode_avx2(const unsigned char* in, size_t n, char* out) {
+        const __m256i lut = _mm256_broadcastsi128_si256(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(hex_lut.to_hex_lut)));
+        const __m256i mask = _mm256_set1_epi8(0x0f);
+        size_t i = 0;
+        for (; i + 32 <= n; i += 32) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+            __m256i hi = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(v, 4), mask));
+            __m256i lo = _mm256_shuffle_epi8(lut, _mm256_and_si256(v, mask));
+            // unpack works within 128-bit lanes, so we end up with bytes [0-7, 16-23] in `a` and
+            // [8-15, 24-31] in `b` and have to recombine the lanes:
+            __m256i a = _mm256_unpacklo_epi8(hi, lo);
+            __m256i b = _mm256_unpackhi_epi8(hi, lo);
+            _mm256_storeu_si256(
+                    reinterpret_cast<__m256i*>(out + 2 * i), _mm256_permute2x128_si256(a, b, 0x20));
+            _mm256_storeu_si256(
+                    reinterpret_cast<__m256i*>(out + 2 * i + 32),
+                    _mm256_permute2x128_si256(a, b, 0x31));
+        }
+        return i;
+    }
+
+    // Converts 16 hex characters to their 0-15 values, and sets `valid` to 0xff for each input
+    // character that was actually a hex digit (and 0 for each that wasn't).
+    OXENC_TARGET_SSSE3 inline __m128i hex_nibbles_ssse3(__m128i c, __m128i& valid) {
+        __m128i d = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+        __m128i a = _mm_sub_epi8(_mm_or_si128(c, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+        __m128i is_d = _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(9)), d);
+        __m128i is_a = _mm_cmpeq_epi8(_mm_min_epu8(a, _mm_set1_epi8(5)), a);
+        valid = _mm_or_si128(is_d, is_a);
+        return _mm_or_si128(
+                _mm_and_si128(is_d, d),
+                _mm_and_si128(is_a, _mm_add_epi8(a, _mm_set1_epi8(10))));
+    }
+
+    OXENC_TARGET_AVX2 inline __m256i hex_nibbles_avx2(__m256i c, __m256i& valid) {
+        __m256i d = _mm256_sub_epi8(c, _mm256_set1_epi8('0'));
+        __m256i a = _mm256_sub_epi8(
+                _mm256_or_si256(c, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+        __m256i is_d = _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(9)), d);
+        __m256i is_a = _mm256_cmpeq_epi8(_mm256_min_epu8(a, _mm256_set1_epi8(5)), a);
+        valid = _mm256_or_si256(is_d, is_a);
+        return _mm256_or_si256(
+                _mm256_and_si256(is_d, d),
+                _mm256_and_si256(is_a, _mm256_add_epi8(a, _mm256_set1_epi8(10))));
+    }
+
+    // Decodes blocks of 32 hex chars; returns the number of chars consumed.
+    OXENC_TARGET_SSSE3 inline size_t hex_decode_ssse3(
+            const char* in, size_t n, unsigned char* out) {
+        // maddubs multiplies the (high nibble, low nibble) byte pairs by (16, 1) and adds them
+        const __m128i weights = _mm_set1_epi16(0x0110);
+        size_t i = 0;
+        for (; i + 32 <= n; i += 32) {
+            __m128i valid;
+            __m128i a = hex_nibbles_ssse3(
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)), valid);
+            __m128i b = hex_nibbles_ssse3(
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 16)), valid);
+            _mm_storeu_si128(
+                    reinterpret_cast<__m128i*>(out + i / 2),
+                    _mm_packus_epi16(_mm_maddubs_epi16(a, weights), _mm_maddubs_epi16(b, weights)));
+        }
+        return i;
+    }
+
+    // Decodes blocks of 64 hex chars; returns the number of chars consumed.
+    OXENC_TARGET_AVX2 inline size_t hex_decode_avx2(const char* in, size_t n, unsigned char* out) {
+        const __m256i weights = _mm256_set1_epi16(0x0110);
+        size_t i = 0;
+        for (; i + 64 <= n; i += 64) {
+            __m256i valid;
+            __m256i a = hex_nibbles_avx2(
+                    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i)), valid);
+            __m256i b = hex_nibbles_avx2(
+                    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i + 32)), valid);
+            // packus also works within lanes, leaving us with 64-bit blocks in 0,2,1,3 order:
+            __m256i packed = _mm256_packus_epi16(
+                    _mm256_maddubs_epi16(a, weights), _mm256_maddubs_epi16(b, weights));
+            _mm256_storeu_si256(
+                    reinterpret_cast<__m256i*>(out + i / 2),
+                    _mm256_permute4x64_epi64(packed, 0b11'01'10'00));
+        }
+        return i;
+    }
+
+    // Returns the number of leading chars (in blocks of 16) that are all valid hex digits.
+    OXENC_TARGET_SSSE3 inline size_t hex_validate_ssse3(const char* in, size_t n) {
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            __m128i valid;
+            hex_nibbles_ssse3(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)), valid);
+            if (_mm_movemask_epi8(valid) != 0xffff)
+                break;
+        }
+        return i;
+    }
+
+    // Returns the number of leading chars (in blocks of 32) that are all valid hex digits.
+    OXENC_TARGET_AVX2 inline size_t hex_validate_avx2(const char* in, size_t n) {
+        size_t i = 0;
+        for (; i + 32 <= n; i += 32) {
+            __m256i valid;
+            hex_nibbles_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i)), valid);
+            if (_mm256_movemask_epi8(valid) != -1)
+                break;
+        }
+        return i;
+    }
+#endif
+
+    inline void hex_encode_bulk(const unsigned char* in, size_t n, char* out) {
+#ifdef OXENC_SIMD_X86
+        size_t done = 0;
+        auto level = simd();
+        if (level >= simd_level::avx2)
+            done = hex_encode_avx2(in, n, out);
+        if (level >= simd_level::ssse3)
+            done += hex_encode_ssse3(in + done, n - done, out + 2 * done);
+        in += done;
+        out += 2 * done;
+        n -= done;
+#endif
+        hex_encode_portable(in, n, out);
+    }
+
+    inline void hex_decode_bulk(const char* in, size_t n, unsigned char* out) {
+        n &= ~size_t{1};  // Ignore a trailing odd char (invalid input) rather than overrunning
+#ifdef OXENC_SIMD_X86
+        size_t done = 0;
+        auto level = simd();
+        if (level >= simd_level::avx2)
+            done = hex_decode_avx2(in, n, out);
+        if (level >= simd_level::ssse3)
+            done += hex_decode_ssse3(in + done, n - done, out + done / 2);
+        in += done;
+        out += done / 2;
+        n -= done;
+#endif
+        hex_decode_portable(in, n, out);
+    }
+
+    inline bool hex_validate_bulk(const char* in, size_t n) {
+#ifdef OXENC_SIMD_X86
+        size_t done = 0;
+        auto level = simd();
+        if (level >= simd_level::avx2)
+            done = hex_validate_avx2(in, n);
+        if (level >= simd_level::ssse3)
+            done += hex_validate_ssse3(in + done, n - done);
+        in += done;
+        n -= done;
+#endif
+        return hex_validate_portable(in, n);
+    }
+
 }  // namespace detail
 
 /// Returns the number of characters required to encode a hex string from the given number of bytes.
@@ -100,6 +311,16 @@ struct hex_encoder final {
 template <typename InputIt, typename OutputIt>
 constexpr OutputIt to_hex(InputIt begin, InputIt end, OutputIt out) {
     static_assert(sizeof(decltype(*begin)) == 1, "to_hex requires chars/bytes");
+    if constexpr (detail::bulk_codec_iterators<InputIt, OutputIt>) {
+        if (!std::is_constant_evaluated()) {
+            auto n = static_cast<size_t>(end - begin);
+            detail::hex_encode_bulk(
+                    reinterpret_cast<const unsigned char*>(std::to_address(begin)),
+                    n,
+                    reinterpret_cast<char*>(std::to_address(out)));
+            return out + static_cast<std::iter_difference_t<OutputIt>>(to_hex_size(n));
+        }
+    }
     auto it = hex_encoder{begin, end};
     return std::copy(it, it.end(), out);
 }
@@ -108,13 +329,18 @@ constexpr OutputIt to_hex(InputIt begin, InputIt end, OutputIt out) {
 template <typename It>
 std::string to_hex(It begin, It end) {
     std::string hex;
-    if constexpr (std::is_base_of_v<
-                          std::random_access_iterator_tag,
-                          typename std::iterator_traits<It>::iterator_category>) {
-        using std::distance;
-        hex.reserve(to_hex_size(static_cast<size_t>(distance(begin, end))));
+    if constexpr (std::contiguous_iterator<It>) {
+        hex.resize(to_hex_size(static_cast<size_t>(end - begin)));
+        to_hex(begin, end, hex.data());
+    } else {
+        if constexpr (std::is_base_of_v<
+                              std::random_access_iterator_tag,
+                              typename std::iterator_traits<It>::iterator_category>) {
+            using std::distance;
+            hex.reserve(to_hex_size(static_cast<size_t>(distance(begin, end))));
+        }
+        to_hex(begin, end, std::back_inserter(hex));
     }
-    to_hex(begin, end, std::back_inserter(hex));
     return hex;
 }
 
@@ -152,7 +378,14 @@ constexpr bool is_hex(It begin, It end) {
         if (distance(begin, end) % 2 != 0)
             return false;
     }
+    if constexpr (std::contiguous_iterator<It>) {
+        if (!std::is_constant_evaluated())
+            return detail::hex_validate_bulk(
+                    reinterpret_cast<const char*>(std::to_address(begin)),
+                    static_cast<size_t>(end - begin));
+    }
 
+    // Non-contiguous input, or constant evaluation (where the bulk validator can't be used):
     size_t count = 0;
     for (; begin != end; ++begin) {
         if constexpr (!ra)
@@ -240,6 +473,16 @@ template <typename InputIt, typename OutputIt>
 constexpr OutputIt from_hex(InputIt begin, InputIt end, OutputIt out) {
     static_assert(sizeof(decltype(*begin)) == 1, "from_base32z requires chars/bytes");
     assert(is_hex(begin, end));
+    if constexpr (detail::bulk_codec_iterators<InputIt, OutputIt>) {
+        if (!std::is_constant_evaluated()) {
+            auto n = static_cast<size_t>(end - begin);
+            detail::hex_decode_bulk(
+                    reinterpret_cast<const char*>(std::to_address(begin)),
+                    n,
+                    reinterpret_cast<unsigned char*>(std::to_address(out)));
+            return out + static_cast<std::iter_difference_t<OutputIt>>(from_hex_size(n));
+        }
+    }
     auto it = hex_decoder(begin, end);
     const auto hend = it.end();
     while (it != hend)
@@ -252,13 +495,18 @@ constexpr OutputIt from_hex(InputIt begin, InputIt end, OutputIt out) {
 template <typename It>
 std::string from_hex(It begin, It end) {
     std::string bytes;
-    if constexpr (std::is_base_of_v<
-                          std::random_access_iterator_tag,
-                          typename std::iterator_traits<It>::iterator_category>) {
-        using std::distance;
-        bytes.reserve(from_hex_size(static_cast<size_t>(distance(begin, end))));
+    if constexpr (std::contiguous_iterator<It>) {
+        bytes.resize(from_hex_size(static_cast<size_t>(end - begin)));
+        from_hex(begin, end, bytes.data());
+    } else {
+        if constexpr (std::is_base_of_v<
+                              std::random_access_iterator_tag,
+                              typename std::iterator_traits<It>::iterator_category>) {
+            using std::distance;
+            bytes.reserve(from_hex_size(static_cast<size_t>(distance(begin, end))));
+        }
+        from_hex(begin, end, std::back_inserter(bytes));
     }
-    from_hex(begin, end, std::back_inserter(bytes));
     return bytes;
 }
 
@@ -0,0 +1,269 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <variant>
+
+#include "rlp_serialize.h"
+
+namespace oxenc {
+
+/** \file
+ * Incremental RLP encoding of lists, without first building an rlp_list (or other container) of
+ * the values:
+ *
+ *     oxenc::rlp_list_producer tx;
+ *     tx.append(nonce);
+ *     tx.append(to_address);
+ *     {
+ *         auto access_list = tx.append_list();
+ *         access_list.append(addr1);
+ *         access_list.append(addr2);
+ *     }
+ *     std::string encoded = std::move(tx).str();
+ *
+ * Values are written directly into the output: either a std::string, or an external buffer.
+ */
+
+/// Class that builds an RLP-encoded list by appending values, and nested lists, one at a time.
+///
+/// Because an RLP list header contains the length of the list, the header of a list is written
+/// when the list is finished: when a nested list's producer is destroyed, or when the encoded value
+/// is retrieved via `view()` or `str()`.  A single byte is reserved for the header of each list
+/// (which suffices for lists with an encoded length of up to 55 bytes); the contents of a longer
+/// list are shifted over when its header is written to make room for the longer header.
+///
+/// In external buffer mode, out-of-buffer-space errors throw std::length_error.  Each append
+/// requires a few bytes of extra space, beyond the value being appended, so that the headers of
+/// open lists can always be written.
+class rlp_list_producer {
+    // For external buffer mode we keep pointers to the start position and past-the-end positions,
+    // along with the amount of the buffer used so far.
+    struct buf_span {
+        char* const init;
+        char* const end;
+        size_t size;
+        // The maximum number of bytes that one list header can grow by when it is written, given
+        // the buffer size.
+        size_t header_slack;
+    };
+
+    // Our output type: either external buffer pointers, or a string that we build:
+    using output = std::variant<std::string, buf_span>;
+
+    // Our data for the root list is the output; for sublists it is a pointer to the parent list.
+    std::variant<output, rlp_list_producer*> data;
+
+    // Reference to the output; this is simply a reference to the value inside `data` for the
+    // root list, and a reference to the root's value for sublists.
+    output& out;
+
+    // True indicates we have an open child list
+    bool has_child = false;
+
+    // The offset of this list's header in the output
+    const size_t from;
+
+    // The number of bytes reserved for this list's header, which follow `from`.
+    size_t header = 1;
+
+    // The nesting depth of this list: 1 for the root list, 2 for its sublists, and so on.
+    const size_t depth = 1;
+
+    // Sublist constructor
+    explicit rlp_list_producer(rlp_list_producer* parent);
+
+    // Internal constructor for both external buffer and string mode.
+    explicit rlp_list_producer(output o);
+
+    rlp_list_producer* parent();
+
+    // Returns the start of the output, and the amount of data written to it.
+    char* base();
+    size_t size() const;
+
+    // Extends the output by `n` bytes, returning a pointer to the start of the added space, and
+    // throwing if this would not leave enough room to write the headers of the open lists.
+    char* grow(size_t n);
+
+    // Writes the header of this list, first growing the header (shifting the list contents) if
+    // the currently reserved space is too small.
+    void write_header();
+
+  public:
+    rlp_list_producer(const rlp_list_producer&) = delete;
+    rlp_list_producer& operator=(const rlp_list_producer&) = delete;
+    rlp_list_producer(rlp_list_producer&&) = delete;
+    rlp_list_producer& operator=(rlp_list_producer&&) = delete;
+
+    /// Constructs a list producer that writes into the range [begin, end).  If a write would go
+    /// beyond the end of the buffer an exception is raised.
+    rlp_list_producer(char* begin, char* end);
+
+    /// Constructs a list producer that writes into the range [begin, begin+size).
+    rlp_list_producer(char* begin, size_t len) : rlp_list_producer{begin, begin + len} {}
+
+    /// Constructs a list producer that writes to an internal, expandable string.  `reserve` can
+    /// be passed a non-zero value to reserve an initial size in the std::string.
+    explicit rlp_list_producer(size_t reserve = 0);
+
+    ~rlp_list_producer();
+
+    /// Appends a value: an unsigned integer, a byte string (std::string, string_view,
+    /// std::vector<uint8_t>, etc.), or anything else accepted by rlp_serialize (such as a
+    /// container of values, which is appended as a nested list, or an rlp_value).  The value is
+    /// walked once to size it (and any lists it contains), and then once more to write it directly
+    /// into the output.
+    template <RLPSerializable T>
+    void append(const T& val) {
+        if (has_child)
+            throw std::logic_error{"Cannot append to list when a sublist is active"};
+        detail::rlp_encode(val, [this](size_t size) { return grow(size); });
+    }
+
+    /// Appends a C string value.
+    void append(const char* str) { append(std::string_view{str}); }
+
+    /// Appends an RLP-encoded value as-is.  The value is *not* checked for validity.
+    void append_encoded(std::string_view encoded) {
+        if (has_child)
+            throw std::logic_error{"Cannot append to list when a sublist is active"};
+        std::copy(encoded.begin(), encoded.end(), grow(encoded.size()));
+    }
+
+    /// Appends a nested list.  The returned producer is used to add values to the list, and must be
+    /// destroyed before anything else is appended to this list.
+    rlp_list_producer append_list() {
+        if (has_child)
+            throw std::logic_error{"Cannot call append_list while another nested list is active"};
+        return rlp_list_producer{this};
+    }
+
+    /// Returns a view of the encoded list.  This finishes the list (writing its header), but values
+    /// can still be appended afterwards (invalidating the returned view).  Throws std::logic_error
+    /// if a nested list is active.
+    template <basic_char Char = char>
+    std::basic_string_view<Char> view() {
+        if (has_child)
+            throw std::logic_error{"Cannot view a list while a sublist is active"};
+        write_header();
+        return {reinterpret_cast<const Char*>(base() + from), size() - from};
+    }
+
+    /// Extracts the encoded string, when not using buffer mode.  This is only usable on the root
+    /// list, and may only be used in rvalue context, as it destroys the internal buffer, such as:
+    /// std::move(producer).str().  Throws logic_error if called on a sublist or an external buffer
+    /// producer, or while a sublist is active.
+    std::string str() &&;
+};
+
+inline rlp_list_producer::rlp_list_producer(output o) :
+        data{std::move(o)}, out{*std::get_if<output>(&data)}, from{0} {
+    *grow(1) = static_cast<char>(0xc0);
+}
+
+inline rlp_list_producer::rlp_list_producer(char* begin, char* end) :
+        rlp_list_producer{buf_span{
+                begin,
+                end,
+                0,
+                detail::rlp_header_size(static_cast<size_t>(end - begin)) - 1}} {}
+
+inline rlp_list_producer::rlp_list_producer(size_t reserve) : rlp_list_producer{std::string{}} {
+    if (reserve > 0)
+        std::get_if<std::string>(&out)->reserve(reserve);
+}
+
+inline rlp_list_producer::rlp_list_producer(rlp_list_producer* parent) :
+        data{parent}, out{parent->out}, from{parent->size()}, depth{parent->depth + 1} {
+    *grow(1) = static_cast<char>(0xc0);
+    parent->has_child = true;
+}
+
+inline rlp_list_producer::~rlp_list_producer() {
+    auto* p = parent();
+    if (!p)
+        return;
+    assert(!has_child);
+    assert(p->has_child);
+    p->has_child = false;
+    // This can't throw: grow() has made sure that there is room for it.
+    write_header();
+}
+
+inline rlp_list_producer* rlp_list_producer::parent() {
+    if (auto* p = std::get_if<rlp_list_producer*>(&data))
+        return *p;
+    return nullptr;
+}
+
+inline char* rlp_list_producer::base() {
+    if (auto* s = std::get_if<std::string>(&out))
+        return s->data();
+    return std::get_if<buf_span>(&out)->init;
+}
+
+inline size_t rlp_list_producer::size() const {
+    if (auto* s = std::get_if<std::string>(&out))
+        return s->size();
+    return std::get_if<buf_span>(&out)->size;
+}
+
+inline char* rlp_list_producer::grow(size_t n) {
+    if (auto* s = std::get_if<std::string>(&out)) {
+        // Make sure that the capacity is large enough that writing the headers of the open lists
+        // won't need to reallocate (each can grow by at most 8 bytes), so that it can't throw.
+        auto old_size = s->size();
+        auto need = old_size + n + 8 * depth;
+        if (need > s->capacity())
+            s->reserve(std::max(need, 2 * s->capacity()));
+        s->resize(old_size + n);
+        return s->data() + old_size;
+    }
+    auto& b = *std::get_if<buf_span>(&out);
+    auto avail = static_cast<size_t>(b.end - b.init) - b.size;
+    if (n + depth * b.header_slack > avail)
+        throw std::length_error{"Cannot write rlp_list_producer: buffer size exceeded"};
+    auto* ptr = b.init + b.size;
+    b.size += n;
+    return ptr;
+}
+
+inline void rlp_list_producer::write_header() {
+    auto payload = size() - from - header;
+    auto need = detail::rlp_header_size(payload);
+    if (need > header) {
+        auto extra = need - header;
+        if (auto* s = std::get_if<std::string>(&out))
+            s->resize(s->size() + extra);
+        else
+            std::get_if<buf_span>(&out)->size += extra;
+        auto* contents = base() + from + header;
+        std::copy_backward(contents, contents + payload, contents + payload + extra);
+        header = need;
+    }
+    detail::rlp_write_header(payload, 0xc0u, base() + from);
+}
+
+inline std::string rlp_list_producer::str() && {
+    if (parent())
+        throw std::logic_error{"Cannot call rlp_list_producer .str() on a sublist"};
+    auto* s = std::get_if<std::string>(&out);
+    if (!s)
+        throw std::logic_error{
+                "Cannot call rlp_list_producer .str() when using an external buffer"};
+    if (has_child)
+        throw std::logic_error{"Cannot call rlp_list_producer .str() while a sublist is active"};
+    write_header();
+    std::string ret;
+    ret.swap(*s);
+    // Leave behind an empty list
+    header = 1;
+    *grow(1) = static_cast<char>(0xc0);
+    return ret;
+}
+
+}  // namespace oxenc
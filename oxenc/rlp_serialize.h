@@ -1,11 +1,19 @@
+#pragma once
+
+#include <algorithm>
 #include <array>
+#include <cassert>
 #include <concepts>
 #include <list>
+#include <ranges>
 #include <span>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <type_traits>
 #include <utility>
 #include <variant>
+#include <vector>
 
 #include "common.h"
 #include "endian.h"
@@ -87,17 +95,136 @@ namespace detail {
     template <typename... T>
     constexpr bool is_variant<std::variant<T...>> = true;
 
+    // The number of bytes needed for the big-endian representation of `val`, without leading
+    // zeros.
+    constexpr size_t rlp_integer_bytes(uint64_t val) {
+        size_t bytes = 0;
+        for (; val; val >>= 8)
+            bytes++;
+        return bytes;
+    }
+
+    // Writes the `bytes` least significant bytes of `val` in big-endian order.
+    inline char* rlp_write_integer_bytes(uint64_t val, size_t bytes, char* out) {
+        for (size_t i = bytes; i > 0; i--, val >>= 8)
+            out[i - 1] = static_cast<char>(val & 0xff);
+        return out + bytes;
+    }
+
+    // The size of the header of a string or list with a payload of `size` bytes.
+    constexpr size_t rlp_header_size(size_t size) {
+        return size <= 55 ? 1 : 1 + rlp_integer_bytes(size);
+    }
+
+    // Writes the header of a string (base_code 0x80) or list (base_code 0xc0) with a payload of
+    // `size` bytes.
+    inline char* rlp_write_header(size_t size, unsigned char base_code, char* out) {
+        if (size <= 55) {
+            *out++ = static_cast<char>(base_code + size);
+            return out;
+        }
+        auto bytes = rlp_integer_bytes(size);
+        *out++ = static_cast<char>(base_code + 55 + bytes);
+        return rlp_write_integer_bytes(size, bytes, out);
+    }
+
+    // The payload sizes of the lists inside a value, in the order that they are encountered.  This
+    // is filled in by rlp_size and then used by rlp_write, so that writing a list header doesn't
+    // have to walk the list (and all of its sublists) again.
+    using rlp_list_sizes = std::vector<size_t>;
+
+    // Returns the encoded size of a serializable value.  If `lists` is given then the payload size
+    // of each list in the value is appended to it.
+    template <typename T>
+    size_t rlp_size(const T& val, rlp_list_sizes* lists = nullptr);
+
+    // Writes the encoding of a serializable value, which must have room for `rlp_size(val)` bytes,
+    // and returns a pointer just past the written data.  `list_sizes` must point at the list sizes
+    // recorded by `rlp_size(val, &lists)`, and is advanced past the ones used.
+    template <typename T>
+    char* rlp_write(const T& val, char* out, const size_t*& list_sizes);
+
+    template <typename T>
+    size_t rlp_size(const T& val, rlp_list_sizes* lists) {
+        if constexpr (std::unsigned_integral<T>) {
+            return val < 0x80 ? 1 : 1 + rlp_integer_bytes(val);
+        } else if constexpr (is_char_span<T>) {
+            if (val.size() == 1 && static_cast<unsigned char>(val[0]) < 0x80)
+                return 1;
+            return rlp_header_size(val.size()) + val.size();
+        } else if constexpr (is_span<T> || is_list<T>) {
+            size_t slot = 0;
+            if (lists) {
+                slot = lists->size();
+                lists->push_back(0);
+            }
+            size_t payload = 0;
+            for (const auto& x : val)
+                payload += rlp_size(x, lists);
+            if (lists)
+                (*lists)[slot] = payload;
+            return rlp_header_size(payload) + payload;
+        } else if constexpr (span_convertible<T>) {
+            return rlp_size(std::span<const typename T::value_type>{val}, lists);
+        } else if constexpr (is_variant<T>) {
+            return std::visit([lists](const auto& x) { return rlp_size(x, lists); }, val);
+        } else if constexpr (std::same_as<rlp_value, T>) {
+            // GCC 10 workaround (see rlp_write)
+            return rlp_size(static_cast<const rlp_variant&>(val), lists);
+        } else {
+            static_assert(std::is_void_v<T>, "Internal error: unhandled serializable type");
+        }
+    }
+
     template <typename T>
-    std::pair<std::array<char, sizeof(T)>, std::string_view> rlp_encode_integer(const T& val) {
-        std::pair<std::array<char, sizeof(T)>, std::string_view> result;
-        auto& [buf, length] = result;
-        oxenc::write_host_as_big(val, buf.data());
-        length = {buf.data(), buf.size()};
-        while (!length.empty() && length[0] == 0)
-            length.remove_prefix(1);
-        return result;
+    char* rlp_write(const T& val, char* out, const size_t*& list_sizes) {
+        if constexpr (std::unsigned_integral<T>) {
+            if (val == 0) {
+                *out++ = static_cast<char>(0x80);
+            } else if (val < 0x80) {
+                *out++ = static_cast<char>(val);
+            } else {
+                auto bytes = rlp_integer_bytes(val);
+                *out++ = static_cast<char>(0x80 + bytes);
+                out = rlp_write_integer_bytes(val, bytes, out);
+            }
+            return out;
+        } else if constexpr (is_char_span<T>) {
+            auto* data = reinterpret_cast<const char*>(val.data());
+            if (!(val.size() == 1 && static_cast<unsigned char>(data[0]) < 0x80))
+                out = rlp_write_header(val.size(), 0x80u, out);
+            return std::copy(data, data + val.size(), out);
+        } else if constexpr (is_span<T> || is_list<T>) {
+            out = rlp_write_header(*list_sizes++, 0xc0u, out);
+            for (const auto& x : val)
+                out = rlp_write(x, out, list_sizes);
+            return out;
+        } else if constexpr (span_convertible<T>) {
+            return rlp_write(std::span<const typename T::value_type>{val}, out, list_sizes);
+        } else if constexpr (is_variant<T>) {
+            return std::visit(
+                    [out, &list_sizes](const auto& x) { return rlp_write(x, out, list_sizes); },
+                    val);
+        } else if constexpr (std::same_as<rlp_value, T>) {
+            // GCC 10 workaround; on gcc 11+/clang, the above case can deal with directly without
+            // first needing the static to the base std::variant type (aka rlp_variant).
+            return rlp_write(static_cast<const rlp_variant&>(val), out, list_sizes);
+        } else {
+            static_assert(std::is_void_v<T>, "Internal error: unhandled serializable type");
+        }
+    }
+
+    // Sizes `val`, then writes it into the buffer returned by `get_buffer(size)`, walking the value
+    // once for each.  Returns the encoded size.
+    template <typename T, typename GetBuffer>
+    size_t rlp_encode(const T& val, GetBuffer&& get_buffer) {
+        rlp_list_sizes lists;
+        auto size = rlp_size(val, &lists);
+        const size_t* list_sizes = lists.data();
+        rlp_write(val, get_buffer(size), list_sizes);
+        assert(list_sizes == lists.data() + lists.size());
+        return size;
     }
-    std::string rlp_encode_payload(std::string_view payload, unsigned char base_code);
 
 }  // namespace detail
 
@@ -111,41 +238,54 @@ concept RLPSerializable = detail::is_rlp_serializable<T>;
 ///
 /// Also takes a variant of serializable types, and containers can recursively contain other
 /// serializable types.
+///
+/// The encoded size is computed first (recording the size of each nested list along the way), so
+/// that the value is written directly into a single string of the required size.
 template <RLPSerializable T>
 inline std::string rlp_serialize(const T& val) {
-    using namespace detail;
-
-    if constexpr (std::unsigned_integral<T>) {
-        auto [buf, v] = rlp_encode_integer(val);
-        return rlp_serialize(v);
-    } else if constexpr (is_char_span<T>) {
-        std::string_view str{reinterpret_cast<const char*>(val.data()), val.size()};
-        if (str.size() == 1 && static_cast<unsigned char>(str[0]) < 0x80)
-            return std::string{str};
-        return detail::rlp_encode_payload(str, 0x80u);
-    } else if constexpr (is_span<T> || is_list<T>) {
-        std::string payload;
-        for (const auto& x : val)
-            payload += rlp_serialize(x);
-        return detail::rlp_encode_payload(payload, 0xc0u);
-    } else if constexpr (span_convertible<T>) {
-        std::span<const typename T::value_type> span = val;
-        return rlp_serialize(span);
-    } else if constexpr (is_variant<T>) {
-        return std::visit([](const auto& x) { return rlp_serialize(x); }, val);
-    } else if constexpr (std::same_as<rlp_value, T>) {
-        // GCC 10 workaround; on gcc 11+/clang, the above case can deal with directly without first
-        // needing the static to the base std::variant type (aka rlp_variant).
-        return rlp_serialize(static_cast<const rlp_variant&>(val));
-    } else {
-        static_assert(std::is_void_v<T>, "Internal error: unhandled serializable type");
-    }
+    std::string result;
+    detail::rlp_encode(val, [&result](size_t size) {
+        result.resize(size);
+        return result.data();
+    });
+    return result;
 }
 
 inline std::string rlp_serialize(const char* str) {
     return rlp_serialize(std::string_view{str});
 }
 
+/// Returns the exact number of bytes that `rlp_serialize(val)` will produce, without actually
+/// serializing anything.  This can be used to pre-size an output buffer (see rlp_serialize_into).
+template <RLPSerializable T>
+size_t rlp_serialized_size(const T& val) {
+    return detail::rlp_size(val);
+}
+
+/// Serializes `val` into the given buffer, which must be large enough to hold the serialized value
+/// (see `rlp_serialized_size`).  Returns the number of bytes written (i.e. the serialized size).
+/// Throws std::length_error (without writing anything) if the buffer is too small.
+///
+///     std::vector<unsigned char> buf(rlp_serialized_size(val));
+///     rlp_serialize_into(buf, val);
+///
+template <basic_char Char, size_t Extent, RLPSerializable T>
+size_t rlp_serialize_into(std::span<Char, Extent> buf, const T& val) {
+    return detail::rlp_encode(val, [&buf](size_t size) {
+        if (size > buf.size())
+            throw std::length_error{"Cannot serialize RLP value: buffer size exceeded"};
+        return reinterpret_cast<char*>(buf.data());
+    });
+}
+
+/// Same as above, but accepts any contiguous container of chars (e.g. std::string,
+/// std::vector<char>, std::array<unsigned char, N>).  Note that the container is *not* resized.
+template <typename Container, RLPSerializable T>
+requires basic_char<typename Container::value_type> && std::ranges::contiguous_range<Container>
+size_t rlp_serialize_into(Container& buf, const T& val) {
+    return rlp_serialize_into(std::span{buf}, val);
+}
+
 // Takes a spannable container of basic char types representing a big-endian integer value and
 // returns the sub-span of that container that represents the value as a big integer value (which
 // requires removal of leading 0 bytes for RLP).  For example, passing "0000000000001234"_hex would
@@ -164,22 +304,264 @@ auto rlp_big_integer(const Container& c) {
     return rlp_big_integer(std::span<const typename Container::value_type>{c});
 }
 
+/// Exception thrown when RLP deserialization fails, either because the data is not valid,
+/// canonically encoded RLP, or because a value does not have the requested type.
+class rlp_deserialize_invalid : public std::invalid_argument {
+  public:
+    using std::invalid_argument::invalid_argument;
+};
+
+/// The maximum nesting depth of lists accepted when deserializing into rlp_value or nested
+/// containers.
+inline constexpr size_t rlp_default_max_depth = 256;
+
 namespace detail {
-    inline std::string rlp_encode_payload(std::string_view payload, unsigned char base_code) {
-        std::string result;
-        if (payload.size() <= 55) {
-            result.reserve(1 + payload.size());
-            result.push_back(static_cast<char>(base_code + payload.size()));
-        } else {
 
-            auto [buf, length] = rlp_encode_integer(payload.size());
-            result.reserve(1 + length.size() + payload.size());
-            result.push_back(static_cast<char>(base_code + 55 + length.size()));
-            result += length;
+    // A parsed RLP item
+    struct rlp_item {
+        bool list;                 // True for a list, false for a byte string
+        std::string_view payload;  // The string value, or the encoded elements of a list
+        size_t size;               // The total size of the item, including the header
+    };
+
+    // Parses the header of the RLP item at the beginning of `data`, throwing if the item is
+    // truncated or not canonically encoded (i.e. if the length is not encoded in the shortest
+    // possible way, or a single byte string is not encoded as itself).
+    inline rlp_item rlp_parse_item(std::string_view data) {
+        if (data.empty())
+            throw rlp_deserialize_invalid{"Invalid RLP: unexpected end of data"};
+        auto code = static_cast<unsigned char>(data[0]);
+        if (code < 0x80)
+            return {false, data.substr(0, 1), 1};
+        bool list = code >= 0xc0;
+        size_t length = code - (list ? 0xc0u : 0x80u), header = 1;
+        if (length > 55) {
+            size_t len_bytes = length - 55;
+            if (data.size() <= len_bytes)
+                throw rlp_deserialize_invalid{"Invalid RLP: unexpected end of data"};
+            if (data[1] == 0)
+                throw rlp_deserialize_invalid{"Invalid RLP: length has leading zeros"};
+            if (len_bytes > sizeof(size_t))
+                throw rlp_deserialize_invalid{"Invalid RLP: length is too large"};
+            length = 0;
+            for (size_t i = 1; i <= len_bytes; i++)
+                length = length << 8 | static_cast<unsigned char>(data[i]);
+            if (length <= 55)
+                throw rlp_deserialize_invalid{"Invalid RLP: short length encoded as long"};
+            header += len_bytes;
+        }
+        if (length > data.size() - header)
+            throw rlp_deserialize_invalid{"Invalid RLP: unexpected end of data"};
+        auto payload = data.substr(header, length);
+        if (!list && length == 1 && static_cast<unsigned char>(payload[0]) < 0x80)
+            throw rlp_deserialize_invalid{"Invalid RLP: single byte not encoded as itself"};
+        return {list, payload, header + length};
+    }
+
+    // Parses and removes the next item from the beginning of `data`, throwing if it is not of
+    // the expected type.
+    inline std::string_view rlp_consume_item(std::string_view& data, bool list) {
+        auto item = rlp_parse_item(data);
+        if (item.list != list)
+            throw rlp_deserialize_invalid{
+                    list ? "RLP value is not a list" : "RLP value is not a byte string"};
+        data.remove_prefix(item.size);
+        return item.payload;
+    }
+
+    template <std::unsigned_integral T>
+    T rlp_decode_integer(std::string_view s) {
+        if (!s.empty() && s[0] == 0)
+            throw rlp_deserialize_invalid{"Invalid RLP integer: leading zeros"};
+        if (s.size() > sizeof(T))
+            throw rlp_deserialize_invalid{"RLP integer is too large for the requested type"};
+        T val = 0;
+        for (auto c : s)
+            val = static_cast<T>(val << 8 | static_cast<unsigned char>(c));
+        return val;
+    }
+
+    template <typename T>
+    constexpr bool is_string_view = false;
+    template <basic_char Char>
+    constexpr bool is_string_view<std::basic_string_view<Char>> = true;
+
+    // Types that are loaded from an RLP byte string by copying it (std::string,
+    // std::vector<uint8_t>, etc.).
+    template <typename T>
+    concept rlp_string_container = basic_char<typename T::value_type> &&
+                                   requires(T& t, const typename T::value_type* p) {
+                                       t.assign(p, p);
+                                   };
+
+    // Types that are loaded from an RLP list by appending each element.
+    template <typename T>
+    concept rlp_list_container =
+            !rlp_string_container<T> && requires(T& t) {
+                t.clear();
+                t.emplace_back();
+            };
+
+    template <typename T>
+    void rlp_load(std::string_view& data, T& val, size_t max_depth);
+
+    template <typename Container>
+    void rlp_load_list(std::string_view& data, Container& val, size_t max_depth) {
+        if (max_depth == 0)
+            throw rlp_deserialize_invalid{"Invalid RLP: lists are nested too deeply"};
+        auto elements = rlp_consume_item(data, true);
+        val.clear();
+        while (!elements.empty())
+            rlp_load(elements, val.emplace_back(), max_depth - 1);
+    }
+
+    template <typename T>
+    void rlp_load(std::string_view& data, T& val, size_t max_depth) {
+        if constexpr (std::unsigned_integral<T> && !std::same_as<T, bool>) {
+            val = rlp_decode_integer<T>(rlp_consume_item(data, false));
+        } else if constexpr (is_string_view<T>) {
+            auto s = rlp_consume_item(data, false);
+            val = {reinterpret_cast<const typename T::value_type*>(s.data()), s.size()};
+        } else if constexpr (rlp_string_container<T>) {
+            auto s = rlp_consume_item(data, false);
+            auto* p = reinterpret_cast<const typename T::value_type*>(s.data());
+            val.assign(p, p + s.size());
+        } else if constexpr (std::same_as<T, rlp_value>) {
+            if (rlp_parse_item(data).list)
+                rlp_load_list(data, val.template emplace<rlp_list>(), max_depth);
+            else
+                rlp_load(data, val.template emplace<std::string>(), max_depth);
+        } else if constexpr (rlp_list_container<T>) {
+            rlp_load_list(data, val, max_depth);
+        } else {
+            static_assert(std::is_void_v<T>, "Unsupported type for RLP deserialization");
         }
-        result += payload;
-        return result;
     }
+
 }  // namespace detail
 
+/// Deserializes the RLP-encoded `data` into `val`, which can be:
+/// - an unsigned integer type (which must be large enough for the value);
+/// - a std::string, std::vector<uint8_t>, or other container of single-byte values, to get a copy
+///   of a byte string;
+/// - a std::string_view (or unsigned char/std::byte basic_string_view), to get a view of a byte
+///   string inside `data`;
+/// - a list-like container (std::vector, std::list, etc.) of any of these, for an RLP list;
+/// - an rlp_value, to decode any value: byte strings are stored as std::string, and lists as
+///   rlp_list.  (Since RLP does not distinguish between integers and strings, integers are
+///   decoded as their big-endian byte strings).
+///
+/// Throws rlp_deserialize_invalid if `data` is not a single, canonically encoded RLP value of the
+/// requested type.
+template <typename T>
+void rlp_deserialize(std::string_view data, T& val) {
+    detail::rlp_load(data, val, rlp_default_max_depth);
+    if (!data.empty())
+        throw rlp_deserialize_invalid{"Invalid RLP: trailing data after value"};
+}
+
+/// Deserializes the RLP-encoded `data` into a `T`, which is returned.  See above for details.
+///
+///     auto animals = rlp_deserialize<std::vector<std::string>>(encoded);
+///
+template <typename T = rlp_value>
+T rlp_deserialize(std::string_view data) {
+    T val{};
+    rlp_deserialize(data, val);
+    return val;
+}
+
+/// Class for consuming an RLP-encoded list one element at a time, without allocating.  Byte
+/// strings are returned as views into the encoded data, and nested lists are walked with nested
+/// consumers.  The encoding of every consumed element is validated (including that lengths are
+/// canonically encoded); skipped elements are only validated as far as is needed to skip them.
+class rlp_list_consumer {
+    std::string_view data;  // The remaining encoded elements
+
+    struct load_tag {};
+    rlp_list_consumer(std::string_view elements, load_tag) : data{elements} {}
+
+  public:
+    /// Constructs a consumer for the given encoded list, which must be a single, complete RLP list
+    /// (with no trailing data).  Throws rlp_deserialize_invalid if it is not.
+    explicit rlp_list_consumer(std::string_view encoded) {
+        data = detail::rlp_consume_item(encoded, true);
+        if (!encoded.empty())
+            throw rlp_deserialize_invalid{"Invalid RLP: trailing data after list"};
+    }
+
+    /// Returns true if there are no more elements in the list.
+    bool is_finished() const { return data.empty(); }
+
+    /// Returns true if the next element is a byte string.
+    bool is_string() const { return !data.empty() && static_cast<unsigned char>(data[0]) < 0xc0; }
+
+    /// Returns true if the next element is a list.
+    bool is_list() const { return !data.empty() && static_cast<unsigned char>(data[0]) >= 0xc0; }
+
+    /// Returns the remaining, not-yet-consumed encoded elements of the list.
+    std::string_view current_buffer() const { return data; }
+
+    /// Consumes the next element as a byte string, returning a view of it.  Throws if the next
+    /// element is not a byte string.
+    template <basic_char Char = char>
+    std::basic_string_view<Char> consume_string_view() {
+        auto s = detail::rlp_consume_item(data, false);
+        return {reinterpret_cast<const Char*>(s.data()), s.size()};
+    }
+
+    /// Consumes the next element as a byte string, returning a copy of it.
+    template <basic_char Char = char>
+    std::basic_string<Char> consume_string() {
+        return std::basic_string<Char>{consume_string_view<Char>()};
+    }
+
+    /// Consumes the next element as an unsigned integer.  Throws if the next element is not a
+    /// canonically encoded integer (i.e. a byte string without leading zeros) that fits in
+    /// `IntType`.
+    template <std::unsigned_integral IntType>
+    IntType consume_integer() {
+        auto copy = data;
+        auto val = detail::rlp_decode_integer<IntType>(detail::rlp_consume_item(copy, false));
+        data = copy;
+        return val;
+    }
+
+    /// Consumes the next element as a list, returning a consumer for its elements.
+    rlp_list_consumer consume_list_consumer() {
+        return {detail::rlp_consume_item(data, true), load_tag{}};
+    }
+
+    /// Consumes the next element as a list, returning its entire encoding (including the header).
+    template <basic_char Char = char>
+    std::basic_string_view<Char> consume_list_data() {
+        auto item = detail::rlp_parse_item(data);
+        if (!item.list)
+            throw rlp_deserialize_invalid{"RLP value is not a list"};
+        auto encoded = data.substr(0, item.size);
+        data.remove_prefix(item.size);
+        return {reinterpret_cast<const Char*>(encoded.data()), encoded.size()};
+    }
+
+    /// Consumes the next element into a value of type T, which can be any type supported by
+    /// rlp_deserialize.
+    template <typename T>
+    T consume() {
+        T val{};
+        consume(val);
+        return val;
+    }
+
+    /// Same as above, but loads into an existing value.
+    template <typename T>
+    void consume(T& val) {
+        auto copy = data;
+        detail::rlp_load(copy, val, rlp_default_max_depth);
+        data = copy;
+    }
+
+    /// Skips the next element (of any type).
+    void skip_value() { data.remove_prefix(detail::rlp_parse_item(data).size); }
+};
+
 }  // namespace oxenc
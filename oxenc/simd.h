@@ -0,0 +1,41 @@
+#pragma once
+
+// Runtime CPU feature detection used to pick vectorized kernels for the hex/base32z/base64 bulk
+// encoders and decoders.  The kernels themselves live next to the encoders that use them; this
+// header only provides the target attribute macros and the (cached) detected feature level.
+//
+// Vectorized kernels are currently only provided for x86/x86-64 when compiling with gcc or clang;
+// everything else (and everything if OXENC_NO_SIMD is defined) uses the portable code paths.
+
+#if !defined(OXENC_NO_SIMD) && (defined(__x86_64__) || defined(__i386__)) && \
+        (defined(__GNUC__) || defined(__clang__))
+#define OXENC_SIMD_X86
+#include <immintrin.h>
+#define OXENC_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define OXENC_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace oxenc::detail {
+
+/// The best vectorized instruction set available on the running CPU; the values are ordered so
+/// that `simd() >= simd_level::ssse3` can be used to test for "at least" a given level.
+enum class simd_level { none, ssse3, avx2 };
+
+inline simd_level detect_simd_level() {
+#ifdef OXENC_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return simd_level::avx2;
+    if (__builtin_cpu_supports("ssse3"))
+        return simd_level::ssse3;
+#endif
+    return simd_level::none;
+}
+
+/// Returns the detected simd_level; the detection only happens on the first call.
+inline simd_level simd() {
+    static const simd_level level = detect_simd_level();
+    return level;
+}
+
+}  // namespace oxenc::detail
@@ -45,6 +45,78 @@ TEST_CASE("bt nested value serialization", "[bt][serialization]") {
     REQUIRE(bt_serialize(x) == "d3:barle3:foold1:ali1ei2ei3ee1:bleed1:cli-5ei4eeeee");
 }
 
+TEST_CASE("bt serialization outputs", "[bt][serialization][writer]") {
+    bt_dict d{{"a", bt_list{{1, -2, "xyz"}}},
+              {"b", std::string(1000, 'x')},
+              {"c", bt_dict{{"i", 1234567890}}},
+              {"d", bool{true}}};
+    auto expected = "d1:ali1ei-2e3:xyze1:b1000:" + std::string(1000, 'x') +
+                    "1:cd1:ii1234567890ee1:di1ee";
+    REQUIRE(bt_serialize(d) == expected);
+
+    // Stream output goes through a small internal buffer, with large values written directly
+    std::ostringstream oss;
+    oss << "abc" << bt_serializer(d) << bt_serializer(uint8_t{200}) << bt_serializer(int8_t{-3});
+    REQUIRE(oss.str() == "abc" + expected + "i200ei-3e");
+
+    // Appending to an existing string
+    std::string out = "prefix";
+    detail::bt_writer w{out};
+    detail::bt_serialize<bt_dict>{}(w, d);
+    REQUIRE(w.finish() == 6 + expected.size());
+    REQUIRE(out == "prefix" + expected);
+
+    // Fixed buffer
+    std::array<char, 16> buf;
+    detail::bt_writer w2{std::span{buf}};
+    detail::bt_serialize<bt_list>{}(w2, bt_list{{1, 2, "abc"}});
+    REQUIRE(std::string_view{buf.data(), w2.finish()} == "li1ei2e3:abce");
+    detail::bt_writer w3{std::span{buf}};
+    REQUIRE_THROWS_AS(detail::bt_serialize<bt_list>{}(w3, bt_list{{1, 2, "abcdefgh"}}),
+                      std::length_error);
+}
+
+TEST_CASE("bt serialized size", "[bt][serialization][size]") {
+    auto check = [](const auto& val) {
+        auto expected = bt_serialize(val);
+        REQUIRE(bt_serialized_size(val) == expected.size());
+        std::vector<char> buf(expected.size());
+        REQUIRE(bt_serialize_into(buf, val) == expected.size());
+        REQUIRE(std::string_view{buf.data(), buf.size()} == expected);
+        if (!buf.empty()) {
+            buf.pop_back();
+            REQUIRE_THROWS_AS(bt_serialize_into(buf, val), std::length_error);
+        }
+    };
+    check(0);
+    check(9);
+    check(10);
+    check(-1);
+    check(-10);
+    check(true);
+    check(uint8_t{255});
+    check(int8_t{-128});
+    check(std::numeric_limits<int64_t>::min());
+    check(std::numeric_limits<int64_t>::max());
+    check(std::numeric_limits<uint64_t>::max());
+    check(""s);
+    check("hello"sv);
+    check(std::string(12345, 'z'));
+    check("literal");
+    check(std::vector<int>{{1, -22, 333}});
+    check(std::make_tuple(1, "two"s, std::vector<std::string>{{"three"}}));
+    check(std::pair{42u, "b"sv});
+    check(std::unordered_map<std::string, int>{{"z", 1}, {"a", -100}});
+    check(bt_dict{{"a", bt_list{{1, "xy", bt_dict{}}}},
+                  {"b", bt_dict{{"c", uint64_t{18'000'000'000'000'000'000ULL}}}},
+                  {"d", std::string(100, 'q')}});
+    check(bt_value{bt_list{{bt_list{}, int64_t{-5}}}});
+
+    std::array<unsigned char, 4> small;
+    REQUIRE(bt_serialize_into(small, 42) == 4);
+    REQUIRE(std::string_view{reinterpret_cast<char*>(small.data()), 4} == "i42e");
+}
+
 TEST_CASE("bt basic value deserialization", "[bt][deserialization]") {
     REQUIRE(bt_deserialize<int>("i42e") == 42);
 
@@ -87,6 +159,54 @@ TEST_CASE("bt basic value deserialization", "[bt][deserialization]") {
     REQUIRE(bt_deserialize<decltype(v2)>("l1:a0:1:\0006:\x00\x00\x00gooe"sv) == v2);
 }
 
+TEST_CASE("bt integer parsing", "[bt][deserialization][integer]") {
+    // Values of every length, followed by varying amounts of trailing data so that we hit both the
+    // 8-bytes-at-a-time and the byte-at-a-time code paths.
+    std::vector<uint64_t> values{0, 1, 9, 10, 99, 100, 12345, 9999999, 10000000, 99999999};
+    for (uint64_t v = 1; v < 10'000'000'000'000'000'000ULL; v *= 10) {
+        values.push_back(v);
+        values.push_back(v - 1);
+        values.push_back(v + v / 3);
+    }
+    values.push_back(std::numeric_limits<uint64_t>::max());
+    values.push_back(std::numeric_limits<uint64_t>::max() - 9);
+    for (auto v : values) {
+        for (std::string_view trailer :
+             {""sv, "e"sv, "e123"sv, ":abcdefghijklmnop"sv, ":abcdefghijklmnopqrstuvwxyz"sv}) {
+            auto str = std::to_string(v) + std::string{trailer};
+            std::string_view sv{str};
+            CHECK(detail::extract_unsigned(sv) == v);
+            CHECK(sv == trailer);
+        }
+        REQUIRE(bt_deserialize<uint64_t>("i" + std::to_string(v) + "e") == v);
+        if (v <= uint64_t{1} << 63)
+            REQUIRE(bt_deserialize<int64_t>("i-" + std::to_string(v) + "e") ==
+                    static_cast<int64_t>(0 - v));
+    }
+
+    for (std::string_view too_big :
+         {"18446744073709551616"sv,
+          "18446744073709551620e"sv,
+          "19000000000000000000"sv,
+          "99999999999999999999xxxxxxxx"sv,
+          "100000000000000000000"sv,
+          "123456789012345678901234567890"sv}) {
+        REQUIRE_THROWS_AS(detail::extract_unsigned(too_big), bt_deserialize_invalid);
+    }
+    REQUIRE_THROWS_AS(detail::extract_unsigned(""sv), bt_deserialize_invalid);
+    REQUIRE_THROWS_AS(detail::extract_unsigned("e"sv), bt_deserialize_invalid);
+    REQUIRE_THROWS_AS(detail::extract_unsigned("abcdefghijk"sv), bt_deserialize_invalid);
+    // Leading zeros are tolerated (even lots of them)
+    REQUIRE(detail::extract_unsigned("000000000000000000000000000018446744073709551615"sv) ==
+            std::numeric_limits<uint64_t>::max());
+    REQUIRE(detail::extract_unsigned("007e"sv) == 7);
+    // Chars just outside the digit range
+    REQUIRE(detail::extract_unsigned("12/45678"sv) == 12);
+    REQUIRE(detail::extract_unsigned("12:45678"sv) == 12);
+    REQUIRE(detail::extract_unsigned("123456789\xb9\xff"sv) == 123456789);
+    REQUIRE(bt_get("5:hello").index() == 0);
+}
+
 TEST_CASE("bt_value serialization", "[bt][serialization][bt_value]") {
     bt_value dna{42};
     std::string x_ = bt_serialize(dna);
@@ -168,6 +288,196 @@ TEST_CASE("bt_value deserialization", "[bt][deserialization][bt_value]") {
     REQUIRE(var::get<bt_list>(a.at("bar")).empty());
 }
 
+TEST_CASE("bt_value_arena", "[bt][deserialization][arena]") {
+    bt_value_arena arena{256};
+    std::string data =
+            "d1:ali1ei-2e3:xyzle0:e1:bd1:ci18446744073709551615ee1:di-9223372036854775808e"
+            "1:e0:e";
+    auto& root = arena.parse(data);
+    REQUIRE(root.is_dict());
+    REQUIRE(root.size() == 4);
+    auto& a = root.at("a");
+    REQUIRE(a.is_list());
+    REQUIRE(a.size() == 5);
+    auto l = a.list();
+    REQUIRE(l[0].is_unsigned_integer());
+    REQUIRE(l[0].integer<int>() == 1);
+    REQUIRE(l[1].is_negative_integer());
+    REQUIRE(l[1].integer<int8_t>() == -2);
+    REQUIRE_THROWS_AS(l[1].integer<unsigned>(), std::overflow_error);
+    REQUIRE(l[2].str() == "xyz");
+    REQUIRE(l[2].str().data() == data.data() + 14);  // Views into the source
+    REQUIRE(l[3].is_list());
+    REQUIRE(l[3].size() == 0);
+    REQUIRE(l[4].str() == "");
+    REQUIRE_THROWS_AS(l[2].integer<int>(), std::invalid_argument);
+    REQUIRE_THROWS_AS(l[0].str(), std::invalid_argument);
+    REQUIRE(root.at("b").at("c").integer<uint64_t>() == std::numeric_limits<uint64_t>::max());
+    REQUIRE_THROWS_AS(root.at("b").at("c").integer<int64_t>(), std::overflow_error);
+    REQUIRE(root.at("d").integer<int64_t>() == std::numeric_limits<int64_t>::min());
+    REQUIRE(root.at("e").str().empty());
+    REQUIRE(root.find("f") == nullptr);
+    REQUIRE(root.find("") == nullptr);
+    REQUIRE_THROWS_AS(root.at("zz"), std::out_of_range);
+    REQUIRE_THROWS_AS(a.find("a"), std::invalid_argument);
+
+    std::vector<std::string_view> keys;
+    for (auto& [k, v] : root.dict())
+        keys.push_back(k);
+    REQUIRE(keys == std::vector{"a"sv, "b"sv, "d"sv, "e"sv});
+
+    // Unsorted keys still get found (and, like bt_dict, the first of a duplicate key wins)
+    auto& unsorted = arena.parse("d1:bi2e1:ai1e1:bi3ee"sv);
+    REQUIRE(unsorted.at("a").integer<int>() == 1);
+    REQUIRE(unsorted.at("b").integer<int>() == 2);
+
+    // Lots of nodes forces multiple chunks; after a reset they get combined so that parsing the
+    // same thing again doesn't allocate anything new.
+    std::string big = "l";
+    for (int i = 0; i < 500; i++)
+        big += "d3:fooi" + std::to_string(i) + "e3:barli1ei2eee";
+    big += "e";
+    auto& b = arena.parse(big);
+    REQUIRE(b.size() == 500);
+    REQUIRE(b.list()[123].at("foo").integer<int>() == 123);
+    REQUIRE(b.list()[499].at("bar").list()[1].integer<int>() == 2);
+    arena.reset();
+    auto cap = arena.capacity();
+    for (int i = 0; i < 3; i++) {
+        arena.reset();
+        auto& b2 = arena.parse(big);
+        REQUIRE(b2.list()[456].at("foo").integer<int>() == 456);
+        REQUIRE(arena.capacity() == cap);
+    }
+
+    REQUIRE_THROWS_AS(arena.parse("li1e"sv), bt_deserialize_invalid);
+    REQUIRE_THROWS_AS(arena.parse("i1ei2e"sv), bt_deserialize_invalid);
+    REQUIRE_THROWS_AS(arena.parse("d1:ae"sv), bt_deserialize_invalid);
+    REQUIRE_THROWS_AS(arena.parse("di1ei2ee"sv), bt_deserialize_invalid);
+    REQUIRE_THROWS_AS(arena.parse("x"sv), bt_deserialize_invalid);
+    REQUIRE(arena.parse("3:abc"sv).str() == "abc");
+
+    // Nesting depth is limited, and a hostile, very deeply nested value is rejected rather than
+    // exhausting the stack:
+    REQUIRE(arena.parse("llee"sv, 2).list()[0].list().empty());
+    REQUIRE_THROWS_AS(arena.parse("llee"sv, 1), bt_deserialize_invalid);
+    try {
+        arena.parse(std::string(10'000'000, 'l'));
+        FAIL("Expected bt_deserialize_invalid");
+    } catch (const bt_deserialize_invalid& e) {
+        CHECK(e.error.code == bt_errc::too_deep);
+    }
+}
+
+TEST_CASE("bt value views", "[bt][bt_value][view]") {
+    std::string enc = "d1:ali1ei-2e3:xyzl1:bi3eee1:bd1:c0:e1:d12:hello world!e";
+    auto v = bt_get_view(enc);
+    auto& d = var::get<bt_dict>(v);
+    REQUIRE(d.size() == 3);
+    auto& l = var::get<bt_list>(d.at("a"));
+    auto& xyz = *std::next(l.begin(), 2);
+    REQUIRE(std::holds_alternative<std::string_view>(xyz));
+    auto xyz_view = var::get<std::string_view>(xyz);
+    REQUIRE(xyz_view == "xyz");
+    // The views point into the encoded data:
+    REQUIRE(xyz_view.data() == enc.data() + enc.find("xyz"));
+    auto hello = var::get<std::string_view>(d.at("d"));
+    REQUIRE(hello.data() == enc.data() + enc.find("hello"));
+    REQUIRE(var::get<std::string_view>(var::get<bt_dict>(d.at("b")).at("c")).empty());
+    REQUIRE(get_int<int>(l.front()) == 1);
+
+    using T = std::tuple<int, int, std::string, std::pair<std::string_view, int>>;
+    REQUIRE(get_tuple<T>(l) == T{1, -2, "xyz", {"b", 3}});
+    REQUIRE(bt_serialize(v) == enc);
+
+    auto fv = bt_get_flat_view(enc);
+    auto& fd = var::get<bt_flat_dict>(fv);
+    REQUIRE(var::get<std::string_view>(fd.at("d")).data() == hello.data());
+    REQUIRE(bt_serialize(fv) == enc);
+
+    REQUIRE(var::get<std::string_view>(bt_get_view("3:abc")) == "abc");
+    REQUIRE(get_int<int>(bt_get_view("i-3e")) == -3);
+    REQUIRE_THROWS_AS(bt_get_view("d1:ae"), bt_deserialize_invalid);
+    REQUIRE_THROWS_AS(bt_get_view("3:abc3:def"), bt_deserialize_invalid);
+    REQUIRE_THROWS_AS(bt_get_flat_view("l4:abce"), bt_deserialize_invalid);
+}
+
+TEST_CASE("bt flat value", "[bt][flat][bt_value]") {
+    std::string enc = "d1:ali1ei-2e3:xyzl1:bi3eee1:bd1:ci18446744073709551615ee1:di-5e1:e0:e";
+    auto v = bt_get_flat(enc);
+    REQUIRE(std::holds_alternative<bt_flat_dict>(v));
+    auto& d = var::get<bt_flat_dict>(v);
+    REQUIRE(d.size() == 4);
+    REQUIRE(d.contains("a"));
+    REQUIRE_FALSE(d.contains("c"));
+    REQUIRE(d.find("zz") == d.end());
+    REQUIRE(get_int<uint64_t>(var::get<bt_flat_dict>(d.at("b")).at("c")) ==
+            std::numeric_limits<uint64_t>::max());
+    REQUIRE(get_int<int>(d.at("d")) == -5);
+    REQUIRE_THROWS_AS(get_int<unsigned>(d.at("d")), std::overflow_error);
+    REQUIRE_THROWS_AS(d.at("zz"), std::out_of_range);
+    auto& l = var::get<bt_flat_list>(d.at("a"));
+    REQUIRE(l.size() == 4);
+    REQUIRE(var::get<std::string>(l[2]) == "xyz");
+
+    using T = std::tuple<int, int, std::string, std::pair<std::string_view, int>>;
+    REQUIRE(get_tuple<T>(d.at("a")) == T{1, -2, "xyz", {"b", 3}});
+    REQUIRE(get_tuple<T>(l) == T{1, -2, "xyz", {"b", 3}});
+
+    REQUIRE(bt_serialize(v) == enc);
+    REQUIRE(bt_serialized_size(v) == enc.size());
+
+    // Unsorted construction and insertion keep things sorted; duplicates keep the first value
+    bt_flat_dict d2{{"z", 1}, {"a", "x"}, {"m", bt_flat_list{{1, 2}}}, {"a", "y"}};
+    REQUIRE(bt_serialize(d2) == "d1:a1:x1:mli1ei2ee1:zi1ee");
+    d2["b"] = 7;
+    REQUIRE_FALSE(d2.insert({"z", 2}).second);
+    REQUIRE(d2.emplace("c", std::tuple{1, "two"}).second);
+    REQUIRE(d2.insert(d2.end(), {"zz", 3})->first == "zz");
+    REQUIRE(d2.insert(d2.end(), {"aa", 4})->first == "aa");  // Hint is wrong; still sorted
+    REQUIRE(d2.erase("m") == 1);
+    REQUIRE(d2.erase("m") == 0);
+    REQUIRE(bt_serialize(d2) == "d1:a1:x2:aai4e1:bi7e1:cli1e3:twoe1:zi1e2:zzi3ee");
+    REQUIRE(bt_serialize(bt_deserialize<bt_flat_dict>(bt_serialize(d2))) == bt_serialize(d2));
+
+    // Values can be modified through iteration, but keys can't, so the order survives
+    static_assert(!std::is_assignable_v<decltype((d2.begin()->first)), std::string>);
+    for (auto& [k, v] : d2)
+        if (k == "b")
+            v = 8;
+    d2.find("zz")->second = "zz";
+    REQUIRE(std::is_sorted(d2.begin(), d2.end(), [](const auto& a, const auto& b) {
+        return a.first < b.first;
+    }));
+    REQUIRE(d2.find("zz") != d2.cend());
+    auto before_reserve = bt_serialize(d2);
+    d2.reserve(100);
+    REQUIRE(bt_serialize(d2) == before_reserve);
+    REQUIRE(bt_serialize(d2) == "d1:a1:x2:aai4e1:bi8e1:cli1e3:twoe1:zi1e2:zz2:zze");
+    REQUIRE_FALSE(bt_validate(bt_serialize(d2), true));
+
+    // bt_value and bt_flat_value decode to the same encoding
+    REQUIRE(bt_serialize(bt_get(enc)) == bt_serialize(bt_get_flat(enc)));
+
+    // Unsorted input still ends up sorted (so lookups work)
+    auto unsorted = bt_deserialize<bt_flat_dict>("d1:bi1e1:ai2ee");
+    REQUIRE(get_int<int>(unsorted.at("a")) == 2);
+    REQUIRE(unsorted.begin()->first == "a");
+
+    bt_dict_producer p;
+    p.append_bt("a", d2);
+    p.append_bt("b", l);
+    p.append_bt("c", v);
+    {
+        auto sub = p.append_list("d");
+        sub.append_bt(bt_flat_value{"x"});
+        sub.append_bt(l);
+        sub.append_bt(bt_flat_dict{{"k", 1}});
+    }
+    REQUIRE(p.view() == "d1:a" + bt_serialize(d2) + "1:b" + bt_serialize(l) + "1:c" + enc +
+                                "1:dl1:x" + bt_serialize(l) + "d1:ki1eeee");
+}
+
 TEST_CASE("bt tuple serialization", "[bt][tuple][serialization]") {
     // Deserializing directly into a tuple:
     std::tuple<int, std::string, std::vector<int>> x{42, "hi", {{1, 2, 3, 4, 5}}};
@@ -393,6 +703,385 @@ TEST_CASE("bt streaming dict producer", "[bt][dict][producer]") {
     }
 }
 
+TEST_CASE("bt dict producer compile-time keys", "[bt][dict][producer][key]") {
+    static_assert(std::string_view{detail::bt_key_encoded<"">.data(), 2} == "0:");
+    static_assert(std::string_view{detail::bt_key_encoded<"abcdefghijkl">.data(), 15} ==
+                  "12:abcdefghijkl");
+    static_assert(detail::bt_keys_ascending<"", "a", "ab", "b">());
+    static_assert(!detail::bt_keys_ascending<"a", "a">());
+    static_assert(!detail::bt_keys_ascending<"b", "a">());
+
+    auto external_buffer = GENERATE(true, false);
+    char buf[1024];
+    auto dp = external_buffer ? bt_dict_producer{buf, sizeof(buf)} : bt_dict_producer{};
+
+    dp.append<"">(true);
+    dp.append<"a", "abcdefghijkl", "b">("x", -123, std::string(3, 'y'));
+    std::optional<int> none, one{1};
+    std::basic_string_view<unsigned char> ff{reinterpret_cast<const unsigned char*>("\xff"), 1};
+    dp.append<"c", "d", "e">(none, one, ff);
+    {
+        auto sublist = dp.append_list<"l">();
+        sublist += 42;
+    }
+    {
+        auto subd = dp.append_dict<"m">();
+        subd.append<"n">(uint64_t{18446744073709551615ULL});
+        CHECK(subd.view() == "d1:ni18446744073709551615ee");
+    }
+    dp.append("z", 0);
+    auto expected =
+            "d0:i1e1:a1:x12:abcdefghijkli-123e1:b3:yyy1:di1e1:e1:\xff"
+            "1:lli42ee1:md1:ni18446744073709551615ee1:zi0ee"sv;
+    CHECK(dp.view() == expected);
+
+    // The same through the runtime-key interface:
+    bt_dict_producer rt;
+    rt.append("", true);
+    rt.append("a", "x");
+    rt.append("abcdefghijkl", -123);
+    rt.append("b", "yyy");
+    rt.append("d", 1);
+    rt.append("e", "\xff");
+    rt.append_list("l").append(42);
+    rt.append_dict("m").append("n", uint64_t{18446744073709551615ULL});
+    rt.append("z", 0);
+    CHECK(rt.view() == expected);
+
+    char small[12];
+    bt_dict_producer sp{small, sizeof(small)};
+    sp.append<"a">(1);
+    CHECK(sp.view() == "d1:ai1ee");
+    CHECK_THROWS_AS((sp.append<"b", "c">(2, 3)), std::length_error);
+}
+
+TEST_CASE("bt message templates", "[bt][producer][template]") {
+    auto ping = bt_message_template::dict([](auto& d, auto& hole) {
+        hole(d, "id");
+        d.append("method", "ping");
+        auto p = d.append_dict("params");
+        auto l = p.append_list("flags");
+        l.append("a");
+        hole(l);
+        hole(l);
+        l.append(7);
+    });
+    CHECK(ping.holes() == 3);
+    CHECK(ping.skeleton() == "d2:id6:method4:ping6:paramsd5:flagsl1:ai7eeee");
+
+    auto msg = ping.fill(123, "xyz", true);
+    CHECK(msg == "d2:idi123e6:method4:ping6:paramsd5:flagsl1:a3:xyzi1ei7eeee");
+    CHECK(ping.size(123, "xyz", true) == msg.size());
+
+    // Same as building it directly:
+    bt_dict_producer d;
+    d.append("id", -5);
+    d.append("method", "ping");
+    {
+        auto p = d.append_dict("params");
+        auto l = p.append_list("flags");
+        l.append("a");
+        l.append(std::string(100, 'z'));
+        l.append(0);
+        l.append(7);
+    }
+    CHECK(ping.fill(-5, std::string(100, 'z'), false) == d.view());
+
+    std::basic_string_view<unsigned char> usv{reinterpret_cast<const unsigned char*>("\x01"), 1};
+    CHECK(ping.fill(std::numeric_limits<uint64_t>::max(), usv, 0) ==
+          "d2:idi18446744073709551615e6:method4:ping6:paramsd5:flagsl1:a1:\x01i0ei7eeee");
+
+    CHECK_THROWS_AS(ping.fill(1, 2), std::invalid_argument);
+    CHECK_THROWS_AS(ping.fill(1, 2, 3, 4), std::invalid_argument);
+
+    char buf[64];
+    auto v = ping.fill_into(buf, buf + sizeof(buf), 1, "", 2);
+    CHECK(v == "d2:idi1e6:method4:ping6:paramsd5:flagsl1:a0:i2ei7eeee");
+    CHECK(v.data() == buf);
+    CHECK_THROWS_AS(
+            ping.fill_into(buf, buf + sizeof(buf), 1, std::string(50, 'x'), 2), std::length_error);
+
+    // List templates, and templates that are nothing but holes or have no holes:
+    auto l = bt_message_template::list([](auto& l, auto& hole) { hole(l); });
+    CHECK(l.fill("hi") == "l2:hie");
+    auto none = bt_message_template::dict([](auto& d, auto&) { d.append("a", 1); });
+    CHECK(none.holes() == 0);
+    CHECK(none.fill() == "d1:ai1ee");
+}
+
+TEST_CASE("bt scatter-gather producer", "[bt][producer][gather]") {
+    auto join = [](const std::vector<std::string_view>& segs) {
+        std::string s;
+        for (auto seg : segs)
+            s += seg;
+        return s;
+    };
+    std::string big(100, 'x'), big2(50, 'y');
+
+    bt_dict_producer d{bt_gather{50}};
+    CHECK(join(d.segments()) == "de");
+    d.append("a", big);
+    d.append("b", "small");
+    {
+        auto l = d.append_list("c");
+        l.append(big2);
+        l.append(big2);
+        l.append(1);
+        CHECK(join(l.segments()) == "l50:" + big2 + "50:" + big2 + "i1ee");
+        CHECK(join(d.segments()) == "d1:a100:" + big + "1:b5:small1:cl50:" + big2 + "50:" + big2 +
+                                            "i1eee");
+    }
+    d.append<"d">(big2);
+
+    bt_dict_producer expected;
+    expected.append("a", big);
+    expected.append("b", "small");
+    {
+        auto l = expected.append_list("c");
+        l.append(big2);
+        l.append(big2);
+        l.append(1);
+    }
+    expected.append("d", big2);
+
+    auto segs = d.segments();
+    CHECK(join(segs) == expected.view());
+    // The large values are referenced, not copied:
+    REQUIRE(segs.size() == 9);
+    CHECK(segs[0] == "d1:a100:");
+    CHECK(segs[1].data() == big.data());
+    CHECK(segs[2] == "1:b5:small1:cl50:");
+    CHECK(segs[3].data() == big2.data());
+    CHECK(segs[4] == "50:");
+    CHECK(segs[5].data() == big2.data());
+    CHECK(segs[6] == "i1ee1:d50:");
+    CHECK(segs[7].data() == big2.data());
+    CHECK(segs[8] == "e");
+
+    struct test_iovec {
+        void* iov_base;
+        size_t iov_len;
+    };
+    auto iov = d.iovecs<test_iovec>();
+    REQUIRE(iov.size() == segs.size());
+    for (size_t i = 0; i < iov.size(); i++) {
+        CHECK(iov[i].iov_base == segs[i].data());
+        CHECK(iov[i].iov_len == segs[i].size());
+    }
+
+    // Signing works on a copy of the (non-contiguous) data:
+    auto sign = [](std::string_view v) { return std::to_string(v.size()) + std::string{v.substr(0, 8)}; };
+    CHECK(d.view_for_signing() == expected.view_for_signing());
+    d.append_signature("~", sign);
+    expected.append_signature("~", sign);
+    CHECK(join(d.segments()) == expected.view());
+
+    CHECK_THROWS_AS(d.view(), std::logic_error);
+    CHECK_THROWS_AS(d.end(), std::logic_error);
+    CHECK_THROWS_AS(std::move(d).str(), std::logic_error);
+
+    // Small values, and values below a custom threshold, are copied:
+    bt_list_producer l{bt_gather{}};
+    l.append(big);
+    l.append_encoded(expected.view());
+    CHECK(l.segments().size() == 1);
+    CHECK(join(l.segments()) == "l100:" + big + std::string{expected.view()} + "e");
+    bt_list_producer l2{bt_gather{0}};
+    l2.append("");
+    l2.append_encoded("i1e");
+    CHECK(join(l2.segments()) == "l0:i1ee");
+    CHECK(l2.segments().size() == 4);
+
+    // Other modes just give the view:
+    CHECK(expected.segments() == std::vector<std::string_view>{expected.view()});
+}
+
+TEST_CASE("bt chained producer", "[bt][producer][chain]") {
+    auto join = [](const std::vector<std::string_view>& segs) {
+        std::string s;
+        for (auto seg : segs)
+            s += seg;
+        return s;
+    };
+    auto build = [](bt_dict_producer& d) {
+        d.append("a", "hello world");
+        {
+            auto l = d.append_list("b");
+            l.append(std::string(20, 'x'));
+            l.append(123);
+            auto l2 = l.append_list();
+            l2.append("");
+        }
+        d.append<"c">(-42);
+    };
+
+    bt_dict_producer expected;
+    build(expected);
+
+    bt_dict_producer d{bt_chain{8}};
+    CHECK(join(d.segments()) == "de");
+    d.append("0", "abc");
+    auto first = d.segments().front();
+    REQUIRE(first.size() == 8);
+    build(d);
+    // Appending never moves the data already written:
+    CHECK(d.segments().front().data() == first.data());
+    CHECK(first == "d1:03:ab");
+
+    auto segs = d.segments();
+    for (size_t i = 0; i + 1 < segs.size(); i++)
+        CHECK(segs[i].size() == 8);
+    auto full = join(segs);
+    CHECK(full.substr(0, 8) == "d1:03:ab");
+    CHECK(full.substr(9) == std::string{expected.view()}.substr(1));
+
+    // Sub-producers give the pieces of their own range:
+    bt_list_producer l{bt_chain{3}};
+    l.append("abcdef");
+    {
+        auto sub = l.append_list();
+        sub.append(12345);
+        CHECK(join(sub.segments()) == "li12345ee");
+        CHECK(join(l.segments()) == "l6:abcdefli12345eee");
+    }
+    CHECK(l.segments().size() == 7);
+
+    // Signing works on a flattened copy of the blocks:
+    auto sign = [](std::string_view v) { return std::to_string(v.size()) + std::string{v}; };
+    bt_dict_producer signed_chain{bt_chain{8}};
+    build(signed_chain);
+    CHECK(signed_chain.view_for_signing() == expected.view_for_signing());
+    signed_chain.append_signature("~", sign);
+    expected.append_signature("~", sign);
+    CHECK(join(signed_chain.segments()) == expected.view());
+
+    CHECK_THROWS_AS(d.view(), std::logic_error);
+    CHECK_THROWS_AS(d.end(), std::logic_error);
+    CHECK(std::move(d).str() == full);
+    CHECK(join(d.segments()) == "de");
+    d.append("x", 1);
+    CHECK(std::move(d).str() == "d1:xi1ee");
+
+    CHECK_THROWS_AS(bt_list_producer{bt_chain{0}}, std::invalid_argument);
+}
+
+TEST_CASE("bt lazy-close producer", "[bt][producer][lazy]") {
+    auto build = [](bt_dict_producer& d) {
+        d.append("a", 1);
+        {
+            auto l = d.append_list("b");
+            l.append("x");
+            {
+                auto sub = l.append_dict();
+                sub.append("c", "y");
+                auto sub2 = sub.append_list("d");
+                sub2.append(2);
+            }
+            l.append(3);
+        }
+        d.append<"e", "f">("z", 4);
+    };
+
+    bt_dict_producer expected;
+    build(expected);
+    auto expected_str = std::string{expected.view()};
+
+    bt_dict_producer d;
+    d.lazy_close();
+    build(d);
+    CHECK(d.view() == expected_str);
+    CHECK(d.view_for_signing() == expected.view_for_signing());
+    d.append("g", 5);
+    d.append_signature("~", [](std::string_view v) { return std::to_string(v.size()); });
+    expected.append("g", 5);
+    expected.append_signature("~", [](std::string_view v) { return std::to_string(v.size()); });
+    CHECK(d.view() == expected.view());
+
+    {
+        // In lazy mode the ends aren't written until needed:
+        bt_list_producer l;
+        l.lazy_close();
+        CHECK(l.view() == "le");
+        auto sub = l.append_list();
+        sub.append(1);
+        CHECK(l.str_ref() == "lli1e");
+        CHECK_THROWS_AS(l.view(), std::logic_error);
+        CHECK_THROWS_AS(l.flush(), std::logic_error);
+        CHECK_THROWS_AS(sub.lazy_close(false), std::logic_error);
+        CHECK(sub.view() == "li1ee");
+        sub.flush();
+        CHECK(l.str_ref() == "lli1eee");
+        sub.append(2);
+        CHECK(l.str_ref() == "lli1ei2e");
+    }
+
+    // Deep nesting:
+    auto nest = [](bt_list_producer& l, int depth, auto& self) -> void {
+        l.append(depth);
+        if (depth > 0) {
+            auto sub = l.append_list();
+            self(sub, depth - 1, self);
+        }
+        l.append(depth);
+    };
+    bt_list_producer deep, deep_lazy;
+    deep_lazy.lazy_close();
+    nest(deep, 100, nest);
+    nest(deep_lazy, 100, nest);
+    CHECK(deep_lazy.view() == deep.view());
+    auto deep_str = std::string{deep.view()};
+
+    // Switching back to always-valid mode:
+    deep_lazy.lazy_close(false);
+    deep_lazy.append(1);
+    deep.append(1);
+    CHECK(deep_lazy.str_ref() == deep.view());
+
+    // With an external buffer appends still fail if there wouldn't be room for the ends:
+    std::string buf(deep_str.size(), '\0');
+    bt_list_producer ext{buf.data(), buf.size()};
+    ext.lazy_close();
+    nest(ext, 100, nest);
+    CHECK(ext.view() == deep_str);
+    {
+        // end() writes the pending closing `e`, and so does destruction
+        std::string buf2(30, 'X');
+        {
+            bt_dict_producer d3{buf2.data(), buf2.size()};
+            d3.lazy_close();
+            d3.append("a", 1);
+            {
+                auto l = d3.append_list("b");
+                l.append(2);
+            }
+            CHECK(std::string_view{buf2.data(), static_cast<size_t>(d3.end() - buf2.data())} ==
+                  "d1:ai1e1:bli2eee");
+            d3.append("c", 3);
+        }
+        CHECK(buf2.substr(0, 23) == "d1:ai1e1:bli2ee1:ci3eeX");
+    }
+    bt_list_producer ext2{buf.data(), buf.size() - 1};
+    ext2.lazy_close();
+    CHECK_THROWS_AS(nest(ext2, 100, nest), std::length_error);
+
+    // And it works with the other output modes:
+    std::string big(100, 'x');
+    for (auto out : {0, 1}) {
+        auto d2 = out ? bt_dict_producer{bt_chain{7}} : bt_dict_producer{bt_gather{50}};
+        d2.lazy_close();
+        build(d2);
+        d2.append("g", big);
+        std::string joined;
+        for (auto seg : d2.segments())
+            joined += seg;
+        CHECK(joined == expected_str.substr(0, expected_str.size() - 1) + "1:g100:" + big + "e");
+        if (out)
+            CHECK(std::move(d2).str() == joined);
+        else
+            CHECK_THROWS_AS(std::move(d2).str(), std::logic_error);
+    }
+}
+
 template <typename Char>
 std::basic_string_view<Char> to_sv(std::string_view x) {
     return {reinterpret_cast<const Char*>(x.data()), x.size()};
@@ -695,6 +1384,710 @@ TEST_CASE("bt trailing garbage detection", "[bt][deserialization][trailing-garba
     REQUIRE_NOTHROW(dc3.finish());
 }
 
+TEST_CASE("bt validation", "[bt][validate]") {
+    using errc = bt_errc;
+    auto validate = [](std::string_view data, bool check_key_order = false) {
+        auto err = bt_validate(data, check_key_order);
+        return std::make_pair(err.code, err.offset);
+    };
+    const std::pair ok{errc::ok, size_t{0}};
+    for (std::string_view valid :
+         {"i0e"sv,
+          "i-9223372036854775808e"sv,
+          "i18446744073709551615e"sv,
+          "0:"sv,
+          "3:abc"sv,
+          "le"sv,
+          "de"sv,
+          "lleledee"sv,
+          "d1:ad1:bl3:xyzi1eee1:c0:e"sv,
+          "l5:hello12:hello world!i42eli1ei2eded1:ai1eeee"sv}) {
+        CHECK(validate(valid) == ok);
+        CHECK(validate(valid, true) == ok);
+    }
+
+    // Deep nesting spills the validation stack to the heap:
+    std::string deep = std::string(1000, 'l') + "i1e" + std::string(1000, 'e');
+    auto validate_deep = [](std::string_view data) {
+        auto err = bt_validate(data, false, 1000);
+        return std::make_pair(err.code, err.offset);
+    };
+    CHECK(validate_deep(deep) == ok);
+    CHECK(validate_deep(deep.substr(0, deep.size() - 1)) ==
+          std::pair{errc::truncated, size_t{2002}});
+    std::string deep_dicts;
+    for (int i = 0; i < 100; i++)
+        deep_dicts += "d1:a";
+    deep_dicts += "le" + std::string(100, 'e');
+    CHECK(validate(deep_dicts, true) == ok);
+
+    CHECK(validate("") == std::pair{errc::truncated, size_t{0}});
+    CHECK(validate("x") == std::pair{errc::invalid_value, size_t{0}});
+    CHECK(validate("i1ee") == std::pair{errc::trailing_data, size_t{3}});
+    CHECK(validate("i12") == std::pair{errc::truncated, size_t{3}});
+    CHECK(validate("i1x") == std::pair{errc::expected_end, size_t{2}});
+    CHECK(validate("i18446744073709551616e") == std::pair{errc::integer_overflow, size_t{1}});
+    CHECK(validate("i-9223372036854775809e") == std::pair{errc::integer_overflow, size_t{21}});
+    CHECK(validate("4:abc") == std::pair{errc::truncated, size_t{0}});
+    CHECK(validate("3abc") == std::pair{errc::expected_colon, size_t{1}});
+    CHECK(validate("l3:abc") == std::pair{errc::truncated, size_t{6}});
+    CHECK(validate("li1e?e") == std::pair{errc::invalid_value, size_t{4}});
+    CHECK(validate("ll1:ae") == std::pair{errc::truncated, size_t{6}});
+    CHECK(validate("di1ei2ee") == std::pair{errc::invalid_key, size_t{1}});
+    CHECK(validate("dl1:ae1:be") == std::pair{errc::invalid_key, size_t{1}});
+    CHECK(validate("d1:ae") == std::pair{errc::missing_value, size_t{4}});
+    CHECK(validate("d1:a") == std::pair{errc::truncated, size_t{4}});
+    CHECK(validate("d1:ad1:bi1ei2eee") == std::pair{errc::invalid_key, size_t{11}});
+
+    // Key ordering is only checked when requested:
+    for (std::string_view unsorted : {"d1:bi1e1:ai2ee"sv, "d1:ai1e1:ai2ee"sv}) {
+        CHECK(validate(unsorted) == ok);
+        CHECK(validate(unsorted, true) == std::pair{errc::unsorted_key, size_t{7}});
+    }
+    // Each dict has its own ordering (and nested keys don't affect the outer dict):
+    CHECK(validate("d1:bd1:ai1e1:bi2ee1:cd1:ai3eee", true) == ok);
+    CHECK(validate("d1:bd1:ai1e1:bi2ee1:ad1:ai3eee", true) ==
+          std::pair{errc::unsorted_key, size_t{18}});
+    CHECK(validate("d1:bld1:bi1e1:ai2eeee", true) == std::pair{errc::unsorted_key, size_t{12}});
+    CHECK(validate("d0:i1e1:ai1e2:aai1e1:bi1ee", true) == ok);
+
+    // The validator should agree with the parser:
+    for (auto& enc : {"d1:ad1:bl3:xyzi1eee1:c0:e"s, "li1ei2eld1:xi-5eeee"s}) {
+        for (size_t i = 0; i < enc.size(); i++) {
+            auto partial = std::string_view{enc}.substr(0, i);
+            bt_value v;
+            CHECK(validate(partial).first == bt_try_deserialize(partial, v).code);
+        }
+    }
+}
+
+TEST_CASE("bt nesting depth limits", "[bt][deserialization][depth]") {
+    auto nested = [](size_t depth) {
+        std::string s;
+        for (size_t i = 0; i < depth; i++)
+            s += i % 2 ? "d1:x" : "l";
+        s += "i1e";
+        for (size_t i = 0; i < depth; i++)
+            s += 'e';
+        return s;
+    };
+    auto ok = nested(bt_default_max_depth);
+    auto too_deep = nested(bt_default_max_depth + 1);
+    // The offset of the list or dict that is one level too deep:
+    size_t too_deep_at = bt_default_max_depth / 2 * 5;
+
+    CHECK_FALSE(bt_validate(ok));
+    auto err = bt_validate(too_deep);
+    CHECK(err.code == bt_errc::too_deep);
+    CHECK(err.offset == too_deep_at);
+    CHECK_FALSE(bt_validate(too_deep, false, bt_default_max_depth + 1));
+    CHECK(bt_validate("lle", false, 1).code == bt_errc::too_deep);
+    CHECK(bt_validate("i1e", false, 0).code == bt_errc::ok);
+    CHECK(bt_validate("le", false, 0).code == bt_errc::too_deep);
+
+    bt_value v;
+    CHECK_FALSE(bt_try_deserialize(ok, v));
+    err = bt_try_deserialize(too_deep, v);
+    CHECK(err.code == bt_errc::too_deep);
+    CHECK(err.offset == too_deep_at);
+    bt_flat_value fv;
+    CHECK(bt_try_deserialize(too_deep, fv).code == bt_errc::too_deep);
+    REQUIRE_THROWS_AS(bt_get(too_deep), bt_deserialize_invalid);
+
+    // A hostile, very deeply nested value is rejected rather than exhausting the stack:
+    std::string hostile(10'000'000, 'l');
+    CHECK(bt_validate(hostile).code == bt_errc::too_deep);
+    CHECK(bt_try_deserialize(hostile, v).code == bt_errc::too_deep);
+
+    auto list_data = "l" + too_deep + "e";
+    bt_list_consumer l{list_data};
+    CHECK(l.max_depth() == bt_default_max_depth);
+    bt_error e;
+    l.skip_value(e);
+    CHECK(e.code == bt_errc::too_deep);
+    CHECK(e.offset == 1 + too_deep_at);
+    l.set_max_depth(bt_default_max_depth + 1);
+    auto l2 = l;
+    l.skip_value();
+    CHECK(l.is_finished());
+    // Nested consumers get the remaining depth:
+    auto sub = l2.consume_list_consumer();
+    CHECK(sub.max_depth() == bt_default_max_depth);
+    auto subsub = sub.consume_dict_consumer();
+    CHECK(subsub.max_depth() == bt_default_max_depth - 1);
+    CHECK(subsub.key() == "x");
+
+    auto dict_data = "d1:a" + too_deep + "1:bi2ee";
+    bt_dict_consumer d{dict_data};
+    CHECK(d.max_depth() == bt_default_max_depth);
+    d.set_max_depth(3);
+    REQUIRE_THROWS_AS(d.skip_until("b"), bt_deserialize_invalid);
+    d.set_max_depth(bt_default_max_depth + 1);
+    CHECK(d.require<int>("b") == 2);
+    d.finish();
+}
+
+TEST_CASE("bt dict index", "[bt][dict][index]") {
+    std::string data =
+            "d1:ai1e1:bli2ei3ee1:cd1:xi-4ee4:four3:abc3:int"
+            "i18446744073709551615e5:longzi5ee";
+    bt_dict_index d{data};
+    CHECK(d.size() == 6);
+    CHECK(d.data() == data);
+    // Out of order lookups, repeated lookups, and missing keys:
+    CHECK(d.require<std::string>("four") == "abc");
+    CHECK(d.require<int>("a") == 1);
+    CHECK(d.require<uint64_t>("int") == std::numeric_limits<uint64_t>::max());
+    CHECK(d.require<int>("a") == 1);
+    CHECK(d.find<int>("zzz") == std::nullopt);
+    CHECK(d.find<int>("") == std::nullopt);
+    CHECK(d.find<int>("aa") == std::nullopt);
+    CHECK(d.contains("longz"));
+    CHECK_FALSE(d.contains("long"));
+    CHECK(d.find_data("b") == "li2ei3ee");
+    CHECK(d.find_data("x").empty());
+    CHECK(d.require<std::vector<int>>("b") == std::vector{2, 3});
+    auto c = d.require<bt_dict_consumer>("c");
+    CHECK(c.require<int>("x") == -4);
+    c.finish();
+    auto l = d.require<bt_list_consumer>("b");
+    CHECK(l.consume_integer<int>() == 2);
+    CHECK(d.find<bt_dict_consumer>("c").has_value());
+    REQUIRE_THROWS_AS(d.require<int>("b"), bt_deserialize_invalid_type);
+    REQUIRE_THROWS_AS(d.require<int>("x"), std::out_of_range);
+    REQUIRE_THROWS_AS(d.require<uint8_t>("int"), bt_deserialize_invalid);
+
+    bt_error err;
+    CHECK(d.require<std::string_view>("a", err).empty());
+    CHECK(err.code == bt_errc::wrong_type);
+    CHECK(err.offset == 4);
+    CHECK(d.require<int>("x", err) == 0);
+    CHECK(err.code == bt_errc::missing_key);
+    CHECK(d.find<int>("x", err) == std::nullopt);
+    CHECK_FALSE(err);
+    CHECK(d.find<uint8_t>("int", err) == std::nullopt);
+    CHECK(err.code == bt_errc::integer_overflow);
+
+    // Larger dicts spill the index to the heap:
+    for (int n : {0, 1, 31, 32, 33, 100}) {
+        std::map<std::string, int> m;
+        for (int i = 0; i < n; i++)
+            m["key" + std::to_string(i)] = i * i;
+        auto enc = bt_serialize(m);
+        bt_dict_index big{enc};
+        CHECK(big.size() == static_cast<size_t>(n));
+        CHECK(big.empty() == (n == 0));
+        for (int i = n - 1; i >= 0; i--)
+            CHECK(big.require<int>("key" + std::to_string(i)) == i * i);
+        CHECK_FALSE(big.contains("key"));
+        CHECK_FALSE(big.contains("key" + std::to_string(n)));
+        auto copy = big;
+        CHECK(copy.find<int>("key0") == (n ? std::optional{0} : std::nullopt));
+    }
+
+    // Validation:
+    auto index_error = [](std::string_view enc) {
+        bt_error err;
+        bt_dict_index idx{enc, err};
+        CHECK(idx.empty());
+        return std::make_pair(err.code, err.offset);
+    };
+    using errc = bt_errc;
+    CHECK(index_error("de") == std::pair{errc::ok, size_t{0}});
+    CHECK(index_error("d") == std::pair{errc::truncated, size_t{0}});
+    CHECK(index_error("li1ee") == std::pair{errc::wrong_type, size_t{0}});
+    CHECK(index_error("d1:ai1e") == std::pair{errc::truncated, size_t{7}});
+    CHECK(index_error("d1:bi1e1:ai2ee") == std::pair{errc::unsorted_key, size_t{7}});
+    CHECK(index_error("d1:ai1e1:ai2ee") == std::pair{errc::unsorted_key, size_t{7}});
+    CHECK(index_error("di1ei2ee") == std::pair{errc::invalid_key, size_t{1}});
+    CHECK(index_error("d1:ae") == std::pair{errc::missing_value, size_t{4}});
+    CHECK(index_error("d1:ai1x1:bi2ee") == std::pair{errc::expected_end, size_t{6}});
+    CHECK(index_error("d1:ai1ee?") == std::pair{errc::trailing_data, size_t{8}});
+    REQUIRE_THROWS_AS(bt_dict_index{"d1:bi1e1:ai2ee"sv}, bt_deserialize_invalid);
+}
+
+TEST_CASE("bt non-throwing deserialization", "[bt][deserialization][error]") {
+    auto try_deserialize = [](std::string_view data, auto& val) {
+        auto err = bt_try_deserialize(data, val);
+        return std::make_pair(err.code, err.offset);
+    };
+    using errc = bt_errc;
+
+    int i = 0;
+    CHECK_FALSE(bt_try_deserialize("i12345e", i));
+    CHECK(i == 12345);
+    CHECK(try_deserialize("i12x", i) == std::pair{errc::expected_end, size_t{3}});
+    CHECK(try_deserialize("i1ei2e", i) == std::pair{errc::trailing_data, size_t{3}});
+    CHECK(try_deserialize("i", i) == std::pair{errc::truncated, size_t{0}});
+    CHECK(try_deserialize("i-e", i) == std::pair{errc::expected_digit, size_t{2}});
+    CHECK(try_deserialize("3:abc", i) == std::pair{errc::wrong_type, size_t{0}});
+    uint32_t u32;
+    CHECK(try_deserialize("i4294967296e", u32) == std::pair{errc::integer_overflow, size_t{0}});
+    CHECK(try_deserialize("i-1e", u32) == std::pair{errc::integer_overflow, size_t{0}});
+    uint64_t u64;
+    CHECK(try_deserialize("i18446744073709551616e", u64) ==
+          std::pair{errc::integer_overflow, size_t{1}});
+
+    std::string str;
+    CHECK_FALSE(bt_try_deserialize("3:abc", str));
+    CHECK(str == "abc");
+    CHECK(try_deserialize("5:abc", str) == std::pair{errc::truncated, size_t{0}});
+    CHECK(try_deserialize("3abc", str) == std::pair{errc::expected_colon, size_t{1}});
+
+    std::vector<int> list;
+    CHECK(try_deserialize("li1e", list) == std::pair{errc::truncated, size_t{4}});
+    CHECK(try_deserialize("li1e1:ae", list) == std::pair{errc::wrong_element_type, size_t{4}});
+    std::tuple<int, int> tup;
+    CHECK(try_deserialize("li1ee", tup) == std::pair{errc::wrong_size, size_t{4}});
+    CHECK(try_deserialize("li1ei2ei3ee", tup) == std::pair{errc::wrong_size, size_t{7}});
+    CHECK_FALSE(bt_try_deserialize("li1ei2ee", tup));
+    CHECK(tup == std::tuple{1, 2});
+
+    bt_dict dict;
+    CHECK(try_deserialize("di1ei2ee", dict) == std::pair{errc::invalid_key, size_t{1}});
+    CHECK(try_deserialize("d1:ae", dict) == std::pair{errc::missing_value, size_t{4}});
+    bt_value val;
+    CHECK(try_deserialize("d1:ald1:bxeee", val) == std::pair{errc::invalid_value, size_t{9}});
+    CHECK_FALSE(bt_try_deserialize("d1:ald1:bi1eeee", val));
+
+    // The throwing interface reports the same errors:
+    try {
+        bt_deserialize<std::vector<int>>("li1e1:ae");
+        FAIL("bt_deserialize should have thrown");
+    } catch (const bt_deserialize_invalid& e) {
+        CHECK(e.error.code == errc::wrong_element_type);
+        CHECK(e.error.offset == 4);
+        CHECK(std::string_view{e.what()} ==
+              "Deserialization failed at byte 4: nested value has the wrong type");
+    }
+    REQUIRE_THROWS_AS(bt_deserialize<std::string>("i1e"), bt_deserialize_invalid_type);
+
+    bt_error err;
+    bt_dict_consumer d{"d1:ai1e1:b20:abc1:ci2ee"sv, err};
+    CHECK_FALSE(err);
+    CHECK_FALSE(d.is_finished(err));
+    CHECK(d.key(err) == "a");
+    CHECK(d.consume_integer<int>(err) == 1);
+    CHECK_FALSE(err);
+    CHECK(d.require<std::string_view>("b", err) == "");
+    CHECK(err.code == errc::truncated);
+    CHECK(err.offset == 10);
+    CHECK(err.message() == "unexpected end of data"sv);
+    // A failed consume doesn't advance:
+    CHECK(d.key(err) == "b");
+    CHECK_FALSE(err);
+    CHECK(d.consume_string_view(err).empty());
+    CHECK(err.code == errc::truncated);
+    CHECK(d.maybe<int>("c", err) == std::nullopt);
+    CHECK(err.code == errc::truncated);
+
+    bt_dict_consumer d2{"d1:ai1e1:bi2ee???"sv, err};
+    d2.required("c", err);
+    CHECK(err.code == errc::missing_key);
+    CHECK(err.offset == 13);
+    d2.finish(err);
+    CHECK(err.code == errc::trailing_data);
+    CHECK(err.offset == 14);
+    REQUIRE_THROWS_AS(d2.finish(), bt_deserialize_invalid);
+
+    bt_dict_consumer d3{"li1ee"sv, err};
+    CHECK(err.code == errc::wrong_type);
+    CHECK(d3.is_finished(err));
+    CHECK_FALSE(err);
+
+    bt_list_consumer l{"li1e3:abcl1:xexi2ee"sv, err};
+    CHECK_FALSE(err);
+    CHECK(l.consume_integer<int>(err) == 1);
+    CHECK(l.consume_integer<int>(err) == 0);
+    CHECK(err.code == errc::wrong_type);
+    CHECK(err.offset == 4);
+    CHECK(l.consume_string(err) == "abc");
+    auto sub = l.consume_list_consumer(err);
+    CHECK_FALSE(err);
+    CHECK(sub.consume_string_view(err) == "x");
+    CHECK(sub.is_finished());
+    l.skip_value(err);
+    CHECK(err.code == errc::invalid_value);
+    CHECK(err.offset == 14);
+    l.finish(err);
+    CHECK(err.code == errc::invalid_value);
+}
+
+namespace {
+// Stream parser handler that re-encodes everything it sees
+struct bt_reencoder {
+    std::string out;
+    void begin_list() { out += 'l'; }
+    void begin_dict() { out += 'd'; }
+    void end_list() { out += 'e'; }
+    void end_dict() { out += 'e'; }
+    void key(std::string_view frag, uint64_t offset, uint64_t size) { string(frag, offset, size); }
+    void string(std::string_view frag, uint64_t offset, uint64_t size) {
+        if (offset == 0)
+            out += std::to_string(size) + ':';
+        out += frag;
+    }
+    void integer(int64_t i) { out += 'i' + std::to_string(i) + 'e'; }
+    void integer(uint64_t i) { out += 'i' + std::to_string(i) + 'e'; }
+};
+}  // namespace
+
+TEST_CASE("bt stream parser", "[bt][stream]") {
+    std::string big(100'000, 'x');
+    std::string enc = "d1:ali1ei-2e3:xyzl1:bi3eee1:bd1:ci18446744073709551615ee1:ci0e" +
+                      std::string{"1:di-9223372036854775808e1:e0:2:zz"} +
+                      std::to_string(big.size()) + ":" + big + "e";
+
+    for (size_t chunk : {enc.size(), size_t{1}, size_t{2}, size_t{3}, size_t{7}, size_t{4096}}) {
+        bt_stream_parser p;
+        bt_reencoder h;
+        bool ok = true;
+        for (size_t pos = 0; pos < enc.size(); pos += chunk) {
+            ok = ok && !p.done() && p.needed() > 0;
+            ok = ok && p.feed(std::string_view{enc}.substr(pos, chunk), h) ==
+                               std::min(chunk, enc.size() - pos);
+        }
+        REQUIRE(ok);
+        REQUIRE(p.done());
+        REQUIRE(p.needed() == 0);
+        REQUIRE(p.depth() == 0);
+        REQUIRE(p.offset() == enc.size());
+        REQUIRE(h.out == enc);
+    }
+
+    // Strings are passed along without copying, and needed() accounts for the rest of a string
+    struct {
+        std::vector<std::pair<const char*, size_t>> frags;
+        void string(std::string_view f, uint64_t, uint64_t) {
+            frags.emplace_back(f.data(), f.size());
+        }
+    } strings;
+    bt_stream_parser p;
+    std::string s = "l10:0123456789e";
+    REQUIRE(p.needed() == 2);
+    REQUIRE(p.feed(std::string_view{s}.substr(0, 3), strings) == 3);
+    REQUIRE(p.needed() == 12);  // Could still be a longer length, but at least `:`, 10 bytes, `e`
+    REQUIRE(p.feed(std::string_view{s}.substr(3, 5), strings) == 5);
+    REQUIRE(p.needed() == 7);
+    REQUIRE(p.feed(std::string_view{s}.substr(8), strings) == 7);
+    REQUIRE(p.done());
+    REQUIRE(strings.frags == decltype(strings.frags){{s.data() + 4, 4}, {s.data() + 8, 6}});
+
+    // Parsing stops at the end of the value, leaving the rest for the next value
+    p.reset();
+    bt_reencoder h;
+    std::string two = "li1ee4:abcd";
+    REQUIRE(p.feed(two, h) == 5);
+    REQUIRE(p.done());
+    REQUIRE(p.feed(std::string_view{two}.substr(5), h) == 0);
+    p.reset();
+    REQUIRE(p.feed(std::string_view{two}.substr(5), h) == 6);
+    REQUIRE(p.done());
+    REQUIRE(h.out == two);
+
+    // Errors report the offset within the whole stream
+    using errc = bt_errc;
+    auto error_of = [](std::string_view data, size_t chunk, size_t max_depth = 256) {
+        bt_stream_parser p{max_depth};
+        bt_error err;
+        for (size_t pos = 0; pos < data.size() && !err; pos += chunk)
+            p.feed(data.substr(pos, chunk), bt_reencoder{}, err);
+        REQUIRE(p.failed() == !!err);
+        return std::make_pair(err.code, err.offset);
+    };
+    for (size_t chunk : {size_t{1}, size_t{3}, size_t{100}}) {
+        CHECK(error_of("li1ex", chunk) == std::pair{errc::invalid_value, size_t{4}});
+        CHECK(error_of("d1:ai1ei2ee", chunk) == std::pair{errc::invalid_key, size_t{7}});
+        CHECK(error_of("d1:ae", chunk) == std::pair{errc::missing_value, size_t{4}});
+        CHECK(error_of("i12x", chunk) == std::pair{errc::expected_end, size_t{3}});
+        CHECK(error_of("ie", chunk) == std::pair{errc::expected_digit, size_t{1}});
+        CHECK(error_of("i-e", chunk) == std::pair{errc::expected_digit, size_t{2}});
+        CHECK(error_of("i18446744073709551616e", chunk) ==
+              std::pair{errc::integer_overflow, size_t{20}});
+        CHECK(error_of("i-9223372036854775809e", chunk) ==
+              std::pair{errc::integer_overflow, size_t{21}});
+        CHECK(error_of("l3x", chunk) == std::pair{errc::expected_colon, size_t{2}});
+        CHECK(error_of("e", chunk) == std::pair{errc::invalid_value, size_t{0}});
+        CHECK(error_of("llle", chunk, 2) == std::pair{errc::too_deep, size_t{2}});
+        CHECK(error_of("llee", chunk, 2).first == errc::ok);
+    }
+    // Hostile nesting is rejected without deep recursion or unbounded memory
+    CHECK(error_of(std::string(1'000'000, 'l'), 4096) == std::pair{errc::too_deep, size_t{256}});
+
+    // Once failed, the parser stays failed until reset
+    p.reset();
+    bt_error err;
+    REQUIRE(p.feed("lx", h, err) == 1);
+    REQUIRE(std::pair{err.code, err.offset} == std::pair{errc::invalid_value, size_t{1}});
+    REQUIRE(p.feed("e", h, err) == 0);
+    REQUIRE(std::pair{err.code, err.offset} == std::pair{errc::invalid_value, size_t{1}});
+    REQUIRE_THROWS_AS(p.feed("e", h), bt_deserialize_invalid);
+    p.reset();
+    REQUIRE(p.feed("le", h, err) == 2);
+    REQUIRE_FALSE(err);
+}
+
+TEST_CASE("bt frame length", "[bt][stream][frame]") {
+    std::string big(50'000, 'x');
+    std::string m1 = "d1:ai1e1:bl3:xyzi-3eee", m2 = std::to_string(big.size()) + ":" + big,
+                m3 = "i42e";
+    std::string stream = m1 + m2 + m3;
+
+    auto f = bt_frame_length(stream);
+    CHECK(f.complete);
+    CHECK(f.length == m1.size());
+    CHECK_FALSE(f.error);
+    f = bt_frame_length(std::string_view{stream}.substr(0, 5));
+    CHECK_FALSE(f.complete);
+    CHECK(f.length == 5);
+    CHECK(f.needed == 3);  // `1e` (at least) for a's value, and `e` to close the dict
+    f = bt_frame_length("l1:ax");
+    CHECK_FALSE(f.complete);
+    CHECK(f.error.code == bt_errc::invalid_value);
+    CHECK(f.error.offset == 4);
+
+    // Frame the stream as it arrives in small pieces, resuming from the saved state
+    for (size_t chunk : {size_t{1}, size_t{5}, size_t{1000}}) {
+        std::vector<std::string> frames;
+        std::string buf;
+        bt_stream_parser state;
+        bool ok = true;
+        for (size_t pos = 0; pos < stream.size(); pos += chunk) {
+            buf += stream.substr(pos, chunk);
+            auto frame = bt_frame_length(buf, state);
+            ok = ok && !frame.error;
+            while (frame.complete) {
+                frames.push_back(buf.substr(0, frame.length));
+                buf.erase(0, frame.length);
+                state.reset();
+                frame = bt_frame_length(buf, state);
+            }
+            ok = ok && (buf.empty() || frame.needed > 0);
+        }
+        CHECK(ok);
+        CHECK(buf.empty());
+        CHECK(frames == std::vector{m1, m2, m3});
+    }
+
+    // Partway through a large string, the whole rest of the string is needed
+    bt_stream_parser state;
+    f = bt_frame_length(std::string_view{m2}.substr(0, 1000), state);
+    CHECK(f.needed == m2.size() - 1000);
+    CHECK(state.offset() == 1000);
+    CHECK_THROWS_AS(bt_frame_length(std::string_view{m2}.substr(0, 999), state),
+                    std::invalid_argument);
+    f = bt_frame_length(m2 + m3, state);
+    CHECK(f.complete);
+    CHECK(f.length == m2.size());
+}
+
+TEST_CASE("bt visitor", "[bt][visit]") {
+    // Converts to JSON-ish text (without escaping), tracking the path of each integer
+    struct to_json {
+        std::string out;
+        std::vector<std::string_view> path;
+        std::vector<std::pair<std::string, int64_t>> ints;
+        bool first = true;
+        void sep() {
+            if (!first)
+                out += ',';
+            first = false;
+        }
+        void begin_list() {
+            sep();
+            out += '[';
+            first = true;
+            path.emplace_back();
+        }
+        void end_list() {
+            out += ']';
+            first = false;
+            path.pop_back();
+        }
+        void begin_dict() {
+            sep();
+            out += '{';
+            first = true;
+            path.emplace_back();
+        }
+        void end_dict() { end_list(), out.back() = '}'; }
+        void key(std::string_view k) {
+            sep();
+            out += '"';
+            out += k;
+            out += "\":";
+            first = true;
+            path.back() = k;
+        }
+        void string(std::string_view s) {
+            sep();
+            out += '"';
+            out += s;
+            out += '"';
+        }
+        void integer(int64_t i) {
+            sep();
+            out += std::to_string(i);
+            std::string p;
+            for (auto& k : path)
+                (p += '/') += k;
+            ints.emplace_back(p, i);
+        }
+        void integer(uint64_t i) { integer(static_cast<int64_t>(i)); }
+    };
+
+    std::string enc = "d1:ali1ei-2e3:xyzl1:bi3eee1:bd1:cd1:di4eee1:e0:e";
+    to_json j;
+    bt_visit(enc, j);
+    CHECK(j.out == R"({"a":[1,-2,"xyz",["b",3]],"b":{"c":{"d":4}},"e":""})");
+    CHECK(j.ints == std::vector<std::pair<std::string, int64_t>>{
+                            {"/a/", 1}, {"/a/", -2}, {"/a//", 3}, {"/b/c/d", 4}});
+
+    // Visitor methods are optional, and string views point into the data
+    struct {
+        std::vector<std::string_view> strings;
+        void string(std::string_view s) { strings.push_back(s); }
+    } strs;
+    bt_visit(enc, strs);
+    REQUIRE(strs.strings.size() == 3);
+    CHECK(strs.strings[0].data() == enc.data() + enc.find("xyz"));
+    CHECK(strs.strings[2].empty());
+    struct {
+        int n = 0;
+        void integer(uint64_t) { n++; }
+    } uints;
+    bt_visit(enc, uints);
+    CHECK(uints.n == 3);
+    bt_visit("i-1e", uints);
+    CHECK(uints.n == 3);
+
+    // Errors are reported at the same offsets as bt_validate
+    bt_error err;
+    for (std::string_view bad : {"d1:ai1e", "li1ei2ex", "d1:ae", "i1ei2e", "ld1:a3:abcee5:"}) {
+        to_json partial;
+        bt_visit(bad, partial, err);
+        auto v = bt_validate(bad);
+        CHECK(err.code == v.code);
+        CHECK(err.offset == v.offset);
+        CHECK_THROWS_AS(bt_visit(bad, partial), bt_deserialize_invalid);
+    }
+    bt_visit("le", j, err);
+    CHECK_FALSE(err);
+    CHECK_THROWS_AS(bt_visit(std::string(1000, 'l'), j), bt_deserialize_invalid);
+}
+
+namespace {
+struct bt_test_sub {
+    int64_t x;
+    std::string y;
+    static constexpr auto bt_fields() {
+        return std::tuple{bt_field{"y", &bt_test_sub::y}, bt_field{"x", &bt_test_sub::x}};
+    }
+};
+struct bt_test_msg {
+    uint64_t id = 0;
+    std::string method;
+    std::optional<int64_t> ns;
+    std::vector<std::string> tags;
+    bt_test_sub params;
+    std::optional<bt_test_sub> extra;
+    std::vector<bt_test_sub> subs;
+    std::string_view view;
+    static constexpr auto bt_fields() {
+        // Deliberately not in key order
+        return std::tuple{
+                bt_field{"method", &bt_test_msg::method},
+                bt_field{"id", &bt_test_msg::id},
+                bt_field{"ns", &bt_test_msg::ns},
+                bt_field{"tags", &bt_test_msg::tags},
+                bt_field{"params", &bt_test_msg::params},
+                bt_field{"extra", &bt_test_msg::extra},
+                bt_field{"subs", &bt_test_msg::subs},
+                bt_field{"~", &bt_test_msg::view}};
+    }
+};
+}  // namespace
+
+TEST_CASE("bt struct serialization", "[bt][struct]") {
+    static_assert(bt_struct<bt_test_msg>);
+    static_assert(!bt_struct<std::string>);
+    static_assert(detail::bt_field_order<bt_test_sub> == std::array<size_t, 2>{1, 0});
+
+    bt_test_msg m;
+    m.id = 123;
+    m.method = "get";
+    m.tags = {"a", "bc"};
+    m.params = {-5, "why"};
+    m.subs = {{1, "one"}, {2, "two"}};
+    m.view = "v";
+    std::string expected =
+            "d2:idi123e6:method3:get6:paramsd1:xi-5e1:y3:whye4:subsld1:xi1e1:y3:oneed1:xi2e1:y3:"
+            "twoee4:tagsl1:a2:bce1:~1:ve";
+    auto enc = bt_serialize_struct(m);
+    CHECK(enc == expected);
+
+    // Matches what we get with the generic bt_value serializer (which sorts at runtime):
+    bt_dict d{
+            {"id", 123},
+            {"method", "get"},
+            {"params", bt_dict{{"x", -5}, {"y", "why"}}},
+            {"subs", bt_list{bt_dict{{"x", 1}, {"y", "one"}}, bt_dict{{"x", 2}, {"y", "two"}}}},
+            {"tags", bt_list{{"a", "bc"}}},
+            {"~", "v"}};
+    CHECK(bt_serialize(d) == enc);
+
+    auto m2 = bt_deserialize_struct<bt_test_msg>(enc);
+    CHECK(m2.id == 123);
+    CHECK(m2.method == "get");
+    CHECK_FALSE(m2.ns);
+    CHECK(m2.tags == std::vector<std::string>{"a", "bc"});
+    CHECK(m2.params.x == -5);
+    CHECK(m2.params.y == "why");
+    CHECK_FALSE(m2.extra);
+    REQUIRE(m2.subs.size() == 2);
+    CHECK(m2.subs[1].y == "two");
+    CHECK(m2.view.data() == enc.data() + enc.size() - 2);
+
+    m.ns = -10;
+    m.extra = bt_test_sub{7, "seven"};
+    enc = bt_serialize_struct(m);
+    CHECK(enc.substr(0, 30) == "d5:extrad1:xi7e1:y5:sevene2:id");
+    m2 = bt_deserialize_struct<bt_test_msg>(enc);
+    CHECK(m2.ns == -10);
+    REQUIRE(m2.extra);
+    CHECK(m2.extra->y == "seven");
+
+    // Appending to an existing producer, with keys before and after the struct's keys:
+    bt_dict_producer p;
+    p.append("!", 1);
+    bt_append_struct(p, m.params);
+    p.append("z", 2);
+    CHECK(p.view() == "d1:!i1e1:xi-5e1:y3:why1:zi2ee");
+
+    // Unknown keys are skipped, and the consumer can be used for further keys:
+    bt_dict_consumer c{"d1:ai1e1:xi3e2:xxi0e1:y0:1:zi4ee"};
+    bt_test_sub sub;
+    bt_load_struct(c, sub);
+    CHECK(sub.x == 3);
+    CHECK(sub.y == "");
+    CHECK(c.require<int>("z") == 4);
+
+    // Missing required fields and wrong types fail:
+    CHECK_THROWS_AS(bt_deserialize_struct<bt_test_sub>("d1:xi3ee"), bt_deserialize_invalid);
+    CHECK_THROWS_AS(bt_deserialize_struct<bt_test_sub>("d1:x1:31:y0:e"), bt_deserialize_invalid);
+    CHECK_THROWS_AS(bt_deserialize_struct<bt_test_sub>("d1:xi3e1:y0:e1:x"), bt_deserialize_invalid);
+    bt_test_sub s2;
+    auto err = bt_try_deserialize_struct("d1:xi3ee", s2);
+    CHECK(err.code == bt_errc::missing_key);
+    err = bt_try_deserialize_struct("d1:x1:31:y0:e", s2);
+    CHECK(err.code == bt_errc::wrong_type);
+    CHECK(err.offset == 4);
+    err = bt_try_deserialize_struct("li1ee", s2);
+    CHECK(err.code == bt_errc::wrong_type);
+    CHECK_FALSE(bt_try_deserialize_struct("d1:xi3e1:y2:hie", s2));
+    CHECK(s2.y == "hi");
+}
+
 #ifdef OXENC_APPLE_TO_CHARS_WORKAROUND
 TEST_CASE("apple to_chars workaround test", "[bt][apple][sucks]") {
     char buf[20];
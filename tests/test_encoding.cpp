@@ -1,4 +1,5 @@
 #include <iterator>
+#include <list>
 
 #include "common.h"
 
@@ -99,6 +100,85 @@ TEST_CASE("hex encoding/decoding", "[encoding][decoding][hex]") {
     REQUIRE(oxenc::from_hex_size(98) == 49);
 }
 
+// Produces a deterministic pseudo-random byte string for exercising the bulk codecs
+static std::string test_bytes(size_t n, uint32_t seed = 42) {
+    std::string s(n, '\0');
+    for (auto& c : s) {
+        seed = seed * 1103515245 + 12345;
+        c = static_cast<char>(seed >> 16);
+    }
+    return s;
+}
+
+TEST_CASE("hex bulk kernels", "[encoding][decoding][hex][simd]") {
+    // The contiguous overloads go through the bulk kernels; the hex_encoder/hex_decoder iterators
+    // are the reference implementation they have to match exactly.
+    for (size_t n = 0; n < 300; n++) {
+        auto bytes = test_bytes(n, static_cast<uint32_t>(n));
+        auto enc = hex_encoder{bytes.begin(), bytes.end()};
+        std::string expected{enc, enc.end()};
+        REQUIRE(oxenc::to_hex(bytes) == expected);
+
+        std::string upper = expected;
+        for (auto& c : upper)
+            if (c >= 'a' && c <= 'f')
+                c = static_cast<char>(c - 'a' + 'A');
+        REQUIRE(oxenc::is_hex(expected));
+        REQUIRE(oxenc::is_hex(upper));
+        REQUIRE(oxenc::from_hex(expected) == bytes);
+        REQUIRE(oxenc::from_hex(upper) == bytes);
+
+        std::string out(n, '\0');
+        std::string check(n, '\0');
+        std::string encoded(2 * n, '\0');
+        detail::hex_encode_portable(
+                reinterpret_cast<const unsigned char*>(bytes.data()), n, encoded.data());
+        REQUIRE(encoded == expected);
+        detail::hex_decode_portable(
+                upper.data(), upper.size(), reinterpret_cast<unsigned char*>(out.data()));
+        REQUIRE(out == bytes);
+
+#ifdef OXENC_SIMD_X86
+        auto* in = reinterpret_cast<const unsigned char*>(bytes.data());
+        auto* dec = reinterpret_cast<unsigned char*>(check.data());
+        if (detail::simd() >= detail::simd_level::ssse3) {
+            auto done = detail::hex_encode_ssse3(in, n, encoded.data());
+            CHECK(done == n / 16 * 16);
+            CHECK(encoded.substr(0, 2 * done) == expected.substr(0, 2 * done));
+            done = detail::hex_decode_ssse3(upper.data(), upper.size(), dec);
+            CHECK(done == 2 * n / 32 * 32);
+            CHECK(check.substr(0, done / 2) == bytes.substr(0, done / 2));
+            CHECK(detail::hex_validate_ssse3(upper.data(), upper.size()) == 2 * n / 16 * 16);
+        }
+        if (detail::simd() >= detail::simd_level::avx2) {
+            auto done = detail::hex_encode_avx2(in, n, encoded.data());
+            CHECK(done == n / 32 * 32);
+            CHECK(encoded.substr(0, 2 * done) == expected.substr(0, 2 * done));
+            done = detail::hex_decode_avx2(upper.data(), upper.size(), dec);
+            CHECK(done == 2 * n / 64 * 64);
+            CHECK(check.substr(0, done / 2) == bytes.substr(0, done / 2));
+            CHECK(detail::hex_validate_avx2(upper.data(), upper.size()) == 2 * n / 32 * 32);
+        }
+#endif
+
+        // Corrupting any single character has to be detected, wherever it lands in the blocks:
+        if (n > 0) {
+            for (char bad : {'g', 'G', '/', ':', '@', '`', '\0', '\xff', '\x80'}) {
+                auto pos = (n * 7) % (2 * n);
+                auto broken = expected;
+                broken[pos] = bad;
+                REQUIRE_FALSE(oxenc::is_hex(broken));
+            }
+        }
+    }
+
+    // In-place decoding (output overlapping the input) through the bulk path:
+    auto big = test_bytes(200);
+    auto big_hex = oxenc::to_hex(big);
+    big_hex.erase(oxenc::from_hex(big_hex.begin(), big_hex.end(), big_hex.begin()), big_hex.end());
+    REQUIRE(big_hex == big);
+}
+
 TEST_CASE("base32z encoding/decoding", "[encoding][decoding][base32z]") {
     REQUIRE(oxenc::to_base32z("\0\0\0\0\0"s) == "yyyyyyyy");
     REQUIRE(oxenc::to_base32z(
@@ -217,6 +297,70 @@ TEST_CASE("base32z encoding/decoding", "[encoding][decoding][base32z]") {
     REQUIRE(oxenc::from_base32z_size(2) == 1);
 }
 
+TEST_CASE("base32z bulk kernels", "[encoding][decoding][base32z]") {
+    for (size_t n = 0; n < 300; n++) {
+        auto bytes = test_bytes(n, static_cast<uint32_t>(n) + 500);
+        auto enc = base32z_encoder{bytes.begin(), bytes.end()};
+        std::string expected{enc, enc.end()};
+
+        REQUIRE(oxenc::to_base32z(bytes) == expected);
+        REQUIRE(oxenc::to_base32z(bytes).size() == oxenc::to_base32z_size(n));
+        REQUIRE(oxenc::is_base32z(expected));
+        REQUIRE(oxenc::from_base32z(expected) == bytes);
+
+        auto upper = expected;
+        for (auto& c : upper)
+            if (c >= 'a' && c <= 'z')
+                c = static_cast<char>(c - 'a' + 'A');
+        REQUIRE(oxenc::is_base32z(upper));
+        REQUIRE(oxenc::from_base32z(upper) == bytes);
+
+        // Decode in place, back into the storage of the encoded string:
+        auto inplace = expected;
+        inplace.erase(oxenc::from_base32z(inplace.begin(), inplace.end(), inplace.begin()),
+                      inplace.end());
+        REQUIRE(inplace == bytes);
+
+        if (!expected.empty()) {
+            for (char bad : {'0', '2', 'l', 'v', 'L', 'V', '-', '=', '\0', '\xff', '\x80'}) {
+                auto broken = expected;
+                broken[(n * 7) % broken.size()] = bad;
+                REQUIRE_FALSE(oxenc::is_base32z(broken));
+                bool valid = true;
+                std::string out(n, '\0');
+                detail::b32z_decode_bulk(
+                        broken.data(),
+                        broken.size(),
+                        reinterpret_cast<unsigned char*>(out.data()),
+                        valid);
+                REQUIRE_FALSE(valid);
+            }
+        }
+    }
+
+    // 32-byte key fast path
+    auto key = "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef"_hex;
+    auto key_enc = base32z_encoder{key.begin(), key.end()};
+    std::string key_b32z{key_enc, key_enc.end()};
+    REQUIRE(key_b32z.size() == 52);
+    REQUIRE(to_base32z(key) == key_b32z);
+    REQUIRE(from_base32z(key_b32z) == key);
+    bool valid = true;
+    std::array<unsigned char, 32> out{};
+    key_b32z.back() = '0';
+    detail::b32z_decode_bulk(key_b32z.data(), key_b32z.size(), out.data(), valid);
+    REQUIRE_FALSE(valid);
+
+    // Invalid lengths
+    for (std::string_view bad : {"y", "yyy", "yyyyyy", "yyyyyyyyy"}) {
+        bool valid = true;
+        unsigned char buf[8];
+        detail::b32z_decode_bulk(bad.data(), bad.size(), buf, valid);
+        REQUIRE_FALSE(valid);
+        REQUIRE_FALSE(is_base32z(bad));
+    }
+}
+
 TEST_CASE("base64 encoding/decoding", "[encoding][decoding][base64]") {
     // 00000000 00000000 00000000 -> 000000 000000 000000 000000
     REQUIRE(oxenc::to_base64("\0\0\0"s) == "AAAA");
@@ -232,6 +376,15 @@ TEST_CASE("base64 encoding/decoding", "[encoding][decoding][base64]") {
     REQUIRE(oxenc::to_base64("abcde") == "YWJjZGU=");
     REQUIRE(oxenc::to_base64("abcdef") == "YWJjZGVm");
 
+    // Empty input encodes to an empty string however it is given to us:
+    std::list<char> empty_list;
+    std::string empty, empty_out;
+    REQUIRE(oxenc::to_base64("") == "");
+    REQUIRE(oxenc::to_base64(empty_list.begin(), empty_list.end()) == "");
+    oxenc::to_base64(empty.begin(), empty.end(), std::back_inserter(empty_out));
+    REQUIRE(empty_out == "");
+    REQUIRE(oxenc::to_base64_unpadded("") == "");
+
     REQUIRE(oxenc::to_base64_unpadded("a") == "YQ");
     REQUIRE(oxenc::to_base64_unpadded("ab") == "YWI");
     REQUIRE(oxenc::to_base64_unpadded("abc") == "YWJj");
@@ -368,6 +521,78 @@ TEST_CASE("base64 encoding/decoding", "[encoding][decoding][base64]") {
     REQUIRE(oxenc::from_base64_size(2) == 1);
 }
 
+TEST_CASE("base64 bulk kernels", "[encoding][decoding][base64][simd]") {
+    for (size_t n = 0; n < 300; n++) {
+        auto bytes = test_bytes(n, static_cast<uint32_t>(n) + 1000);
+        auto enc = base64_encoder{bytes.begin(), bytes.end()};
+        std::string padded{enc, enc.end()};
+        auto enc_np = base64_encoder{bytes.begin(), bytes.end(), false};
+        std::string unpadded{enc_np, enc_np.end()};
+
+        REQUIRE(oxenc::to_base64(bytes) == padded);
+        REQUIRE(oxenc::to_base64_unpadded(bytes) == unpadded);
+        REQUIRE(oxenc::to_base64(bytes).size() == oxenc::to_base64_size(n));
+        REQUIRE(oxenc::to_base64_unpadded(bytes).size() == oxenc::to_base64_size(n, false));
+        REQUIRE(oxenc::is_base64(padded));
+        REQUIRE(oxenc::is_base64(unpadded));
+        REQUIRE(oxenc::from_base64(padded) == bytes);
+        REQUIRE(oxenc::from_base64(unpadded) == bytes);
+
+        std::string out(n + 16, '\0');
+        bool valid = false;
+        auto* end = detail::b64_decode_portable(
+                unpadded.data(),
+                unpadded.size(),
+                reinterpret_cast<unsigned char*>(out.data()),
+                valid = true);
+        REQUIRE(valid);
+        REQUIRE(std::string_view{out.data(), static_cast<size_t>(
+                                                     reinterpret_cast<char*>(end) - out.data())} ==
+                bytes);
+
+#ifdef OXENC_SIMD_X86
+        std::string encoded(padded.size() + 32, '\0');
+        auto* in = reinterpret_cast<const unsigned char*>(bytes.data());
+        auto* dec = reinterpret_cast<unsigned char*>(out.data());
+        if (detail::simd() >= detail::simd_level::ssse3) {
+            auto done = detail::b64_encode_ssse3(in, n, encoded.data());
+            CHECK(done % 12 == 0);
+            CHECK(encoded.substr(0, done / 3 * 4) == padded.substr(0, done / 3 * 4));
+            done = detail::b64_decode_ssse3(padded.data(), padded.size(), dec);
+            CHECK(done % 16 == 0);
+            CHECK(out.substr(0, done / 4 * 3) == bytes.substr(0, done / 4 * 3));
+            CHECK(detail::b64_validate_ssse3(unpadded.data(), unpadded.size()) ==
+                  unpadded.size() / 16 * 16);
+        }
+        if (detail::simd() >= detail::simd_level::avx2) {
+            auto done = detail::b64_encode_avx2(in, n, encoded.data());
+            CHECK(done % 24 == 0);
+            CHECK(encoded.substr(0, done / 3 * 4) == padded.substr(0, done / 3 * 4));
+            done = detail::b64_decode_avx2(padded.data(), padded.size(), dec);
+            CHECK(done % 32 == 0);
+            CHECK(out.substr(0, done / 4 * 3) == bytes.substr(0, done / 4 * 3));
+            CHECK(detail::b64_validate_avx2(unpadded.data(), unpadded.size()) ==
+                  unpadded.size() / 32 * 32);
+        }
+#endif
+
+        if (unpadded.size() > 0) {
+            for (char bad : {'=', '-', '_', '.', ':', '@', '[', '`', '{', '\0', '\xff', '\x80'}) {
+                auto broken = unpadded;
+                auto pos = (n * 5) % unpadded.size();
+                if (bad == '=' && pos + 2 >= unpadded.size())
+                    continue;  // Might legitimately be padding
+                broken[pos] = bad;
+                REQUIRE_FALSE(oxenc::is_base64(broken));
+            }
+        }
+    }
+
+    // Non-zero padding bits are ignored, just as base64_decoder does:
+    REQUIRE(oxenc::from_base64("YWJjZB") == "abcd");
+    REQUIRE(oxenc::from_base64("YWJjZP==") == "abcd");
+}
+
 TEST_CASE("transcoding", "[decoding][encoding][base32z][hex][base64]") {
     // Decoders:
     oxenc::base64_decoder in64{pk_b64.begin(), pk_b64.end()};
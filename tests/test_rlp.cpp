@@ -4,6 +4,7 @@
 #include <set>
 
 #include "common.h"
+#include "oxenc/rlp_producer.h"
 #include "oxenc/rlp_serialize.h"
 
 TEST_CASE("RLP serialization", "[rlp][serialization]") {
@@ -149,4 +150,254 @@ TEST_CASE("RLP serialization", "[rlp][serialization]") {
     x.push_back(std::move(y));
 
     CHECK(oxenc::to_hex(rlp_serialize(x)) == "c7c0c1c0c3c0c1c0");
+
+    // Deeply nested lists: each list is only sized once, so this should be fast (sizing each list
+    // once per ancestor would take time proportional to the square of the depth).
+    const size_t depth = 10'000;
+    rlp_value deep = rlp_list{};
+    for (size_t i = 0; i < depth; i++) {
+        rlp_list l;
+        l.push_back(std::move(deep));
+        deep = std::move(l);
+    }
+    auto deep_encoded = rlp_serialize(deep);
+    CHECK(deep_encoded.size() == rlp_serialized_size(deep));
+    std::string_view rest = deep_encoded;
+    for (size_t i = 0; i < depth; i++) {
+        auto item = oxenc::detail::rlp_parse_item(rest);
+        REQUIRE(item.list);
+        REQUIRE(item.size == rest.size());
+        rest = item.payload;
+    }
+    CHECK(oxenc::to_hex(rest) == "c0");
+    rlp_list_producer deep_producer;
+    deep_producer.append(deep);
+    rlp_list deep_wrapped;
+    deep_wrapped.push_back(std::move(deep));
+    CHECK(deep_producer.view() == rlp_serialize(deep_wrapped));
+}
+
+TEST_CASE("RLP deserialization", "[rlp][deserialization]") {
+    CHECK(rlp_deserialize<std::string>("83646f67"_hex) == "dog");
+    CHECK(rlp_deserialize<std::string>("80"_hex) == "");
+    CHECK(rlp_deserialize<std::string>("7f"_hex) == "\x7f");
+    CHECK(rlp_deserialize<std::vector<std::string>>("c88363617483646f67"_hex) ==
+          std::vector<std::string>{"cat", "dog"});
+    CHECK(rlp_deserialize<std::vector<std::string>>("c0"_hex).empty());
+
+    for (uint64_t i : {0ul, 1ul, 127ul, 128ul, 1000ul, 100000ul, 0xffffffffffffffff})
+        CHECK(rlp_deserialize<uint64_t>(rlp_serialize(i)) == i);
+    CHECK(rlp_deserialize<uint16_t>("8203e8"_hex) == 1000);
+    CHECK_THROWS_AS(rlp_deserialize<uint8_t>("8203e8"_hex), rlp_deserialize_invalid);
+    CHECK(rlp_deserialize<std::vector<unsigned>>("c3010203"_hex) == std::vector{1u, 2u, 3u});
+    CHECK(rlp_deserialize<std::list<std::vector<unsigned>>>("c5c0c10ac10b"_hex) ==
+          std::list<std::vector<unsigned>>{{}, {10}, {11}});
+
+    // Views point into the encoded data; other byte containers get copies:
+    auto encoded = "8568656c6c6f"_hex;
+    auto sv = rlp_deserialize<std::string_view>(encoded);
+    CHECK(sv == "hello");
+    CHECK(sv.data() == encoded.data() + 1);
+    CHECK(rlp_deserialize<std::vector<uint8_t>>(encoded) ==
+          std::vector<uint8_t>{'h', 'e', 'l', 'l', 'o'});
+    CHECK(rlp_deserialize<std::basic_string_view<std::byte>>(encoded).size() == 5);
+
+    // Generic values (and a long string/list) round-trip through rlp_value:
+    std::string long_str(1024, 'z');
+    for (std::string hex : {"c7c0c1c0c3c0c1c0", "c88204d2c3010203c0", "f8388204d2c3010203c0af"}) {
+        if (hex.size() == 22)
+            for (int i = 0; i < 47; i++)
+                hex += "42";
+        auto enc = oxenc::from_hex(hex);
+        CHECK(oxenc::to_hex(rlp_serialize(rlp_deserialize(enc))) == hex);
+    }
+    auto v = rlp_deserialize(rlp_serialize(std::vector<std::string>{"a", long_str}));
+    REQUIRE(std::holds_alternative<rlp_list>(v));
+    auto& l = std::get<rlp_list>(v);
+    REQUIRE(l.size() == 2);
+    CHECK(std::get<std::string>(l.front()) == "a");
+    CHECK(std::get<std::string>(l.back()) == long_str);
+
+    // Invalid or non-canonical encodings:
+    const std::array invalid{
+            ""sv,                    // Empty
+            "83646f"sv,              // Truncated string
+            "c3010203ff"sv,          // Trailing data
+            "c5010203"sv,            // Truncated list
+            "8100"sv,                // Single byte < 0x80 must be encoded as itself
+            "817f"sv,                // ditto
+            "b80161"sv,              // Long form length for a short string
+            "b8000000"sv,            // Length with leading zeros
+            "f80100"sv,              // Long form length for a short list
+            "b9"sv,                  // Truncated length
+            "bf0000000000000001"sv,  // Length too long for the data
+    };
+    for (auto hex : invalid) {
+        INFO(hex);
+        CHECK_THROWS_AS(rlp_deserialize(oxenc::from_hex(hex)), rlp_deserialize_invalid);
+    }
+    // Integers must not have leading zeros (and so 0 must be encoded as the empty string):
+    CHECK_THROWS_AS(rlp_deserialize<uint64_t>("00"_hex), rlp_deserialize_invalid);
+    CHECK_THROWS_AS(rlp_deserialize<uint64_t>("820001"_hex), rlp_deserialize_invalid);
+    CHECK(rlp_deserialize<std::string>("00"_hex) == "\0"sv);
+
+    // Wrong types:
+    CHECK_THROWS_AS(
+            rlp_deserialize<std::vector<std::string>>("83646f67"_hex), rlp_deserialize_invalid);
+    CHECK_THROWS_AS(rlp_deserialize<std::string>("c0"_hex), rlp_deserialize_invalid);
+
+    // Excessive nesting:
+    auto nested = [](int depth) {
+        rlp_value v = rlp_list{};
+        for (int i = 0; i < depth; i++) {
+            rlp_list l;
+            l.push_back(std::move(v));
+            v = std::move(l);
+        }
+        return rlp_serialize(v);
+    };
+    CHECK_NOTHROW(rlp_deserialize(nested(200)));
+    CHECK_THROWS_AS(rlp_deserialize(nested(300)), rlp_deserialize_invalid);
+}
+
+TEST_CASE("RLP list consumer", "[rlp][consumer]") {
+    std::string B(47, 'B');
+    auto encoded = std::string{"f8388204d2c3010203c0af"_hex} + B;
+
+    rlp_list_consumer c{encoded};
+    CHECK_FALSE(c.is_finished());
+    CHECK(c.is_string());
+    CHECK_FALSE(c.is_list());
+    CHECK_THROWS_AS(c.consume_integer<uint8_t>(), rlp_deserialize_invalid);
+    CHECK_THROWS_AS(c.consume_list_consumer(), rlp_deserialize_invalid);
+    CHECK(c.consume_integer<uint16_t>() == 1234);
+    CHECK(c.is_list());
+    {
+        auto sub = c.consume_list_consumer();
+        CHECK(sub.consume_integer<unsigned>() == 1);
+        CHECK(sub.consume<uint64_t>() == 2);
+        CHECK(sub.consume_string() == "\x03");
+        CHECK(sub.is_finished());
+        CHECK_THROWS_AS(sub.consume_string_view(), rlp_deserialize_invalid);
+    }
+    CHECK(c.consume_list_data() == "\xc0");
+    auto s = c.consume_string_view();
+    CHECK(s == B);
+    CHECK(s.data() == encoded.data() + encoded.size() - B.size());
+    CHECK(c.is_finished());
+
+    rlp_list_consumer c2{encoded};
+    c2.skip_value();
+    c2.skip_value();
+    CHECK(c2.consume<std::vector<unsigned>>().empty());
+    CHECK(c2.consume_string_view<unsigned char>().size() == B.size());
+    CHECK(c2.is_finished());
+
+    CHECK_THROWS_AS(rlp_list_consumer{"83646f67"_hex}, rlp_deserialize_invalid);
+    CHECK_THROWS_AS(rlp_list_consumer{"c0c0"_hex}, rlp_deserialize_invalid);
+    CHECK_THROWS_AS(rlp_list_consumer{"c2"_hex}, rlp_deserialize_invalid);
+    // Elements are validated as they are consumed:
+    rlp_list_consumer bad{"c28100"_hex};
+    CHECK_THROWS_AS(bad.consume_string_view(), rlp_deserialize_invalid);
+}
+
+TEST_CASE("RLP serialization into a buffer", "[rlp][serialization]") {
+    std::vector<std::vector<std::string>> val;
+    for (int i = 0; i < 20; i++)
+        val.emplace_back(static_cast<size_t>(i), std::string(static_cast<size_t>(i) * 3, 'x'));
+    auto encoded = rlp_serialize(val);
+    CHECK(rlp_deserialize<std::vector<std::vector<std::string>>>(encoded) == val);
+    CHECK(rlp_serialized_size(val) == encoded.size());
+    CHECK(rlp_serialized_size(1000u) == 3);
+    CHECK(rlp_serialized_size("dog"sv) == 4);
+
+    std::vector<unsigned char> buf(encoded.size());
+    CHECK(rlp_serialize_into(buf, val) == encoded.size());
+    CHECK(std::string_view{reinterpret_cast<const char*>(buf.data()), buf.size()} == encoded);
+
+    std::array<char, 8> small;
+    CHECK(rlp_serialize_into(small, std::vector<unsigned>{1u, 2u, 1000u}) == 6);
+    CHECK(oxenc::to_hex(small.begin(), small.begin() + 6) == "c501028203e8");
+    CHECK_THROWS_AS(rlp_serialize_into(small, "123456789"sv), std::length_error);
+}
+
+TEST_CASE("RLP list producer", "[rlp][producer]") {
+    std::string B(47, 'B');
+    {
+        rlp_list_producer l;
+        CHECK(oxenc::to_hex(l.view()) == "c0");
+        l.append(1234u);
+        {
+            auto sub = l.append_list();
+            sub.append(1u);
+            sub.append(uint64_t{2});
+            sub.append("\x03");
+            CHECK_THROWS_AS(l.append(4u), std::logic_error);
+            CHECK_THROWS_AS(l.view(), std::logic_error);
+            CHECK_THROWS_AS(l.append_list(), std::logic_error);
+            CHECK(oxenc::to_hex(sub.view()) == "c3010203");
+        }
+        l.append(std::vector<unsigned>{});
+        CHECK(oxenc::to_hex(l.view()) == "c88204d2c3010203c0");
+        // Appending after viewing grows the header once the list gets longer than 55 bytes:
+        l.append(B);
+        CHECK(oxenc::to_hex(l.view()) == "f8388204d2c3010203c0af" + oxenc::to_hex(B));
+        auto str = std::move(l).str();
+        CHECK(oxenc::to_hex(str) == "f8388204d2c3010203c0af" + oxenc::to_hex(B));
+        CHECK(oxenc::to_hex(l.view()) == "c0");
+    }
+
+    // Nested lists of various sizes (including long headers at several levels) match
+    // rlp_serialize:
+    std::vector<std::vector<std::vector<std::string>>> val;
+    rlp_list_producer l{100};
+    for (size_t i = 0; i < 10; i++) {
+        auto& v1 = val.emplace_back();
+        auto l1 = l.append_list();
+        for (size_t j = 0; j < i * 3; j++) {
+            auto& v2 = v1.emplace_back();
+            auto l2 = l1.append_list();
+            for (size_t k = 0; k < j; k++) {
+                auto& s = v2.emplace_back(k * 10 + i, 'a');
+                l2.append(s);
+            }
+        }
+    }
+    auto expected = rlp_serialize(val);
+    CHECK(l.view() == expected);
+
+    // Generic values:
+    rlp_list_producer l2;
+    l2.append(rlp_deserialize("c7c0c1c0c3c0c1c0"_hex));
+    l2.append(std::vector<std::string>{"cat", "dog"});
+    l2.append("dog");
+    l2.append(std::vector<uint8_t>{});
+    l2.append_encoded("c0"_hex);
+    CHECK(oxenc::to_hex(l2.view()) == "d7c7c0c1c0c3c0c1c0c88363617483646f6783646f6780c0");
+
+    // External buffers:
+    std::string buf(expected.size() + 40, '\0');
+    {
+        rlp_list_producer lb{buf.data(), buf.size()};
+        for (size_t i = 0; i < 10; i++) {
+            auto l1 = lb.append_list();
+            for (size_t j = 0; j < i * 3; j++) {
+                auto l2 = l1.append_list();
+                for (size_t k = 0; k < j; k++)
+                    l2.append(std::string(k * 10 + i, 'a'));
+            }
+        }
+        auto v = lb.view();
+        CHECK(v == expected);
+        CHECK(v.data() == buf.data());
+        CHECK_THROWS_AS(std::move(lb).str(), std::logic_error);
+    }
+    {
+        char small[8];
+        rlp_list_producer lb{small, sizeof(small)};
+        lb.append(1000u);
+        lb.append("abc");
+        CHECK_THROWS_AS(lb.append("d"), std::length_error);
+        CHECK(oxenc::to_hex(lb.view()) == "c78203e883616263");
+    }
 }